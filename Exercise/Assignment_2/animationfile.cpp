@@ -0,0 +1,315 @@
+#include "animationfile.h"
+
+#include <cstring>
+
+#ifndef WIN32
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+#define ANIMATION_MAGIC 0x4D494E41 // "ANIM"
+#define ANIMATION_VERSION 1
+
+struct AnimationFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int numObjects;
+	unsigned int numKeys;
+};
+
+AnimationFile::AnimationFile()
+	: mObjects(NULL),
+	  mKeys(NULL),
+	  mNumObjects(0),
+	  mNumKeys(0),
+	  mMapping(NULL),
+	  mMappingSize(0)
+{
+}
+
+AnimationFile::~AnimationFile()
+{
+	close();
+}
+
+void AnimationFile::close()
+{
+#ifndef WIN32
+	if(mMapping != NULL)
+		munmap(mMapping, mMappingSize);
+#endif
+	mMapping = NULL;
+	mMappingSize = 0;
+	mBuffer.clear();
+
+	mParsedObjects.clear();
+	mParsedKeys.clear();
+
+	mObjects = NULL;
+	mKeys = NULL;
+	mNumObjects = 0;
+	mNumKeys = 0;
+}
+
+bool AnimationFile::loadText(const std::string& filename)
+{
+	close();
+
+	std::ifstream file(filename.c_str());
+	if(!file.is_open())
+	{
+		PRINTERROR("could not open " << filename);
+		return false;
+	}
+
+	std::string line;
+	unsigned int lineNumber = 0;
+	while(std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream in(line);
+		std::string keyword;
+		if(!(in >> keyword))
+			continue;
+
+		if(keyword == "object")
+		{
+			std::string name;
+			if(!(in >> name) || name.size() >= ANIMATION_NAME_LENGTH)
+			{
+				PRINTERROR(filename << ":" << lineNumber << ": invalid object name");
+				close();
+				return false;
+			}
+
+			AnimationObjectRecord object;
+			std::memset(&object, 0, sizeof(object));
+			std::strncpy(object.name, name.c_str(), ANIMATION_NAME_LENGTH - 1);
+			object.firstKey = mParsedKeys.size();
+			object.numKeys = 0;
+			mParsedObjects.push_back(object);
+		}
+		else if(keyword == "key")
+		{
+			AnimationKeyRecord key;
+			if(mParsedObjects.empty() ||
+				!(in >> key.time >> key.translation[0] >> key.translation[1] >> key.translation[2] >> key.rotation[0] >> key.rotation[1] >> key.rotation[2]))
+			{
+				PRINTERROR(filename << ":" << lineNumber << ": invalid key");
+				close();
+				return false;
+			}
+
+			mParsedKeys.push_back(key);
+			mParsedObjects.back().numKeys++;
+		}
+		else
+		{
+			PRINTERROR(filename << ":" << lineNumber << ": unknown keyword " << keyword);
+			close();
+			return false;
+		}
+	}
+
+	mObjects = mParsedObjects.empty() ? NULL : &mParsedObjects[0];
+	mKeys = mParsedKeys.empty() ? NULL : &mParsedKeys[0];
+	mNumObjects = mParsedObjects.size();
+	mNumKeys = mParsedKeys.size();
+
+	return true;
+}
+
+bool AnimationFile::loadBinary(const std::string& filename)
+{
+	close();
+
+	const char* data = NULL;
+	size_t size = 0;
+
+#ifndef WIN32
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+	{
+		PRINTERROR("could not open " << filename);
+		return false;
+	}
+
+	struct stat info;
+	if(fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(AnimationFileHeader))
+	{
+		PRINTERROR(filename << " is no animation file");
+		::close(fd);
+		return false;
+	}
+
+	size = info.st_size;
+	void* mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if(mapping == MAP_FAILED)
+	{
+		PRINTERROR("could not map " << filename);
+		return false;
+	}
+	mMapping = mapping;
+	mMappingSize = size;
+	data = (const char*)mapping;
+#else
+	std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+	if(!file.is_open())
+	{
+		PRINTERROR("could not open " << filename);
+		return false;
+	}
+	size = file.tellg();
+	mBuffer.resize(size);
+	file.seekg(0);
+	if(size == 0 || !file.read(&mBuffer[0], size))
+	{
+		PRINTERROR("could not read " << filename);
+		close();
+		return false;
+	}
+	data = &mBuffer[0];
+#endif
+
+	const AnimationFileHeader* header = (const AnimationFileHeader*)data;
+	if(size < sizeof(AnimationFileHeader) || header->magic != ANIMATION_MAGIC || header->version != ANIMATION_VERSION)
+	{
+		PRINTERROR(filename << " is no animation file of version " << ANIMATION_VERSION);
+		close();
+		return false;
+	}
+
+	size_t expected = sizeof(AnimationFileHeader) +
+		size_t(header->numObjects) * sizeof(AnimationObjectRecord) +
+		size_t(header->numKeys) * sizeof(AnimationKeyRecord);
+	if(size < expected)
+	{
+		PRINTERROR(filename << " is truncated");
+		close();
+		return false;
+	}
+
+	mNumObjects = header->numObjects;
+	mNumKeys = header->numKeys;
+	mObjects = (const AnimationObjectRecord*)(data + sizeof(AnimationFileHeader));
+	mKeys = (const AnimationKeyRecord*)(data + sizeof(AnimationFileHeader) + mNumObjects * sizeof(AnimationObjectRecord));
+
+	for(unsigned int i = 0; i < mNumObjects; ++i)
+	{
+		// in this order the sum of the two counts from the file cannot wrap around
+		if(mObjects[i].numKeys > mNumKeys || mObjects[i].firstKey > mNumKeys - mObjects[i].numKeys ||
+			mObjects[i].name[ANIMATION_NAME_LENGTH - 1] != 0)
+		{
+			PRINTERROR(filename << ": invalid object " << i);
+			close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool AnimationFile::saveBinary(const std::string& filename) const
+{
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if(!file.is_open())
+	{
+		PRINTERROR("could not open " << filename);
+		return false;
+	}
+
+	AnimationFileHeader header;
+	header.magic = ANIMATION_MAGIC;
+	header.version = ANIMATION_VERSION;
+	header.numObjects = mNumObjects;
+	header.numKeys = mNumKeys;
+
+	file.write((const char*)&header, sizeof(header));
+	if(mNumObjects > 0)
+		file.write((const char*)mObjects, mNumObjects * sizeof(AnimationObjectRecord));
+	if(mNumKeys > 0)
+		file.write((const char*)mKeys, mNumKeys * sizeof(AnimationKeyRecord));
+
+	if(!file.good())
+	{
+		PRINTERROR("could not write " << filename);
+		return false;
+	}
+
+	return true;
+}
+
+unsigned int AnimationFile::getNumObjects() const
+{
+	return mNumObjects;
+}
+
+std::string AnimationFile::getObjectName(unsigned int idx) const
+{
+	return std::string(mObjects[idx].name);
+}
+
+int AnimationFile::findObject(const std::string& name) const
+{
+	for(unsigned int i = 0; i < mNumObjects; ++i)
+	{
+		if(name.compare(mObjects[i].name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+unsigned int AnimationFile::getNumKeys(unsigned int idx) const
+{
+	return mObjects[idx].numKeys;
+}
+
+const AnimationKeyRecord& AnimationFile::getKey(unsigned int idx, unsigned int k) const
+{
+	return mKeys[mObjects[idx].firstKey + k];
+}
+
+bool AnimationFile::fillTracks(unsigned int idx, SplineTrack* path, RotationTrack* rotation) const
+{
+	if(idx >= mNumObjects)
+	{
+		PRINTERROR("no animation object " << idx);
+		return false;
+	}
+
+	const unsigned int numKeys = mObjects[idx].numKeys;
+	const AnimationKeyRecord* records = mKeys + mObjects[idx].firstKey;
+
+	if(path)
+	{
+		path->clear();
+		path->reserve(numKeys);
+	}
+	if(rotation)
+	{
+		rotation->clear();
+		rotation->reserve(numKeys);
+	}
+
+	for(unsigned int k = 0; k < numKeys; ++k)
+	{
+		const AnimationKeyRecord& r = records[k];
+		vec3 t(r.translation[0], r.translation[1], r.translation[2]);
+
+		if(path)
+			path->addKey(REAL(r.time), t);
+		if(rotation)
+			rotation->addKey(REAL(r.time), RotationTrack::fromFixedAngles(r.rotation[0], r.rotation[1], r.rotation[2]));
+	}
+
+	return true;
+}
@@ -0,0 +1,102 @@
+#ifndef __ANIMATIONFILE_H__
+#define __ANIMATIONFILE_H__
+
+#include "platform.h"
+#include "keyframetrack.h"
+
+#define ANIMATION_NAME_LENGTH 32
+
+//! a key as stored in the files: time, translation, fixed angles in degrees
+struct AnimationKeyRecord
+{
+	float time;
+	float translation[3];
+	float rotation[3];
+};
+
+//! an object as stored in the files: name and its keys [firstKey, firstKey+numKeys)
+struct AnimationObjectRecord
+{
+	char name[ANIMATION_NAME_LENGTH];
+	unsigned int firstKey;
+	unsigned int numKeys;
+};
+
+/*! AnimationFile
+ *
+ *  \brief  keyframe tracks of named objects. The text format is meant for
+ *          authoring, one "object <name>" line followed by its
+ *          "key <time> <tx> <ty> <tz> <rx> <ry> <rz>" lines, '#' starts a
+ *          comment. The binary format is a 16 byte header ("ANIM", version,
+ *          number of objects and keys), the object table and the key table.
+ *          Binary files are memory mapped and the tables are read in place,
+ *          the tracks are filled with preallocated storage, so loading does
+ *          not allocate per key. Byte order is the one of the writing machine.
+ */
+class AnimationFile
+{
+public:
+
+	//! constructor
+	AnimationFile();
+
+	//! destructor, unmaps the file
+	~AnimationFile();
+
+	//! releases the loaded data
+	void close();
+
+	//! parses a text file
+	bool loadText(const std::string& filename);
+
+	//! maps a binary file
+	bool loadBinary(const std::string& filename);
+
+	//! writes the loaded data as binary file
+	bool saveBinary(const std::string& filename) const;
+
+	//! get number of objects
+	unsigned int getNumObjects() const;
+
+	//! name of object idx
+	std::string getObjectName(unsigned int idx) const;
+
+	//! index of the object with name or -1
+	int findObject(const std::string& name) const;
+
+	//! get number of keys of object idx
+	unsigned int getNumKeys(unsigned int idx) const;
+
+	//! key k of object idx
+	const AnimationKeyRecord& getKey(unsigned int idx, unsigned int k) const;
+
+	//! fills the tracks of object idx, either track may be NULL
+	bool fillTracks(unsigned int idx, SplineTrack* path, RotationTrack* rotation) const;
+
+protected:
+
+	//! tables in use, pointing into the mapping or into the parsed vectors
+	const AnimationObjectRecord* mObjects;
+	const AnimationKeyRecord* mKeys;
+	unsigned int mNumObjects;
+	unsigned int mNumKeys;
+
+	//! storage of text files
+	std::vector<AnimationObjectRecord> mParsedObjects;
+	std::vector<AnimationKeyRecord> mParsedKeys;
+
+	//! the mapped binary file
+	void* mMapping;
+	size_t mMappingSize;
+
+	//! file contents where mmap is not available
+	std::vector<char> mBuffer;
+
+private:
+
+	//! not copyable, a copy would unmap the file a second time
+	AnimationFile(const AnimationFile& other);
+	void operator=(const AnimationFile& other);
+};
+
+#endif //__ANIMATIONFILE_H__
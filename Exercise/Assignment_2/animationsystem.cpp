@@ -0,0 +1,284 @@
+#include "animationsystem.h"
+
+// segment of the sorted times [0, n) around time, times beyond the last key map to segment n-1 with u = 0
+static inline void locateFlat(const REAL* times, unsigned int n, unsigned int& cursor, REAL time, unsigned int& seg, REAL& u)
+{
+	if(n < 2 || time <= times[0])
+	{
+		seg = 0;
+		u = 0;
+		return;
+	}
+
+	if(time >= times[n - 1])
+	{
+		seg = n - 1;
+		u = 0;
+		return;
+	}
+
+	unsigned int c = (cursor < n - 1) ? cursor : 0;
+	if(times[c] <= time && time < times[c + 1])
+	{
+	}
+	else if(c + 2 < n && times[c + 1] <= time && time < times[c + 2])
+	{
+		c++;
+	}
+	else
+	{
+		c = (std::upper_bound(times, times + n, time) - times) - 1;
+	}
+
+	cursor = c;
+	seg = c;
+	REAL dt = times[c + 1] - times[c];
+	u = (dt > 0) ? (time - times[c]) / dt : REAL(0);
+}
+
+// shortest arc slerp angle between two quaternions, invSin is 0 if they nearly coincide
+static inline void slerpAngle(const quat& a, const quat& b, REAL& angle, REAL& invSin, REAL& sign)
+{
+	REAL d = a.dot(b);
+	sign = (d < 0) ? REAL(-1) : REAL(1);
+	d *= sign;
+
+	angle = 0;
+	invSin = 0;
+	if(d < REAL(1) - EPSILON)
+	{
+		angle = std::acos(d);
+		invSin = REAL(1) / std::sin(angle);
+	}
+}
+
+// slerp of two quaternions given as w, x, y, z with a known angle
+static inline void slerpFlat(const REAL* a, const REAL* b, REAL angle, REAL invSin, REAL sign, REAL u, REAL* out)
+{
+	REAL wa = REAL(1) - u;
+	REAL wb = u;
+	if(invSin > 0)
+	{
+		wa = std::sin(wa * angle) * invSin;
+		wb = std::sin(wb * angle) * invSin;
+	}
+	wb *= sign;
+
+	for(unsigned int k = 0; k < 4; ++k)
+		out[k] = wa * a[k] + wb * b[k];
+}
+
+AnimationSystem::AnimationSystem()
+{
+	clear();
+}
+
+void AnimationSystem::clear()
+{
+	mPathOffsets.assign(1, 0);
+	mPathTimes.clear();
+	for(unsigned int k = 0; k < 12; ++k)
+		mPathCoeffs[k].clear();
+
+	mRotOffsets.assign(1, 0);
+	mRotTimes.clear();
+	for(unsigned int k = 0; k < 4; ++k)
+	{
+		mRotKeys[k].clear();
+		mRotControls[k].clear();
+	}
+	mRotAngles.clear();
+	mRotInvSin.clear();
+	mCtrlAngles.clear();
+	mCtrlInvSin.clear();
+	mCtrlSigns.clear();
+	mRotSquad.clear();
+
+	mPathCursors.clear();
+	mRotCursors.clear();
+	mPathSegs.clear();
+	mPathU.clear();
+	mRotSegs.clear();
+	mRotU.clear();
+	mModelMatrices.clear();
+}
+
+unsigned int AnimationSystem::addObject(const SplineTrack& path, const RotationTrack& rotation)
+{
+	unsigned int idx = mModelMatrices.size();
+
+	// translation: one slot per key, an empty track is a single key at the origin
+	const KeyTimeline& pathTimes = path.getTimeline();
+	unsigned int numPathKeys = std::max(path.getNumKeys(), 1u);
+	for(unsigned int i = 0; i < numPathKeys; ++i)
+	{
+		REAL c[12];
+		if(i + 1 < numPathKeys)
+		{
+			const vec3* seg = path.getCoefficients(i);
+			for(unsigned int k = 0; k < 4; ++k)
+				for(unsigned int a = 0; a < 3; ++a)
+					c[3 * k + a] = seg[k][a];
+		}
+		else
+		{
+			vec3 p = vec3::Zero();
+			if(path.getNumKeys() > 0)
+				path.evaluate(pathTimes.getTime(i), p);
+			for(unsigned int k = 0; k < 9; ++k)
+				c[k] = 0;
+			for(unsigned int a = 0; a < 3; ++a)
+				c[9 + a] = p[a];
+		}
+
+		mPathTimes.push_back((path.getNumKeys() > 0) ? pathTimes.getTime(i) : REAL(0));
+		for(unsigned int k = 0; k < 12; ++k)
+			mPathCoeffs[k].push_back(c[k]);
+	}
+	mPathOffsets.push_back(mPathTimes.size());
+
+	// rotation: one slot per key and a copy of the last one, an empty track is the identity
+	const KeyTimeline& rotTimes = rotation.getTimeline();
+	unsigned int numRotKeys = rotation.getNumKeys();
+	for(unsigned int i = 0; i <= std::max(numRotKeys, 1u); ++i)
+	{
+		quat q = quat::Identity();
+		quat s = quat::Identity();
+		quat qNext = quat::Identity();
+		quat sNext = quat::Identity();
+		REAL t = 0;
+		if(numRotKeys > 0)
+		{
+			unsigned int j = std::min(i, numRotKeys - 1);
+			unsigned int jNext = std::min(i + 1, numRotKeys - 1);
+			q = rotation.getKey(j);
+			s = rotation.getControl(j);
+			qNext = rotation.getKey(jNext);
+			sNext = rotation.getControl(jNext);
+			t = rotTimes.getTime(j);
+		}
+
+		REAL angle, invSin, sign;
+		slerpAngle(q, qNext, angle, invSin, sign);
+		mRotAngles.push_back(angle);
+		mRotInvSin.push_back(invSin);
+		slerpAngle(s, sNext, angle, invSin, sign);
+		mCtrlAngles.push_back(angle);
+		mCtrlInvSin.push_back(invSin);
+		mCtrlSigns.push_back(sign);
+
+		mRotTimes.push_back(t);
+		mRotKeys[0].push_back(q.w());
+		mRotKeys[1].push_back(q.x());
+		mRotKeys[2].push_back(q.y());
+		mRotKeys[3].push_back(q.z());
+		mRotControls[0].push_back(s.w());
+		mRotControls[1].push_back(s.x());
+		mRotControls[2].push_back(s.y());
+		mRotControls[3].push_back(s.z());
+	}
+	mRotOffsets.push_back(mRotTimes.size());
+	mRotSquad.push_back((rotation.getInterpolation() == RotationTrack::SQUAD) ? REAL(1) : REAL(0));
+
+	mPathCursors.push_back(0);
+	mRotCursors.push_back(0);
+	mPathSegs.push_back(0);
+	mPathU.push_back(0);
+	mRotSegs.push_back(0);
+	mRotU.push_back(0);
+	mModelMatrices.push_back(mat4::Identity());
+
+	return idx;
+}
+
+unsigned int AnimationSystem::getNumObjects() const
+{
+	return mModelMatrices.size();
+}
+
+void AnimationSystem::evaluate(REAL time)
+{
+	const int numObjects = mModelMatrices.size();
+
+	#pragma omp parallel
+	{
+		// segment lookup, the only branchy part
+		#pragma omp for
+		for(int o = 0; o < numObjects; ++o)
+		{
+			unsigned int seg;
+			REAL u;
+
+			unsigned int off = mPathOffsets[o];
+			locateFlat(&mPathTimes[off], mPathOffsets[o + 1] - off, mPathCursors[o], time, seg, u);
+			mPathSegs[o] = off + seg;
+			mPathU[o] = u;
+
+			off = mRotOffsets[o];
+			locateFlat(&mRotTimes[off], mRotOffsets[o + 1] - off - 1, mRotCursors[o], time, seg, u);
+			mRotSegs[o] = off + seg;
+			mRotU[o] = u;
+		}
+
+		// translation: horner per axis
+		#pragma omp for
+		for(int o = 0; o < numObjects; ++o)
+		{
+			const unsigned int s = mPathSegs[o];
+			const REAL u = mPathU[o];
+			REAL* M = mModelMatrices[o].data();
+			for(unsigned int a = 0; a < 3; ++a)
+				M[12 + a] = ((mPathCoeffs[a][s] * u + mPathCoeffs[3 + a][s]) * u + mPathCoeffs[6 + a][s]) * u + mPathCoeffs[9 + a][s];
+			M[15] = 1;
+		}
+
+		// rotation: squad, slerp has a zero blend weight
+		#pragma omp for
+		for(int o = 0; o < numObjects; ++o)
+		{
+			const unsigned int s = mRotSegs[o];
+			const REAL u = mRotU[o];
+
+			REAL q0[4], q1[4], s0[4], s1[4], qa[4], sa[4], q[4];
+			for(unsigned int k = 0; k < 4; ++k)
+			{
+				q0[k] = mRotKeys[k][s];
+				q1[k] = mRotKeys[k][s + 1];
+				s0[k] = mRotControls[k][s];
+				s1[k] = mRotControls[k][s + 1];
+			}
+			// keys are in one hemisphere already
+			slerpFlat(q0, q1, mRotAngles[s], mRotInvSin[s], REAL(1), u, qa);
+			slerpFlat(s0, s1, mCtrlAngles[s], mCtrlInvSin[s], mCtrlSigns[s], u, sa);
+
+			REAL angle, invSin, sign;
+			slerpAngle(quat(qa[0], qa[1], qa[2], qa[3]), quat(sa[0], sa[1], sa[2], sa[3]), angle, invSin, sign);
+			slerpFlat(qa, sa, angle, invSin, sign, mRotSquad[o] * REAL(2) * u * (REAL(1) - u), q);
+
+			const REAL w = q[0], x = q[1], y = q[2], z = q[3];
+			REAL* M = mModelMatrices[o].data();
+			M[0] = 1 - 2 * (y * y + z * z);
+			M[1] = 2 * (x * y + w * z);
+			M[2] = 2 * (x * z - w * y);
+			M[3] = 0;
+			M[4] = 2 * (x * y - w * z);
+			M[5] = 1 - 2 * (x * x + z * z);
+			M[6] = 2 * (y * z + w * x);
+			M[7] = 0;
+			M[8] = 2 * (x * z + w * y);
+			M[9] = 2 * (y * z - w * x);
+			M[10] = 1 - 2 * (x * x + y * y);
+			M[11] = 0;
+		}
+	}
+}
+
+const mat4& AnimationSystem::getModelMatrix(unsigned int idx) const
+{
+	return mModelMatrices[idx];
+}
+
+const std::vector<mat4, Eigen::aligned_allocator<mat4> >& AnimationSystem::getModelMatrices() const
+{
+	return mModelMatrices;
+}
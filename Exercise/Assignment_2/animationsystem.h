@@ -0,0 +1,90 @@
+#ifndef __ANIMATIONSYSTEM_H__
+#define __ANIMATIONSYSTEM_H__
+
+#include "platform.h"
+#include "keyframetrack.h"
+
+/*! AnimationSystem
+ *
+ *  \brief  the translation splines and rotation tracks of many rigid objects
+ *          compiled into flat arrays, one array per key time, spline
+ *          coefficient and quaternion component. evaluate() finds the
+ *          segments of all objects with per object cursors and then runs
+ *          straight line horner and squad loops over the objects (the slerp
+ *          angles between neighbouring keys are precomputed), split
+ *          across threads by OpenMP. The results are written to one
+ *          contiguous array of model matrices, renderables can be bound to
+ *          an object index instead of copying them every frame.
+ */
+class AnimationSystem
+{
+public:
+
+	//! constructor
+	AnimationSystem();
+
+	//! removes all objects
+	void clear();
+
+	//! copies the tracks of an object, returns its index
+	unsigned int addObject(const SplineTrack& path, const RotationTrack& rotation);
+
+	//! get number of objects
+	unsigned int getNumObjects() const;
+
+	//! evaluates all objects at time
+	void evaluate(REAL time);
+
+	//! model matrix of object idx, the address is stable until the next addObject
+	const mat4& getModelMatrix(unsigned int idx) const;
+
+	//! all model matrices in object order
+	const std::vector<mat4, Eigen::aligned_allocator<mat4> >& getModelMatrices() const;
+
+protected:
+
+	//! translation keys of object o: [mPathOffsets[o], mPathOffsets[o+1])
+	std::vector<unsigned int> mPathOffsets;
+
+	std::vector<REAL> mPathTimes;
+
+	//! coefficients a, b, c, d per axis of the segment starting at a key, constant after the last key
+	std::vector<REAL> mPathCoeffs[12];
+
+	//! rotation keys of object o: [mRotOffsets[o], mRotOffsets[o+1]), the last key is repeated
+	std::vector<unsigned int> mRotOffsets;
+
+	std::vector<REAL> mRotTimes;
+
+	//! key quaternions w, x, y, z
+	std::vector<REAL> mRotKeys[4];
+
+	//! squad control quaternions w, x, y, z
+	std::vector<REAL> mRotControls[4];
+
+	//! slerp angle and 1 / sin(angle) from key i to key i+1, 1 / sin is 0 where the keys nearly coincide
+	std::vector<REAL> mRotAngles;
+	std::vector<REAL> mRotInvSin;
+
+	//! the same for the control quaternions, with the sign of the shorter arc
+	std::vector<REAL> mCtrlAngles;
+	std::vector<REAL> mCtrlInvSin;
+	std::vector<REAL> mCtrlSigns;
+
+	//! 1 for squad, 0 for slerp
+	std::vector<REAL> mRotSquad;
+
+	//! segment of the last lookup per object
+	std::vector<unsigned int> mPathCursors;
+	std::vector<unsigned int> mRotCursors;
+
+	//! scratch: global segment index and fraction of the current evaluation
+	std::vector<unsigned int> mPathSegs;
+	std::vector<REAL> mPathU;
+	std::vector<unsigned int> mRotSegs;
+	std::vector<REAL> mRotU;
+
+	std::vector<mat4, Eigen::aligned_allocator<mat4> > mModelMatrices;
+};
+
+#endif //__ANIMATIONSYSTEM_H__
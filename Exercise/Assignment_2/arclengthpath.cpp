@@ -0,0 +1,174 @@
+#include "arclengthpath.h"
+
+// maximum depth of the adaptive quadrature
+#define MAX_QUADRATURE_DEPTH 12
+
+ArcLengthPath::ArcLengthPath()
+{
+	mCoeffs.clear();
+	mDistances.clear();
+	mParameters.clear();
+}
+
+bool ArcLengthPath::init(const SplineTrack& path, unsigned int samplesPerSegment, REAL tolerance)
+{
+	mCoeffs.clear();
+	mDistances.clear();
+	mParameters.clear();
+
+	const unsigned int numSegments = path.getNumSegments();
+	if(numSegments == 0)
+	{
+		PRINTERROR("arc length path needs at least two keys");
+		return false;
+	}
+	samplesPerSegment = std::max(samplesPerSegment, 1u);
+
+	mCoeffs.resize(4 * numSegments);
+	for(unsigned int s = 0; s < numSegments; ++s)
+	{
+		const vec3* c = path.getCoefficients(s);
+		for(unsigned int k = 0; k < 4; ++k)
+			mCoeffs[4 * s + k] = c[k];
+	}
+
+	// the samples of a segment end where the next one starts, only the last segment adds its end
+	REAL distance = 0;
+	mDistances.reserve(numSegments * samplesPerSegment + 1);
+	mParameters.reserve(numSegments * samplesPerSegment + 1);
+	for(unsigned int s = 0; s < numSegments; ++s)
+	{
+		for(unsigned int k = 0; k < samplesPerSegment; ++k)
+		{
+			REAL u0 = REAL(k) / samplesPerSegment;
+			REAL u1 = REAL(k + 1) / samplesPerSegment;
+			mDistances.push_back(distance);
+			mParameters.push_back(s + u0);
+			distance += integrate(s, u0, u1, tolerance / samplesPerSegment);
+		}
+	}
+	mDistances.push_back(distance);
+	mParameters.push_back(REAL(numSegments));
+
+	return true;
+}
+
+REAL ArcLengthPath::getLength() const
+{
+	return mDistances.empty() ? REAL(0) : mDistances.back();
+}
+
+REAL ArcLengthPath::gaussLegendre(unsigned int seg, REAL u0, REAL u1) const
+{
+	static const REAL x[5] = { REAL(0), REAL(-0.5384693101056831), REAL(0.5384693101056831), REAL(-0.9061798459386640), REAL(0.9061798459386640) };
+	static const REAL w[5] = { REAL(0.5688888888888889), REAL(0.4786286704993665), REAL(0.4786286704993665), REAL(0.2369268850561891), REAL(0.2369268850561891) };
+
+	REAL half = REAL(0.5) * (u1 - u0);
+	REAL mid = REAL(0.5) * (u1 + u0);
+	REAL sum = 0;
+	for(unsigned int i = 0; i < 5; ++i)
+		sum += w[i] * speed(seg, mid + half * x[i]);
+
+	return sum * half;
+}
+
+REAL ArcLengthPath::integrateAdaptive(unsigned int seg, REAL u0, REAL u1, REAL whole, REAL tolerance, unsigned int depth) const
+{
+	REAL mid = REAL(0.5) * (u0 + u1);
+	REAL left = gaussLegendre(seg, u0, mid);
+	REAL right = gaussLegendre(seg, mid, u1);
+
+	if(depth == 0 || std::abs(left + right - whole) <= tolerance)
+		return left + right;
+
+	return integrateAdaptive(seg, u0, mid, left, REAL(0.5) * tolerance, depth - 1) +
+		integrateAdaptive(seg, mid, u1, right, REAL(0.5) * tolerance, depth - 1);
+}
+
+REAL ArcLengthPath::integrate(unsigned int seg, REAL u0, REAL u1, REAL tolerance) const
+{
+	return integrateAdaptive(seg, u0, u1, gaussLegendre(seg, u0, u1), tolerance, MAX_QUADRATURE_DEPTH);
+}
+
+REAL ArcLengthPath::speed(unsigned int seg, REAL u) const
+{
+	const vec3* c = &mCoeffs[4 * seg];
+	return ((3 * u * c[0] + 2 * c[1]) * u + c[2]).norm();
+}
+
+REAL ArcLengthPath::getParameter(REAL distance, unsigned int& cursor) const
+{
+	const unsigned int n = mDistances.size();
+	if(n < 2)
+		return 0;
+
+	if(distance <= 0)
+	{
+		cursor = 0;
+		return 0;
+	}
+
+	if(distance >= mDistances[n - 1])
+	{
+		cursor = n - 2;
+		return mParameters[n - 1];
+	}
+
+	// constant speed playback stays in the cursor interval or moves to the next one
+	unsigned int c = (cursor < n - 1) ? cursor : 0;
+	if(mDistances[c] <= distance && distance < mDistances[c + 1])
+	{
+	}
+	else if(c + 2 < n && mDistances[c + 1] <= distance && distance < mDistances[c + 2])
+	{
+		c++;
+	}
+	else
+	{
+		c = (std::upper_bound(mDistances.begin(), mDistances.end(), distance) - mDistances.begin()) - 1;
+	}
+	cursor = c;
+
+	// linear guess inside the interval, refined by one newton step on the arc length
+	unsigned int seg = (unsigned int)mParameters[c];
+	REAL u0 = mParameters[c] - seg;
+	REAL u1 = mParameters[c + 1] - seg;
+	REAL d0 = mDistances[c];
+	REAL d1 = mDistances[c + 1];
+	REAL u = u0 + (u1 - u0) * (distance - d0) / (d1 - d0);
+
+	REAL v = speed(seg, u);
+	if(v > EPSILON)
+		u -= (gaussLegendre(seg, u0, u) - (distance - d0)) / v;
+	u = std::min(std::max(u, u0), u1);
+
+	return seg + u;
+}
+
+void ArcLengthPath::evaluate(REAL distance, unsigned int& cursor, vec3& position) const
+{
+	vec3 tangent;
+	evaluate(distance, cursor, position, tangent);
+}
+
+void ArcLengthPath::evaluate(REAL distance, unsigned int& cursor, vec3& position, vec3& tangent) const
+{
+	if(mCoeffs.empty())
+	{
+		position = vec3::Zero();
+		tangent = vec3::UnitX();
+		return;
+	}
+
+	REAL s = getParameter(distance, cursor);
+	unsigned int seg = std::min((unsigned int)s, (unsigned int)(mCoeffs.size() / 4) - 1);
+	REAL u = s - seg;
+
+	const vec3* c = &mCoeffs[4 * seg];
+	position = ((c[0] * u + c[1]) * u + c[2]) * u + c[3];
+	tangent = (3 * u * c[0] + 2 * c[1]) * u + c[2];
+
+	REAL l = tangent.norm();
+	if(l > EPSILON)
+		tangent /= l;
+}
@@ -0,0 +1,62 @@
+#ifndef __ARCLENGTHPATH_H__
+#define __ARCLENGTHPATH_H__
+
+#include "platform.h"
+#include "keyframetrack.h"
+
+/*! ArcLengthPath
+ *
+ *  \brief  the segments of a SplineTrack reparameterized by arc length.
+ *          On init the length of every segment is sampled into a lookup
+ *          table with adaptive 5 point gauss-legendre quadrature. A distance
+ *          is mapped to the spline parameter by a binary search in the table
+ *          that first tries the interval of the caller's cursor, followed by
+ *          one newton step. The path is not modified by queries, so many
+ *          objects can travel along one shared path, each with its own
+ *          cursor.
+ */
+class ArcLengthPath
+{
+public:
+
+	//! constructor
+	ArcLengthPath();
+
+	//! builds the table from the segments of path, samples per segment and the quadrature tolerance
+	bool init(const SplineTrack& path, unsigned int samplesPerSegment = 16, REAL tolerance = REAL(1e-5));
+
+	//! total length of the path
+	REAL getLength() const;
+
+	//! spline parameter (segment index + u) at distance along the path, cursor is the table interval of the last query
+	REAL getParameter(REAL distance, unsigned int& cursor) const;
+
+	//! position at distance along the path
+	void evaluate(REAL distance, unsigned int& cursor, vec3& position) const;
+
+	//! position and unit tangent at distance along the path
+	void evaluate(REAL distance, unsigned int& cursor, vec3& position, vec3& tangent) const;
+
+protected:
+
+	//! length of segment seg between u0 and u1
+	REAL integrate(unsigned int seg, REAL u0, REAL u1, REAL tolerance) const;
+
+	//! recursive interval halving of integrate
+	REAL integrateAdaptive(unsigned int seg, REAL u0, REAL u1, REAL whole, REAL tolerance, unsigned int depth) const;
+
+	//! 5 point gauss-legendre rule on [u0, u1]
+	REAL gaussLegendre(unsigned int seg, REAL u0, REAL u1) const;
+
+	//! |dp/du| of segment seg
+	REAL speed(unsigned int seg, REAL u) const;
+
+	//! coefficients a, b, c, d of each segment
+	std::vector<vec3> mCoeffs;
+
+	//! table: distance and spline parameter of the samples
+	std::vector<REAL> mDistances;
+	std::vector<REAL> mParameters;
+};
+
+#endif //__ARCLENGTHPATH_H__
@@ -0,0 +1,388 @@
+#include "keyframetrack.h"
+
+KeyTimeline::KeyTimeline()
+	: mCursor(0)
+{
+	mTimes.clear();
+}
+
+void KeyTimeline::clear()
+{
+	mTimes.clear();
+	mCursor = 0;
+}
+
+void KeyTimeline::reserve(unsigned int n)
+{
+	mTimes.reserve(n);
+}
+
+unsigned int KeyTimeline::insert(REAL time)
+{
+	std::vector<REAL>::iterator it = std::upper_bound(mTimes.begin(), mTimes.end(), time);
+	unsigned int idx = it - mTimes.begin();
+	mTimes.insert(it, time);
+	mCursor = 0;
+	return idx;
+}
+
+unsigned int KeyTimeline::getNumKeys() const
+{
+	return mTimes.size();
+}
+
+REAL KeyTimeline::getTime(unsigned int idx) const
+{
+	return mTimes[idx];
+}
+
+bool KeyTimeline::locate(REAL time, unsigned int& seg, REAL& u) const
+{
+	const unsigned int n = mTimes.size();
+	if(n == 0)
+		return false;
+
+	if(n == 1 || time <= mTimes[0])
+	{
+		seg = 0;
+		u = 0;
+		return true;
+	}
+
+	if(time >= mTimes[n - 1])
+	{
+		seg = n - 2;
+		u = 1;
+		return true;
+	}
+
+	// playback moves forward: try the cursor and its successor first
+	unsigned int c = mCursor;
+	if(mTimes[c] <= time && time < mTimes[c + 1])
+	{
+	}
+	else if(c + 2 < n && mTimes[c + 1] <= time && time < mTimes[c + 2])
+	{
+		c++;
+	}
+	else
+	{
+		c = (std::upper_bound(mTimes.begin(), mTimes.end(), time) - mTimes.begin()) - 1;
+		LOGKEY("KeyTimeline: seek to segment " << c << " at time " << time);
+	}
+
+	mCursor = c;
+	seg = c;
+	REAL dt = mTimes[c + 1] - mTimes[c];
+	u = (dt > 0) ? (time - mTimes[c]) / dt : REAL(0);
+
+	return true;
+}
+
+// logarithm of a unit quaternion (pure quaternion as vector)
+static vec3 quatLog(const quat& q)
+{
+	vec3 v = q.vec();
+	REAL s = v.norm();
+	if(ZERO(s))
+		return vec3::Zero();
+	return v * (std::atan2(s, q.w()) / s);
+}
+
+// exponential of a pure quaternion
+static quat quatExp(const vec3& v)
+{
+	REAL a = v.norm();
+	quat q;
+	q.w() = std::cos(a);
+	q.vec() = ZERO(a) ? vec3(v) : vec3(v * (std::sin(a) / a));
+	return q;
+}
+
+RotationTrack::RotationTrack()
+	: mInterpolation(SQUAD)
+{
+	mKeys.clear();
+	mControls.clear();
+}
+
+void RotationTrack::clear()
+{
+	mKeys.clear();
+	mControls.clear();
+	mTimeline.clear();
+}
+
+void RotationTrack::reserve(unsigned int n)
+{
+	mKeys.reserve(n);
+	mControls.reserve(n);
+	mTimeline.reserve(n);
+}
+
+void RotationTrack::addKey(REAL time, const quat& q)
+{
+	unsigned int idx = mTimeline.insert(time);
+	mKeys.insert(mKeys.begin() + idx, q.normalized());
+	mControls.insert(mControls.begin() + idx, quat::Identity());
+
+	// shortest arcs between neighbouring keys, a flip carries on to the following keys
+	const unsigned int n = mKeys.size();
+	if(idx > 0 && mKeys[idx - 1].dot(mKeys[idx]) < 0)
+		mKeys[idx].coeffs() = -mKeys[idx].coeffs();
+	unsigned int last = idx;
+	while(last + 1 < n && mKeys[last].dot(mKeys[last + 1]) < 0)
+	{
+		++last;
+		mKeys[last].coeffs() = -mKeys[last].coeffs();
+	}
+
+	// a control depends on the key and its two neighbours
+	updateControls((idx > 0) ? idx - 1 : 0, std::min(last + 1, n - 1));
+}
+
+void RotationTrack::addKey(const Keyframe& key)
+{
+	addKey(REAL(key.time), fromFixedAngles(key.rotX, key.rotY, key.rotZ));
+}
+
+unsigned int RotationTrack::getNumKeys() const
+{
+	return mKeys.size();
+}
+
+void RotationTrack::setInterpolation(Interpolation mode)
+{
+	mInterpolation = mode;
+}
+
+RotationTrack::Interpolation RotationTrack::getInterpolation() const
+{
+	return mInterpolation;
+}
+
+const quat& RotationTrack::getKey(unsigned int idx) const
+{
+	return mKeys[idx];
+}
+
+const quat& RotationTrack::getControl(unsigned int idx) const
+{
+	return mControls[idx];
+}
+
+const KeyTimeline& RotationTrack::getTimeline() const
+{
+	return mTimeline;
+}
+
+quat RotationTrack::fromFixedAngles(REAL x, REAL y, REAL z)
+{
+	const REAL degToRad = REAL(M_PI / 180.0);
+	return quat(anax(z * degToRad, vec3::UnitZ()) * anax(y * degToRad, vec3::UnitY()) * anax(x * degToRad, vec3::UnitX()));
+}
+
+void RotationTrack::updateControls(unsigned int first, unsigned int last)
+{
+	const unsigned int n = mKeys.size();
+
+	// s_i = q_i exp(-(log(q_i^-1 q_i+1) + log(q_i^-1 q_i-1)) / 4)
+	for(unsigned int i = first; i <= last; ++i)
+	{
+		if(i == 0 || i == n - 1)
+		{
+			mControls[i] = mKeys[i];
+			continue;
+		}
+		quat inv = mKeys[i].conjugate();
+		vec3 l = quatLog(inv * mKeys[i + 1]) + quatLog(inv * mKeys[i - 1]);
+		mControls[i] = mKeys[i] * quatExp(REAL(-0.25) * l);
+	}
+}
+
+bool RotationTrack::evaluate(REAL time, quat& q) const
+{
+	unsigned int i;
+	REAL u;
+	if(!mTimeline.locate(time, i, u))
+		return false;
+
+	unsigned int j = std::min(i + 1, (unsigned int)mKeys.size() - 1);
+	q = mKeys[i].slerp(u, mKeys[j]);
+	if(mInterpolation == SQUAD)
+	{
+		quat s = mControls[i].slerp(u, mControls[j]);
+		q = q.slerp(REAL(2) * u * (REAL(1) - u), s);
+	}
+
+	return true;
+}
+
+SplineTrack::SplineTrack()
+	: mType(CATMULL_ROM)
+{
+	mPositions.clear();
+	mTangents.clear();
+	mTCB.clear();
+}
+
+void SplineTrack::clear()
+{
+	mPositions.clear();
+	mTangents.clear();
+	mTCB.clear();
+	mCoeffs.clear();
+	mInvDurations.clear();
+	mTimeline.clear();
+}
+
+void SplineTrack::reserve(unsigned int n)
+{
+	mPositions.reserve(n);
+	mTangents.reserve(n);
+	mTCB.reserve(n);
+	mTimeline.reserve(n);
+	mCoeffs.reserve(4 * n);
+	mInvDurations.reserve(n);
+}
+
+void SplineTrack::addKey(REAL time, const vec3& position, const vec3& tangent)
+{
+	unsigned int idx = mTimeline.insert(time);
+	mPositions.insert(mPositions.begin() + idx, position);
+	mTangents.insert(mTangents.begin() + idx, tangent);
+	mTCB.insert(mTCB.begin() + idx, vec3::Zero());
+	insertSegment(idx);
+}
+
+void SplineTrack::addKey(REAL time, const vec3& position, REAL tension, REAL continuity, REAL bias)
+{
+	unsigned int idx = mTimeline.insert(time);
+	mPositions.insert(mPositions.begin() + idx, position);
+	mTangents.insert(mTangents.begin() + idx, vec3::Zero());
+	mTCB.insert(mTCB.begin() + idx, vec3(tension, continuity, bias));
+	insertSegment(idx);
+}
+
+unsigned int SplineTrack::getNumKeys() const
+{
+	return mPositions.size();
+}
+
+void SplineTrack::setType(Type type)
+{
+	mType = type;
+	if(!mInvDurations.empty())
+		updateSegments(0, mInvDurations.size() - 1);
+}
+
+unsigned int SplineTrack::getNumSegments() const
+{
+	return mInvDurations.size();
+}
+
+const vec3* SplineTrack::getCoefficients(unsigned int seg) const
+{
+	return &mCoeffs[4 * seg];
+}
+
+const KeyTimeline& SplineTrack::getTimeline() const
+{
+	return mTimeline;
+}
+
+void SplineTrack::insertSegment(unsigned int idx)
+{
+	const unsigned int n = mPositions.size();
+	if(n < 2)
+		return;
+
+	// the new key splits a segment or appends one at an end, later segments move up by one
+	unsigned int seg = std::min(idx, n - 2);
+	mCoeffs.insert(mCoeffs.begin() + 4 * seg, 4, vec3::Zero());
+	mInvDurations.insert(mInvDurations.begin() + seg, REAL(0));
+
+	// a segment uses the keys from one before to two after its start
+	updateSegments((idx > 2) ? idx - 2 : 0, std::min(idx + 1, n - 2));
+}
+
+void SplineTrack::updateSegments(unsigned int first, unsigned int last)
+{
+	const unsigned int n = mPositions.size();
+
+	for(unsigned int i = first; i <= last; ++i)
+	{
+		const vec3& p0 = mPositions[i];
+		const vec3& p1 = mPositions[i + 1];
+		REAL dt = mTimeline.getTime(i + 1) - mTimeline.getTime(i);
+
+		// tangents with respect to u
+		vec3 m0, m1;
+		if(mType == HERMITE)
+		{
+			m0 = mTangents[i] * dt;
+			m1 = mTangents[i + 1] * dt;
+		}
+		else
+		{
+			// missing neighbours at the ends are mirrored, neighbour spacing falls back to dt
+			vec3 pPrev = (i > 0) ? mPositions[i - 1] : vec3(2 * p0 - p1);
+			vec3 pNext = (i + 2 < n) ? mPositions[i + 2] : vec3(2 * p1 - p0);
+			REAL dtPrev = (i > 0) ? mTimeline.getTime(i) - mTimeline.getTime(i - 1) : dt;
+			REAL dtNext = (i + 2 < n) ? mTimeline.getTime(i + 2) - mTimeline.getTime(i + 1) : dt;
+
+			// catmull-rom is kochanek-bartels with zero tension, continuity and bias
+			vec3 tcb0 = (mType == KOCHANEK_BARTELS) ? mTCB[i] : vec3::Zero();
+			vec3 tcb1 = (mType == KOCHANEK_BARTELS) ? mTCB[i + 1] : vec3::Zero();
+
+			// outgoing tangent of key i
+			REAL t = tcb0[0], c = tcb0[1], b = tcb0[2];
+			m0 = REAL(0.5) * (1 - t) * ((1 + b) * (1 - c) * (p0 - pPrev) + (1 - b) * (1 + c) * (p1 - p0));
+			m0 *= (dtPrev + dt > 0) ? 2 * dt / (dtPrev + dt) : REAL(0);
+
+			// incoming tangent of key i+1
+			t = tcb1[0]; c = tcb1[1]; b = tcb1[2];
+			m1 = REAL(0.5) * (1 - t) * ((1 + b) * (1 + c) * (p1 - p0) + (1 - b) * (1 - c) * (pNext - p1));
+			m1 *= (dt + dtNext > 0) ? 2 * dt / (dt + dtNext) : REAL(0);
+		}
+
+		vec3* coeffs = &mCoeffs[4 * i];
+		coeffs[0] = 2 * (p0 - p1) + m0 + m1;
+		coeffs[1] = 3 * (p1 - p0) - 2 * m0 - m1;
+		coeffs[2] = m0;
+		coeffs[3] = p0;
+		mInvDurations[i] = (dt > 0) ? REAL(1) / dt : REAL(0);
+	}
+}
+
+bool SplineTrack::evaluate(REAL time, vec3& position) const
+{
+	vec3 velocity;
+	return evaluate(time, position, velocity);
+}
+
+bool SplineTrack::evaluate(REAL time, vec3& position, vec3& velocity) const
+{
+	unsigned int i;
+	REAL u;
+	if(!mTimeline.locate(time, i, u))
+		return false;
+
+	if(mInvDurations.empty())
+	{
+		position = mPositions[0];
+		velocity = vec3::Zero();
+		return true;
+	}
+
+	const vec3* c = &mCoeffs[4 * i];
+	position = ((c[0] * u + c[1]) * u + c[2]) * u + c[3];
+
+	bool inside = time >= mTimeline.getTime(0) && time < mTimeline.getTime(mPositions.size() - 1);
+	if(inside)
+		velocity = ((3 * u * c[0] + 2 * c[1]) * u + c[2]) * mInvDurations[i];
+	else
+		velocity = vec3::Zero();
+
+	return true;
+}
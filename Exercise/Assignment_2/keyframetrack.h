@@ -0,0 +1,242 @@
+#ifndef __KEYFRAMETRACK_H__
+#define __KEYFRAMETRACK_H__
+
+#include "platform.h"
+
+// per lookup diagnostics, build with -DKEYFRAME_DEBUG to get them
+#ifdef KEYFRAME_DEBUG
+ #define LOGKEY(x) LOG(x)
+#else
+ #define LOGKEY(x)
+#endif
+
+// structure defining an keyframe
+struct Keyframe
+{
+	unsigned int time;	// minimum keyframe, this animation is valid
+	vec3 translation;	//
+	float rotX;         // rotation about global x
+	float rotY;         // rotation about global y
+	float rotZ;         // rotation about global z
+
+	Keyframe()
+	{
+		time = 0;
+		translation = vec3::Zero();
+		rotX = rotY = rotZ = 0.0f;
+	}
+
+	Keyframe(unsigned int t, const vec3& trans, float x, float y, float z)
+	{
+		time = t;
+		translation = trans;
+		rotX = x;
+		rotY = y;
+		rotZ = z;
+	}
+
+	Keyframe(const Keyframe& other)
+	{
+		time = other.time;
+		translation = other.translation;
+		rotX = other.rotX;
+		rotY = other.rotY;
+		rotZ = other.rotZ;
+	}
+
+	bool operator<(const Keyframe& rhs) const { return (time < rhs.time); }
+};
+
+/*! KeyTimeline
+ *
+ *  \brief  sorted key times with a cursor on the segment of the last lookup.
+ *          Monotonic playback finds its segment at the cursor or the one
+ *          after it in O(1), seeks fall back to a binary search.
+ */
+class KeyTimeline
+{
+public:
+
+	//! constructor
+	KeyTimeline();
+
+	//! removes all times
+	void clear();
+
+	//! preallocates n times, sorted inserts then only append
+	void reserve(unsigned int n);
+
+	//! inserts a time behind all equal times, returns its index
+	unsigned int insert(REAL time);
+
+	//! get number of keys
+	unsigned int getNumKeys() const;
+
+	//! time of key idx
+	REAL getTime(unsigned int idx) const;
+
+	//! finds the segment [seg, seg+1] around time and the fraction u in it, time is clamped to the keys
+	bool locate(REAL time, unsigned int& seg, REAL& u) const;
+
+protected:
+
+	std::vector<REAL> mTimes;
+
+	//! segment of the last lookup
+	mutable unsigned int mCursor;
+};
+
+/*! RotationTrack
+ *
+ *  \brief  quaternion keys interpolated by slerp or squad. Keys are flipped
+ *          into one hemisphere and the squad control quaternions are
+ *          updated around every inserted key, so the const getters and
+ *          evaluate() never write and an evaluation is a segment lookup and
+ *          a fixed number of slerps.
+ */
+class RotationTrack
+{
+public:
+
+	enum Interpolation
+	{
+		SLERP = 0,
+		SQUAD
+	};
+
+	//! constructor
+	RotationTrack();
+
+	//! removes all keys
+	void clear();
+
+	//! preallocates n keys
+	void reserve(unsigned int n);
+
+	//! inserts a rotation key keeping the time order
+	void addKey(REAL time, const quat& q);
+
+	//! inserts the fixed angle rotation of an euler keyframe
+	void addKey(const Keyframe& key);
+
+	//! get number of keys
+	unsigned int getNumKeys() const;
+
+	//! select slerp or squad
+	void setInterpolation(Interpolation mode);
+
+	//! get the interpolation mode
+	Interpolation getInterpolation() const;
+
+	//! key idx, flipped into the hemisphere of its predecessor
+	const quat& getKey(unsigned int idx) const;
+
+	//! squad control quaternion of key idx
+	const quat& getControl(unsigned int idx) const;
+
+	//! the key times
+	const KeyTimeline& getTimeline() const;
+
+	//! interpolated rotation at time
+	bool evaluate(REAL time, quat& q) const;
+
+	//! fixed angles in degrees: about global x, then global y, then global z
+	static quat fromFixedAngles(REAL x, REAL y, REAL z);
+
+protected:
+
+	//! squad controls of the keys first to last
+	void updateControls(unsigned int first, unsigned int last);
+
+	std::vector<quat, Eigen::aligned_allocator<quat> > mKeys;
+
+	std::vector<quat, Eigen::aligned_allocator<quat> > mControls;
+
+	KeyTimeline mTimeline;
+
+	Interpolation mInterpolation;
+};
+
+/*! SplineTrack
+ *
+ *  \brief  cubic translation track. Tangents come from the keys (hermite) or
+ *          from the neighbouring keys (catmull-rom, kochanek-bartels) and are
+ *          scaled for uneven key spacing. Inserting a key converts the
+ *          segments around it to the coefficients of
+ *          p(u) = ((a*u + b)*u + c)*u + d with u in [0,1], so an evaluation
+ *          is a segment lookup and a horner scheme per axis and never writes.
+ */
+class SplineTrack
+{
+public:
+
+	enum Type
+	{
+		HERMITE = 0,
+		CATMULL_ROM,
+		KOCHANEK_BARTELS
+	};
+
+	//! constructor
+	SplineTrack();
+
+	//! removes all keys
+	void clear();
+
+	//! preallocates n keys
+	void reserve(unsigned int n);
+
+	//! inserts a position key, tangent (per time unit) is only used by hermite
+	void addKey(REAL time, const vec3& position, const vec3& tangent = vec3::Zero());
+
+	//! inserts a position key with tension, continuity and bias for kochanek-bartels
+	void addKey(REAL time, const vec3& position, REAL tension, REAL continuity, REAL bias);
+
+	//! get number of keys
+	unsigned int getNumKeys() const;
+
+	//! select how the tangents are computed
+	void setType(Type type);
+
+	//! position at time
+	bool evaluate(REAL time, vec3& position) const;
+
+	//! position and velocity (per time unit) at time, the velocity is zero outside the keys
+	bool evaluate(REAL time, vec3& position, vec3& velocity) const;
+
+	//! get number of cubic segments
+	unsigned int getNumSegments() const;
+
+	//! the coefficients a, b, c, d of segment seg
+	const vec3* getCoefficients(unsigned int seg) const;
+
+	//! the key times
+	const KeyTimeline& getTimeline() const;
+
+protected:
+
+	//! makes room for the segments of key idx and updates its neighbourhood
+	void insertSegment(unsigned int idx);
+
+	//! computes the polynomials of the segments first to last
+	void updateSegments(unsigned int first, unsigned int last);
+
+	std::vector<vec3> mPositions;
+
+	std::vector<vec3> mTangents;
+
+	//! tension, continuity, bias per key
+	std::vector<vec3> mTCB;
+
+	KeyTimeline mTimeline;
+
+	Type mType;
+
+	//! four coefficients per segment
+	std::vector<vec3> mCoeffs;
+
+	//! 1 / duration of each segment
+	std::vector<REAL> mInvDurations;
+};
+
+#endif //__KEYFRAMETRACK_H__
@@ -7,52 +7,24 @@
 #include "surface.h"
 #include "camera.h"
 #include "light.h"
+#include "keyframetrack.h"
+#include "animationsystem.h"
+#include "playbackclock.h"
+#include "arclengthpath.h"
+#include "animationfile.h"
+#include "scenegraph.h"
+#include <chrono>
 
 #define WIDTH 1024
 #define HEIGHT 768
 #define NUM_SAMPLES 4
 #define POINT_RADIUS 0.003
+#define KEYS_PER_SECOND 1.0f
+#define PROP_REVOLUTIONS_PER_SECOND 4.0
 
 //use this macro to convert from degrees to radiants
 #define DEG_TO_RAD(x) { x*0.01745f }
 
-// structure defining an keyframe
-struct Keyframe
-{
-	unsigned int time;	// minimum keyframe, this animation is valid
-	vec3 translation;	//
-	float rotX;         // rotation about global x
-	float rotY;         // rotation about global y
-	float rotZ;         // rotation about global z
-
-	Keyframe()
-	{
-		time = 0;
-		translation = vec3::Zero();
-		rotX = rotY = rotZ = 0.0f;
-	}
-
-	Keyframe(unsigned int t, const vec3& trans, float x, float y, float z)
-	{
-		time = t;
-		translation = trans;
-		rotX = x;
-		rotY = y;
-		rotZ = z;
-	}
-
-	Keyframe(const Keyframe& other)
-	{
-		time = other.time;
-		translation = other.translation;
-		rotX = other.rotX;
-		rotY = other.rotY;
-		rotZ = other.rotZ;
-	}
-
-	bool operator<(const Keyframe& rhs) { return (time < rhs.time); }
-};
-
 // structure to represent a rigid object with its
 // transformation (rotation and translation)
 struct RObject
@@ -64,8 +36,15 @@ struct RObject
 	std::vector<ivec3> triangles;
 	mat4 modelMatrix;
 
-	// the animation sequence
-	std::vector<Keyframe> animation;
+	// the rotations of the animation keys as quaternions
+	RotationTrack rotation;
+
+	// catmull-rom spline through the key translations
+	SplineTrack path;
+
+	// the spline by arc length for constant speed, and the table interval of the last lookup
+	ArcLengthPath arcPath;
+	unsigned int arcCursor;
 
 	RObject()
 	{
@@ -73,7 +52,9 @@ struct RObject
 		normals.clear();
 		triangles.clear();
 		modelMatrix = mat4::Identity();
-		animation.clear();
+		rotation.clear();
+		path.clear();
+		arcCursor = 0;
 	}
 
 	RObject(const RObject& rhs)
@@ -82,64 +63,86 @@ struct RObject
 		normals = rhs.normals;
 		triangles = rhs.triangles;
 		modelMatrix = rhs.modelMatrix;
-		animation = rhs.animation;
+		rotation = rhs.rotation;
+		path = rhs.path;
+		arcPath = rhs.arcPath;
+		arcCursor = rhs.arcCursor;
+	}
+
+	void addKeyframe(const Keyframe& key)
+	{
+		rotation.addKey(key);
+		path.addKey(REAL(key.time), key.translation);
 	}
 
 	void interpolateTransformation(unsigned int currentFrame)
 	{
-		mat3 R = mat3::Identity();
 		vec3 t = vec3::Zero();
-		vec3 a = vec3::Zero();
-		float u;
-		float denominador;
-		int i = 0;
-		int j = 1;
-
-		//procurando keyframes vizinhos
-		if (currentFrame >= animation[animation.size() - 1].time)
-			i = j = animation.size() -1;
-		else{
-			for (; i < animation.size(); i++){
-				j = (i+1) % animation.size();
-				if ((animation[i].time <= currentFrame) && (animation[j].time >= currentFrame))
-					break;
-			}
-		}
-
-		std::cerr << "current frame / keyframe anterior / posterior: \n" << currentFrame << i << j << std::endl;
-		//calculando parte fracionária entre frames
-		denominador = (float)(animation[i].time - animation[j].time);
-		if (denominador != 0)
-			u = (currentFrame - animation[i].time) / denominador;
-		/*else*/
+		quat q;
+		if (!path.evaluate(REAL(currentFrame), t) || !rotation.evaluate(REAL(currentFrame), q))
+			return;
 
-		//interpolando a translação
-		t = ((1-u)*animation[i].translation + u*animation[j].translation);
+		LOGKEY("frame " << currentFrame << " translation " << t.transpose() << " rotation " << q.coeffs().transpose());
 
-		a[0] = ((1-u)*animation[i].rotX + u*animation[j].rotX);
-		a[1] = ((1-u)*animation[i].rotY + u*animation[j].rotY);
-		a[2] = ((1-u)*animation[i].rotZ + u*animation[j].rotZ);
+		// squad between the fixed angle key rotations
+		mat3 R = q.toRotationMatrix();
 
-		R = 
+		modelMatrix << R, t, 0, 0, 0, 1;
+	}
 
-		// TODO - Assignment 2.2 (e): construct rotation matrix (use fixed angles approach)
-		R = matriz de rotação x t x 0001 (col)
-		// TODO: set the 4x4 transformation matrix
+	// replaces the translation of M by the point at the same fraction of the path length
+	void moveAlongPath(REAL fraction, mat4& M)
+	{
+		vec3 t;
+		arcPath.evaluate(fraction * arcPath.getLength(), arcCursor, t);
+		M.block<3, 1>(0, 3) = t;
 	}
 };
 
 Renderer* renderer;
 ArcballCamera* camera;
 RObject* roAircraft;
-unsigned int frame;
+RObject* roProp;
+
+// wall clock playback: simulated animation time of the last two steps in key units
+PlaybackClock playback;
+REAL simulationTime;
+REAL previousTime;
+REAL animationDuration;
+REAL animationStart;
+bool constantSpeed;
+
+// all animated rigids, evaluated in one pass per frame
+AnimationSystem animations;
+unsigned int aircraftAnimation;
+
+// the propeller is a child of the aircraft, turning about its hub
+SceneGraph scene;
+int aircraftNode;
+int propNode;
+mat4 propHub;
 
 void init(void)
 {
 	//reset global application state
-	frame = 0;
+	simulationTime = 0;
+	previousTime = 0;
+	animationDuration = 0;
+	animationStart = 0;
+	constantSpeed = true;
+	playback.reset();
+	playback.setStepRate(REAL(120));
+	playback.setTargetFrameRate(REAL(60));
 
 	// init object emtpy
 	roAircraft = new RObject();
+	roProp = new RObject();
+
+	// transform hierarchy
+	scene.clear();
+	aircraftNode = scene.addNode("aircraft", -1);
+	propNode = scene.addNode("prop", aircraftNode);
+	propHub = mat4::Identity();
 
 	// init camera
 	camera = new ArcballCamera();
@@ -179,9 +182,37 @@ void init(void)
 	lDesc.direction = vec3(0, -1, 0);
 	renderer->addLight("light1", lDesc);
 
-	// init animation for rigid airplane
-	roAircraft->animation.push_back(Keyframe(0, vec3(0, 0, 0), 0.f, 0.f, 0));
-	roAircraft->animation.push_back(Keyframe(1, vec3(3, 2, 1), 0, 0, 1));
+	// init animation for rigid airplane, prefer the binary animation, then the text one
+	std::chrono::high_resolution_clock::time_point loadStart = std::chrono::high_resolution_clock::now();
+	AnimationFile animationFile;
+	bool loaded = false;
+	if (std::ifstream("../Media/aircraft.animb").good())
+		loaded = animationFile.loadBinary("../Media/aircraft.animb");
+	if (!loaded)
+		loaded = animationFile.loadText("../Media/aircraft.anim");
+
+	int aircraftObject = loaded ? animationFile.findObject("aircraft") : -1;
+	if (aircraftObject >= 0 && animationFile.fillTracks(aircraftObject, &roAircraft->path, &roAircraft->rotation))
+	{
+		double loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+		LOG("loaded " << animationFile.getNumKeys(aircraftObject) << " aircraft keys in " << loadTime << " ms");
+	}
+	else
+	{
+		roAircraft->rotation.clear();
+		roAircraft->path.clear();
+		roAircraft->addKeyframe(Keyframe(0, vec3(0, 0, 0), 0.f, 0.f, 0));
+		roAircraft->addKeyframe(Keyframe(1, vec3(3, 2, 1), 0, 0, 1));
+	}
+	aircraftAnimation = animations.addObject(roAircraft->path, roAircraft->rotation);
+	roAircraft->arcPath.init(roAircraft->path);
+	roAircraft->arcCursor = 0;
+
+	const KeyTimeline& times = roAircraft->path.getTimeline();
+	if (times.getNumKeys() > 0)
+		animationStart = times.getTime(0);
+	if (times.getNumKeys() > 1)
+		animationDuration = times.getTime(times.getNumKeys() - 1) - times.getTime(0);
 
 
 	glutPostRedisplay();
@@ -189,17 +220,28 @@ void init(void)
 
 void importMesh()
 {
-	if (roAircraft == NULL)
+	if (roAircraft == NULL || roProp == NULL)
 		return;
 
 	// load model
-	if (!importTriangleMeshFromOFF("../Media/aircraft.off", roAircraft->vertices, roAircraft->triangles))
+	if (!importTriangleMeshFromOFF("../Media/aircraft_propless.off", roAircraft->vertices, roAircraft->triangles))
 	{
-		LOG("failed to load ../Media/aircraft.off");
+		LOG("failed to load ../Media/aircraft_propless.off");
 		exit(1);
 	}
-	centerMesh(roAircraft->vertices);
+	if (!importTriangleMeshFromOFF("../Media/prop.off", roProp->vertices, roProp->triangles))
+	{
+		LOG("failed to load ../Media/prop.off");
+		exit(1);
+	}
+
+	// both meshes share the aircraft frame, the prop is moved to its hub
+	vec3 cog = centerMesh(roAircraft->vertices, roAircraft->vertices);
+	offsetMesh(roProp->vertices, cog);
+	vec3 hub = centerMesh(roProp->vertices, roProp->vertices);
+	propHub.block<3, 1>(0, 3) = hub;
 	computeTriangleMeshNormals(roAircraft->vertices, roAircraft->triangles, roAircraft->normals);
+	computeTriangleMeshNormals(roProp->vertices, roProp->triangles, roProp->normals);
 
 	Renderable *pt = renderer->getPtRenderable("mesh");
 	if (!pt)
@@ -207,6 +249,20 @@ void importMesh()
 	else
 		pt->updateVerticesAndNormals(roAircraft->vertices, roAircraft->normals);
 
+	pt = renderer->getPtRenderable("prop");
+	if (!pt)
+		renderer->addRenderable("prop", roProp->vertices, roProp->triangles, "mesh", roProp->modelMatrix);
+	else
+		pt->updateVerticesAndNormals(roProp->vertices, roProp->normals);
+
+	// the renderer reads the model matrices from the scene graph
+	pt = renderer->getPtRenderable("mesh");
+	if (pt)
+		pt->setModelMatrixSource(&scene, aircraftNode);
+	pt = renderer->getPtRenderable("prop");
+	if (pt)
+		pt->setModelMatrixSource(&scene, propNode);
+
 	glutPostRedisplay();
 }
 
@@ -228,11 +284,6 @@ void display(void)
 	renderer->getPtLight("light1")->setPosition(lPos);
 	renderer->getPtLight("light1")->setDirection(lDir);
 
-	// update render mesh from rigid
-	Renderable* pt = renderer->getPtRenderable("mesh");
-	if (pt)
-		pt->setModelMatrix(roAircraft->modelMatrix);
-
 	// render the scene
 	renderer->render((Camera*)camera);
 
@@ -250,13 +301,46 @@ void resize(int w, int h)
 
 void idle()
 {
-	roAircraft->interpolateTransformation(frame);
+	// advance time in fixed steps of wall clock time
+	unsigned int steps = playback.beginFrame();
+	for (unsigned int i = 0; i < steps; ++i)
+	{
+		previousTime = simulationTime;
+		simulationTime += playback.getStepSize() * KEYS_PER_SECOND;
+	}
 
-	// TODO - Assignment 2.2 (a): Advance time
+	// cyclic animation: both steps wrap together so they stay ordered
+	if (animationDuration > 0 && previousTime >= animationDuration)
+	{
+		previousTime -= animationDuration;
+		simulationTime -= animationDuration;
+	}
+
+	// render state between the last two steps, the playback time counts from the first key
+	REAL t = previousTime + playback.getAlpha() * (simulationTime - previousTime);
+	if (animationDuration > 0 && t >= animationDuration)
+		t -= animationDuration;
+	animations.evaluate(animationStart + t);
 
-	// TODO - Assignment 2.2 (b): Implement a cyclic animation
+	// the rotation keeps the key times, the translation moves at constant speed over the loop
+	mat4 M = animations.getModelMatrix(aircraftAnimation);
+	if (constantSpeed && animationDuration > 0)
+		roAircraft->moveAlongPath(t / animationDuration, M);
+	scene.setLocalTransform(aircraftNode, M);
+
+	// the prop turns with playback time, not with the cyclic animation time
+	double playbackTime = (playback.getNumSteps() + playback.getAlpha()) * playback.getStepSize();
+	REAL propAngle = REAL(std::fmod(playbackTime * PROP_REVOLUTIONS_PER_SECOND, 1.0) * 2.0 * M_PI);
+	mat4 propSpin = mat4::Identity();
+	propSpin.block<3, 3>(0, 0) = mat3(anax(propAngle, vec3::UnitZ()));
+	scene.setLocalTransform(propNode, propHub * propSpin);
+
+	scene.update();
 
 	glutPostRedisplay();
+
+	// sleep instead of spinning when ahead of the target frame rate
+	playback.endFrame();
 }
 
 void mouseButton(int button, int state, int x, int y)
@@ -310,10 +394,142 @@ void mouseWheel(int button, int dir, int x, int y)
 	glutPostRedisplay();
 }
 
+// compares per object evaluation with the batched animation system on a fleet of aircraft
+void benchmarkAnimation()
+{
+	const unsigned int numObjects = 10000;
+	const unsigned int numKeys = 8;
+	const unsigned int numFrames = 100;
+
+	std::vector<RObject*> fleet(numObjects);
+	AnimationSystem system;
+	srand(0);
+	for (unsigned int o = 0; o < numObjects; ++o)
+	{
+		fleet[o] = new RObject();
+		for (unsigned int k = 0; k < numKeys; ++k)
+		{
+			vec3 t = vec3::Random() * REAL(10);
+			vec3 a = vec3::Random() * REAL(180);
+			fleet[o]->addKeyframe(Keyframe(k * 10 + rand() % 5, t, a[0], a[1], a[2]));
+		}
+		system.addObject(fleet[o]->path, fleet[o]->rotation);
+	}
+
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+	for (unsigned int f = 0; f < numFrames; ++f)
+		for (unsigned int o = 0; o < numObjects; ++o)
+			fleet[o]->interpolateTransformation(f);
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	for (unsigned int f = 0; f < numFrames; ++f)
+		system.evaluate(REAL(f));
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+	REAL maxDiff = 0;
+	for (unsigned int o = 0; o < numObjects; ++o)
+		maxDiff = std::max(maxDiff, (fleet[o]->modelMatrix - system.getModelMatrix(o)).cwiseAbs().maxCoeff());
+
+	double perObject = std::chrono::duration<double, std::milli>(t1 - t0).count() / numFrames;
+	double batched = std::chrono::duration<double, std::milli>(t2 - t1).count() / numFrames;
+	LOG("animation of " << numObjects << " objects per frame: per object " << perObject << " ms, batched " << batched << " ms, max difference " << maxDiff);
+
+	for (unsigned int o = 0; o < numObjects; ++o)
+		delete fleet[o];
+}
+
+// speed variation of parameter and arc length traversal, and lookup cost for many objects on one path
+void benchmarkArcLength()
+{
+	const unsigned int numKeys = 10;
+	const unsigned int numSteps = 1000;
+	const unsigned int numObjects = 1000;
+
+	SplineTrack track;
+	srand(0);
+	for (unsigned int k = 0; k < numKeys; ++k)
+		track.addKey(REAL(k * 10 + rand() % 5), vec3::Random() * REAL(10));
+
+	ArcLengthPath path;
+	if (!path.init(track))
+		return;
+	LOG("arc length path: " << track.getNumSegments() << " segments, length " << path.getLength());
+
+	// step lengths for equal steps in time and in distance
+	const KeyTimeline& times = track.getTimeline();
+	REAL t0 = times.getTime(0);
+	REAL t1 = times.getTime(numKeys - 1);
+	REAL minTime = std::numeric_limits<REAL>::max(), maxTime = 0;
+	REAL minDist = std::numeric_limits<REAL>::max(), maxDist = 0;
+	unsigned int cursor = 0;
+	vec3 pTime, pDist;
+	track.evaluate(t0, pTime);
+	path.evaluate(0, cursor, pDist);
+	for (unsigned int i = 1; i <= numSteps; ++i)
+	{
+		vec3 p;
+		track.evaluate(t0 + (t1 - t0) * i / numSteps, p);
+		REAL d = (p - pTime).norm();
+		minTime = std::min(minTime, d);
+		maxTime = std::max(maxTime, d);
+		pTime = p;
+
+		path.evaluate(path.getLength() * i / numSteps, cursor, p);
+		d = (p - pDist).norm();
+		minDist = std::min(minDist, d);
+		maxDist = std::max(maxDist, d);
+		pDist = p;
+	}
+	LOG("step length by time " << minTime << " - " << maxTime << ", by distance " << minDist << " - " << maxDist);
+
+	// many objects on the shared path, each with its own cursor
+	std::vector<unsigned int> cursors(numObjects, 0);
+	vec3 sum = vec3::Zero();
+	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < numSteps; ++i)
+	{
+		for (unsigned int o = 0; o < numObjects; ++o)
+		{
+			vec3 p;
+			path.evaluate(std::fmod(path.getLength() * o / numObjects + REAL(0.05) * i, path.getLength()), cursors[o], p);
+			sum += p;
+		}
+	}
+	std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
+	double lookup = std::chrono::duration<double, std::nano>(end - start).count() / (numSteps * numObjects);
+	LOG("arc length lookup " << lookup << " ns (checksum " << sum.norm() << ")");
+}
+
 void key(unsigned char key, int x, int y)
 {
 	switch (key) {
 
+	case 'b':
+		benchmarkAnimation();
+		break;
+
+	case 'l':
+		benchmarkArcLength();
+		break;
+
+	case 'a': // aircraft translation at constant speed or by the key times
+		constantSpeed = !constantSpeed;
+		LOG("aircraft " << (constantSpeed ? "at constant speed" : "by the key times"));
+		break;
+
+	case '+':
+		playback.setTargetFrameRate(playback.getTargetFrameRate() + REAL(10));
+		LOG("target frame rate " << playback.getTargetFrameRate());
+		break;
+
+	case '-':
+		playback.setTargetFrameRate(playback.getTargetFrameRate() - REAL(10));
+		LOG("target frame rate " << playback.getTargetFrameRate());
+		break;
+
+	case 's':
+		LOG("frames " << playback.getNumFrames() << ", frame time " << playback.getFrameTime() << " ms (avg " << playback.getAverageFrameTime() << ", max " << playback.getMaxFrameTime() << "), steps " << playback.getNumSteps() << " (last frame " << playback.getNumFrameSteps() << "), dropped " << playback.getDroppedTime() << " s, slept " << playback.getSleepTime() << " s");
+		break;
+
 	case 27: // ESCAPE KEY
 		shutdown();
 		exit(0);
@@ -327,6 +543,16 @@ void key(unsigned char key, int x, int y)
 
 int main(int argc, char** argv)
 {
+	// Application2 <text animation> <binary animation> converts without opening a window
+	if (argc > 2)
+	{
+		AnimationFile animationFile;
+		if (!animationFile.loadText(argv[1]) || !animationFile.saveBinary(argv[2]))
+			return 1;
+		LOG("converted " << argv[1] << " to " << argv[2]);
+		return 0;
+	}
+
 	// init window and gl
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
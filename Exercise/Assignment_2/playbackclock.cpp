@@ -0,0 +1,153 @@
+#include "playbackclock.h"
+#include <thread>
+
+PlaybackClock::PlaybackClock()
+	: mStepSize(1.0 / 120.0),
+	  mTargetFrameRate(60.0),
+	  mMaxStepsPerFrame(8)
+{
+	reset();
+}
+
+void PlaybackClock::reset()
+{
+	mRunning = false;
+	mAccumulator = 0;
+	mFrameTime = 0;
+	mAverageFrameTime = 0;
+	mMaxFrameTime = 0;
+	mNumFrameSteps = 0;
+	mNumSteps = 0;
+	mNumFrames = 0;
+	mDroppedTime = 0;
+	mSleepTime = 0;
+}
+
+void PlaybackClock::setStepRate(REAL hz)
+{
+	if(hz <= 0)
+	{
+		PRINTERROR("step rate has to be positive");
+		return;
+	}
+	mStepSize = 1.0 / hz;
+}
+
+void PlaybackClock::setTargetFrameRate(REAL hz)
+{
+	mTargetFrameRate = std::max(REAL(0), hz);
+}
+
+REAL PlaybackClock::getTargetFrameRate() const
+{
+	return REAL(mTargetFrameRate);
+}
+
+void PlaybackClock::setMaxStepsPerFrame(unsigned int n)
+{
+	mMaxStepsPerFrame = std::max(n, 1u);
+}
+
+unsigned int PlaybackClock::beginFrame()
+{
+	Clock::time_point now = Clock::now();
+
+	// the first frame only starts the clock
+	if(!mRunning)
+	{
+		mRunning = true;
+		mFrameStart = now;
+		mNumFrameSteps = 0;
+		return 0;
+	}
+
+	double dt = std::chrono::duration<double>(now - mFrameStart).count();
+	mFrameStart = now;
+
+	mFrameTime = dt * 1000.0;
+	mAverageFrameTime = (mNumFrames == 0) ? mFrameTime : 0.95 * mAverageFrameTime + 0.05 * mFrameTime;
+	mMaxFrameTime = std::max(mMaxFrameTime, mFrameTime);
+	mNumFrames++;
+
+	mAccumulator += dt;
+	unsigned int steps = (unsigned int)(mAccumulator / mStepSize);
+	if(steps > mMaxStepsPerFrame)
+	{
+		mDroppedTime += (steps - mMaxStepsPerFrame) * mStepSize;
+		steps = mMaxStepsPerFrame;
+		mAccumulator = std::fmod(mAccumulator, mStepSize);
+	}
+	else
+	{
+		mAccumulator -= steps * mStepSize;
+	}
+
+	mNumFrameSteps = steps;
+	mNumSteps += steps;
+
+	return steps;
+}
+
+void PlaybackClock::endFrame()
+{
+	if(mTargetFrameRate <= 0 || !mRunning)
+		return;
+
+	Clock::time_point due = mFrameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / mTargetFrameRate));
+	Clock::time_point now = Clock::now();
+	if(now < due)
+	{
+		std::this_thread::sleep_until(due);
+		mSleepTime += std::chrono::duration<double>(Clock::now() - now).count();
+	}
+}
+
+REAL PlaybackClock::getStepSize() const
+{
+	return REAL(mStepSize);
+}
+
+REAL PlaybackClock::getAlpha() const
+{
+	return REAL(mAccumulator / mStepSize);
+}
+
+REAL PlaybackClock::getFrameTime() const
+{
+	return REAL(mFrameTime);
+}
+
+REAL PlaybackClock::getAverageFrameTime() const
+{
+	return REAL(mAverageFrameTime);
+}
+
+REAL PlaybackClock::getMaxFrameTime() const
+{
+	return REAL(mMaxFrameTime);
+}
+
+unsigned int PlaybackClock::getNumFrameSteps() const
+{
+	return mNumFrameSteps;
+}
+
+unsigned long PlaybackClock::getNumSteps() const
+{
+	return mNumSteps;
+}
+
+unsigned long PlaybackClock::getNumFrames() const
+{
+	return mNumFrames;
+}
+
+REAL PlaybackClock::getDroppedTime() const
+{
+	return REAL(mDroppedTime);
+}
+
+REAL PlaybackClock::getSleepTime() const
+{
+	return REAL(mSleepTime);
+}
@@ -0,0 +1,93 @@
+#ifndef __PLAYBACKCLOCK_H__
+#define __PLAYBACKCLOCK_H__
+
+#include "platform.h"
+#include <chrono>
+
+/*! PlaybackClock
+ *
+ *  \brief  wall clock driven fixed time step loop. beginFrame() adds the
+ *          elapsed time to an accumulator and returns how many fixed steps
+ *          to simulate, the remainder is the blend factor between the last
+ *          two simulated states. endFrame() sleeps for the rest of the frame
+ *          when a target frame rate is set, so the idle callback does not
+ *          spin a core. Frame times and step counts are collected on the way.
+ */
+class PlaybackClock
+{
+public:
+
+	typedef std::chrono::steady_clock Clock;
+
+	//! constructor
+	PlaybackClock();
+
+	//! restarts the clock and clears the statistics
+	void reset();
+
+	//! fixed simulation steps per second
+	void setStepRate(REAL hz);
+
+	//! frames per second to pace to, 0 disables pacing
+	void setTargetFrameRate(REAL hz);
+
+	//! get the target frame rate
+	REAL getTargetFrameRate() const;
+
+	//! more steps per frame are dropped, e.g. after a debugger break
+	void setMaxStepsPerFrame(unsigned int n);
+
+	//! measures the time since the last frame, returns the number of steps to simulate
+	unsigned int beginFrame();
+
+	//! sleeps until the next frame is due
+	void endFrame();
+
+	//! the fixed step in seconds
+	REAL getStepSize() const;
+
+	//! fraction of a step the render state lies past the last simulated step
+	REAL getAlpha() const;
+
+	//! statistics: frame times in milliseconds
+	REAL getFrameTime() const;
+	REAL getAverageFrameTime() const;
+	REAL getMaxFrameTime() const;
+
+	//! statistics: steps of the last frame and in total
+	unsigned int getNumFrameSteps() const;
+	unsigned long getNumSteps() const;
+	unsigned long getNumFrames() const;
+
+	//! statistics: seconds of simulation dropped by the step limit
+	REAL getDroppedTime() const;
+
+	//! statistics: seconds spent sleeping in endFrame
+	REAL getSleepTime() const;
+
+protected:
+
+	Clock::time_point mFrameStart;
+
+	bool mRunning;
+
+	double mStepSize;
+
+	double mAccumulator;
+
+	double mTargetFrameRate;
+
+	unsigned int mMaxStepsPerFrame;
+
+	// statistics
+	double mFrameTime;
+	double mAverageFrameTime;
+	double mMaxFrameTime;
+	unsigned int mNumFrameSteps;
+	unsigned long mNumSteps;
+	unsigned long mNumFrames;
+	double mDroppedTime;
+	double mSleepTime;
+};
+
+#endif //__PLAYBACKCLOCK_H__
@@ -1,5 +1,7 @@
 #include "renderable.h"
 #include "geomutils.h"
+#include "animationsystem.h"
+#include "scenegraph.h"
 
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -7,9 +9,12 @@
 
 Renderable::Renderable() :
 	mNumVertices(0), 
-	mNumElements(0),
 	mNumIndicesPerElement(0),
-	mVertexSize(0)
+	mNumElements(0),
+	mVertexSize(0),
+	mAnimationSource(NULL),
+	mSceneSource(NULL),
+	mSourceIndex(0)
 {
 	// generate buffers
 	glGenBuffers(1, &mVbo);
@@ -21,9 +26,12 @@ Renderable::Renderable() :
 
 Renderable::Renderable(const RenderableDesc& desc) :
 	mNumVertices(0),
-	mNumElements(0),
 	mNumIndicesPerElement(0),
-	mVertexSize(0)
+	mNumElements(0),
+	mVertexSize(0),
+	mAnimationSource(NULL),
+	mSceneSource(NULL),
+	mSourceIndex(0)
 {
 	glGenBuffers(1, &mVbo);
 	glGenBuffers(1, &mIbo);
@@ -47,9 +55,12 @@ Renderable::Renderable(const std::vector<vec3> &_V,
                         const std::vector<ivec3> &_T,
                         const std::string& material) : 
 	mNumVertices(0), 
-	mNumElements(0),
 	mNumIndicesPerElement(0),
-	mVertexSize(0)
+	mNumElements(0),
+	mVertexSize(0),
+	mAnimationSource(NULL),
+	mSceneSource(NULL),
+	mSourceIndex(0)
 {
 	// generate buffers
 	glGenBuffers(1, &mVbo);
@@ -78,9 +89,12 @@ Renderable::Renderable(const std::vector<vec3>& _V,
                        const std::string& material,
                        const mat4& M) :
 	mNumVertices(0), 
-	mNumElements(0),
 	mNumIndicesPerElement(0),
-	mVertexSize(0)
+	mNumElements(0),
+	mVertexSize(0),
+	mAnimationSource(NULL),
+	mSceneSource(NULL),
+	mSourceIndex(0)
 {
 	// generate buffers
 	glGenBuffers(1, &mVbo);
@@ -220,6 +234,36 @@ void Renderable::setModelMatrix(const mat4 &M)
     mModelMatrix = M;
 }
 
+void Renderable::setModelMatrixSource(const AnimationSystem* system, unsigned int idx)
+{
+    mAnimationSource = system;
+    mSceneSource = NULL;
+    mSourceIndex = idx;
+}
+
+void Renderable::setModelMatrixSource(const SceneGraph* scene, unsigned int idx)
+{
+    mAnimationSource = NULL;
+    mSceneSource = scene;
+    mSourceIndex = idx;
+}
+
+void Renderable::clearModelMatrixSource()
+{
+    mAnimationSource = NULL;
+    mSceneSource = NULL;
+    mSourceIndex = 0;
+}
+
+const mat4& Renderable::getRenderMatrix() const
+{
+    if(mAnimationSource != NULL)
+        return mAnimationSource->getModelMatrix(mSourceIndex);
+    if(mSceneSource != NULL)
+        return mSceneSource->getWorldTransform(mSourceIndex);
+    return mModelMatrix;
+}
+
 std::string& Renderable::getMaterial()
 {
     return mMaterial;
@@ -3,6 +3,9 @@
 
 #include "platform.h"
 
+class AnimationSystem;
+class SceneGraph;
+
 struct RenderableDesc
 {
 	std::vector<vec3> vertices;
@@ -54,6 +57,18 @@ public:
 
     void setModelMatrix(const mat4& M);
 
+    //! read the model matrix of object idx of an animation system
+    void setModelMatrixSource(const AnimationSystem* system, unsigned int idx);
+
+    //! read the world transform of node idx of a scene graph
+    void setModelMatrixSource(const SceneGraph* scene, unsigned int idx);
+
+    //! use the own model matrix again
+    void clearModelMatrixSource();
+
+    //! the bound model matrix or the own one
+    const mat4& getRenderMatrix() const;
+
     std::string& getMaterial();
 
     void setMaterial(const std::string& mId);
@@ -87,6 +102,13 @@ protected:
 
     unsigned int mVertexSize;
 
+    //! bound animation system or scene graph, looked up by index so growing them is safe
+    const AnimationSystem* mAnimationSource;
+
+    const SceneGraph* mSceneSource;
+
+    unsigned int mSourceIndex;
+
 };
 
 #endif // MESH_H
@@ -374,11 +374,11 @@ void Renderer::render(Camera* camera)
             }
 
             // set modelmatrix
-            mat4& mM = cur->getModelMatrix();
+            const mat4& mM = cur->getRenderMatrix();
             glUniformMatrix4fv(shader->uniform("model_matrix"), 1, false, mM.data());
 
             // ... and the normalmatrix
-            mat4 mvM = view_matrix * cur->getModelMatrix();
+            mat4 mvM = view_matrix * mM;
             mat3 mvM3 = mvM.topLeftCorner<3,3>();
             mat3 nM = mvM3.inverse().transpose();
 
@@ -0,0 +1,96 @@
+#include "scenegraph.h"
+
+SceneGraph::SceneGraph()
+{
+	clear();
+}
+
+void SceneGraph::clear()
+{
+	mNames.clear();
+	mParents.clear();
+	mLocal.clear();
+	mWorld.clear();
+	mDirty.clear();
+	mChanged.clear();
+}
+
+int SceneGraph::addNode(const std::string& name, int parent, const mat4& local)
+{
+	if(parent >= (int)mParents.size())
+	{
+		PRINTERROR("parent node " << parent << " of " << name << " does not exist");
+		return -1;
+	}
+
+	mNames.push_back(name);
+	mParents.push_back(std::max(parent, -1));
+	mLocal.push_back(local);
+	mWorld.push_back(local);
+	mDirty.push_back(1);
+	mChanged.push_back(0);
+
+	return mParents.size() - 1;
+}
+
+int SceneGraph::findNode(const std::string& name) const
+{
+	for(unsigned int i = 0; i < mNames.size(); ++i)
+	{
+		if(mNames[i] == name)
+			return i;
+	}
+	return -1;
+}
+
+unsigned int SceneGraph::getNumNodes() const
+{
+	return mParents.size();
+}
+
+int SceneGraph::getParent(unsigned int idx) const
+{
+	return mParents[idx];
+}
+
+void SceneGraph::setLocalTransform(unsigned int idx, const mat4& M)
+{
+	mLocal[idx] = M;
+	mDirty[idx] = 1;
+}
+
+const mat4& SceneGraph::getLocalTransform(unsigned int idx) const
+{
+	return mLocal[idx];
+}
+
+const mat4& SceneGraph::getWorldTransform(unsigned int idx) const
+{
+	return mWorld[idx];
+}
+
+unsigned int SceneGraph::update()
+{
+	unsigned int numUpdated = 0;
+	const unsigned int n = mParents.size();
+
+	// parents precede their children, one pass in storage order suffices
+	for(unsigned int i = 0; i < n; ++i)
+	{
+		const int p = mParents[i];
+		const bool changed = mDirty[i] || (p >= 0 && mChanged[p]);
+		mChanged[i] = changed;
+		if(!changed)
+			continue;
+
+		if(p >= 0)
+			mWorld[i].noalias() = mWorld[p] * mLocal[i];
+		else
+			mWorld[i] = mLocal[i];
+
+		mDirty[i] = 0;
+		numUpdated++;
+	}
+
+	return numUpdated;
+}
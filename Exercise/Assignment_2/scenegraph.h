@@ -0,0 +1,67 @@
+#ifndef __SCENEGRAPH_H__
+#define __SCENEGRAPH_H__
+
+#include "platform.h"
+
+/*! SceneGraph
+ *
+ *  \brief  transform hierarchy in flat arrays. A node can only be added
+ *          below an existing node, so the node order is already an order in
+ *          which every parent comes before its children. update() walks the
+ *          arrays once and recomputes the cached world matrix of a node only
+ *          if its local transform changed or its parent was recomputed, so
+ *          untouched subtrees cost one flag test per node. Renderables can be
+ *          bound to a node index and read its world matrix when drawn.
+ */
+class SceneGraph
+{
+public:
+
+	//! constructor
+	SceneGraph();
+
+	//! removes all nodes
+	void clear();
+
+	//! adds a node below parent (-1 for a root), returns its index
+	int addNode(const std::string& name, int parent, const mat4& local = mat4::Identity());
+
+	//! index of the node with name or -1
+	int findNode(const std::string& name) const;
+
+	//! get number of nodes
+	unsigned int getNumNodes() const;
+
+	//! parent of node idx or -1
+	int getParent(unsigned int idx) const;
+
+	//! sets the transform relative to the parent and marks the node dirty
+	void setLocalTransform(unsigned int idx, const mat4& M);
+
+	//! transform relative to the parent
+	const mat4& getLocalTransform(unsigned int idx) const;
+
+	//! cached world transform, valid after update()
+	const mat4& getWorldTransform(unsigned int idx) const;
+
+	//! recomputes the world transforms of all dirty subtrees, returns the number of recomputed nodes
+	unsigned int update();
+
+protected:
+
+	std::vector<std::string> mNames;
+
+	std::vector<int> mParents;
+
+	std::vector<mat4, Eigen::aligned_allocator<mat4> > mLocal;
+
+	std::vector<mat4, Eigen::aligned_allocator<mat4> > mWorld;
+
+	//! local transform changed since the last update
+	std::vector<unsigned char> mDirty;
+
+	//! scratch: world transform recomputed in the running update
+	std::vector<unsigned char> mChanged;
+};
+
+#endif //__SCENEGRAPH_H__
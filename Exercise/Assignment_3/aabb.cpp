@@ -0,0 +1,142 @@
+#include "aabb.h"
+
+#ifdef __SSE__
+ #include <xmmintrin.h>
+#endif
+
+AABB::AABB()
+{
+	minPosition = maxPosition = vec3::Zero();
+}
+
+AABB::AABB(const vec3& minP, const vec3& maxP)
+{
+	minPosition = minP;
+	maxPosition = maxP;
+}
+
+void AABB::setEmpty()
+{
+	minPosition.setConstant(std::numeric_limits<REAL>::max());
+	maxPosition.setConstant(-std::numeric_limits<REAL>::max());
+}
+
+void AABB::setFromVertices(const std::vector<vec3>& vertices)
+{
+	if(vertices.empty())
+	{
+		minPosition = maxPosition = vec3::Zero();
+		return;
+	}
+	setFromVertices(&vertices[0], vertices.size());
+}
+
+void AABB::setFromVertices(const vec3* vertices, unsigned int n)
+{
+	if(n == 0)
+	{
+		minPosition = maxPosition = vec3::Zero();
+		return;
+	}
+
+#ifdef __SSE__
+	// vec3 is three packed floats: an unaligned 4 float load takes a vertex and
+	// the x of the next one, lane 3 is ignored. The last vertex is loaded alone.
+	const float* p = vertices[0].data();
+	__m128 minV = _mm_set_ps(0, p[2], p[1], p[0]);
+	__m128 maxV = minV;
+	for(unsigned int i = 0; i + 1 < n; ++i)
+	{
+		__m128 v = _mm_loadu_ps(vertices[i].data());
+		minV = _mm_min_ps(minV, v);
+		maxV = _mm_max_ps(maxV, v);
+	}
+	p = vertices[n - 1].data();
+	__m128 last = _mm_set_ps(0, p[2], p[1], p[0]);
+	minV = _mm_min_ps(minV, last);
+	maxV = _mm_max_ps(maxV, last);
+
+	float minF[4], maxF[4];
+	_mm_storeu_ps(minF, minV);
+	_mm_storeu_ps(maxF, maxV);
+	minPosition = vec3(minF[0], minF[1], minF[2]);
+	maxPosition = vec3(maxF[0], maxF[1], maxF[2]);
+#else
+	minPosition = maxPosition = vertices[0];
+	for(unsigned int i = 1; i < n; ++i)
+	{
+		minPosition = minPosition.cwiseMin(vertices[i]);
+		maxPosition = maxPosition.cwiseMax(vertices[i]);
+	}
+#endif
+}
+
+void AABB::setFromTransformedVertices(const std::vector<vec3>& vertices, const mat4& M)
+{
+	setEmpty();
+	const mat3 R = M.block<3, 3>(0, 0);
+	const vec3 t = M.block<3, 1>(0, 3);
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+		expand(R * vertices[i] + t);
+}
+
+void AABB::transform(const mat4& M, AABB& out) const
+{
+	// every output extent is the translation plus the smaller/larger product per input axis
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		REAL lo = M(i, 3);
+		REAL hi = M(i, 3);
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			REAL a = M(i, j) * minPosition[j];
+			REAL b = M(i, j) * maxPosition[j];
+			lo += std::min(a, b);
+			hi += std::max(a, b);
+		}
+		out.minPosition[i] = lo;
+		out.maxPosition[i] = hi;
+	}
+}
+
+void AABB::expand(const vec3& p)
+{
+	minPosition = minPosition.cwiseMin(p);
+	maxPosition = maxPosition.cwiseMax(p);
+}
+
+void AABB::merge(const AABB& other)
+{
+	minPosition = minPosition.cwiseMin(other.minPosition);
+	maxPosition = maxPosition.cwiseMax(other.maxPosition);
+}
+
+bool AABB::overlaps(const AABB& other) const
+{
+	return minPosition[0] <= other.maxPosition[0] && other.minPosition[0] <= maxPosition[0] &&
+		minPosition[1] <= other.maxPosition[1] && other.minPosition[1] <= maxPosition[1] &&
+		minPosition[2] <= other.maxPosition[2] && other.minPosition[2] <= maxPosition[2];
+}
+
+bool AABB::contains(const AABB& other) const
+{
+	return minPosition[0] <= other.minPosition[0] && other.maxPosition[0] <= maxPosition[0] &&
+		minPosition[1] <= other.minPosition[1] && other.maxPosition[1] <= maxPosition[1] &&
+		minPosition[2] <= other.minPosition[2] && other.maxPosition[2] <= maxPosition[2];
+}
+
+vec3 AABB::getCenter() const
+{
+	return REAL(0.5) * (minPosition + maxPosition);
+}
+
+vec3 AABB::getExtents() const
+{
+	return maxPosition - minPosition;
+}
+
+REAL AABB::getSurfaceArea() const
+{
+	vec3 e = getExtents();
+	return REAL(2) * (e[0] * e[1] + e[1] * e[2] + e[2] * e[0]);
+}
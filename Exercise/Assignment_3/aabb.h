@@ -0,0 +1,59 @@
+#ifndef __AABB_H__
+#define __AABB_H__
+
+#include "platform.h"
+
+/*! AABB
+ *
+ *  \brief  axis aligned bounding box. Boxes built from vertices use an SSE
+ *          min/max reduction where available. World space boxes of moving
+ *          objects are derived from the local box in O(1) (Arvo's method),
+ *          which is conservative; tight boxes come from transforming only
+ *          the convex hull vertices.
+ */
+struct AABB
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	vec3 minPosition;
+	vec3 maxPosition;
+
+	AABB();
+
+	AABB(const vec3& minP, const vec3& maxP);
+
+	//! inverted box, the neutral element of expand and merge
+	void setEmpty();
+
+	//! box of the vertices
+	void setFromVertices(const std::vector<vec3>& vertices);
+
+	//! box of n vertices
+	void setFromVertices(const vec3* vertices, unsigned int n);
+
+	//! exact box of the vertices transformed by M, meant for the few vertices of a convex hull
+	void setFromTransformedVertices(const std::vector<vec3>& vertices, const mat4& M);
+
+	//! box around this box transformed by the affine M (Arvo), O(1)
+	void transform(const mat4& M, AABB& out) const;
+
+	//! grows the box to contain p
+	void expand(const vec3& p);
+
+	//! grows the box to contain other
+	void merge(const AABB& other);
+
+	//! true if the boxes intersect or touch
+	bool overlaps(const AABB& other) const;
+
+	//! true if other lies inside this box
+	bool contains(const AABB& other) const;
+
+	vec3 getCenter() const;
+
+	vec3 getExtents() const;
+
+	REAL getSurfaceArea() const;
+};
+
+#endif //__AABB_H__
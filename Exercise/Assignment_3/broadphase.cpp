@@ -0,0 +1,825 @@
+#include "broadphase.h"
+
+#ifdef _OPENMP
+ #include <omp.h>
+#endif
+
+BroadPhase::BroadPhase()
+	: mNumObjects(0)
+{
+}
+
+BroadPhase::~BroadPhase()
+{
+}
+
+unsigned long long BroadPhase::makeKey(unsigned int a, unsigned int b)
+{
+	if(a > b)
+		std::swap(a, b);
+	return ((unsigned long long)a << 32) | b;
+}
+
+void BroadPhase::reset()
+{
+	mNumObjects = 0;
+	mRemoved.clear();
+	mKeys.clear();
+	mPreviousKeys.clear();
+	mPairs.clear();
+	mBegin.clear();
+	mPersist.clear();
+	mEnd.clear();
+	clear();
+}
+
+void BroadPhase::removeObject(unsigned int id)
+{
+	if(id >= mNumObjects || mRemoved[id])
+		return;
+	mRemoved[id] = true;
+	eraseObject(id);
+}
+
+void BroadPhase::addObject(unsigned int id, const AABB& box)
+{
+	if(id >= mNumObjects || !mRemoved[id])
+		return;
+	mRemoved[id] = false;
+	insertObject(id, box);
+}
+
+bool BroadPhase::isRemoved(unsigned int id) const
+{
+	return id < mNumObjects && mRemoved[id];
+}
+
+void BroadPhase::update(const std::vector<AABB>& boxes)
+{
+	// objects cut off the end leave, appended objects enter
+	const unsigned int n = boxes.size();
+	for(unsigned int id = n; id < mNumObjects; ++id)
+	{
+		if(!mRemoved[id])
+			eraseObject(id);
+	}
+	mRemoved.resize(n, false);
+	for(unsigned int id = mNumObjects; id < n; ++id)
+		insertObject(id, boxes[id]);
+	mNumObjects = n;
+
+	mPreviousKeys.swap(mKeys);
+	mKeys.clear();
+	findPairs(boxes, mKeys);
+	std::sort(mKeys.begin(), mKeys.end());
+
+	// both key lists are sorted, one merge gives all events
+	mPairs.clear();
+	mBegin.clear();
+	mPersist.clear();
+	mEnd.clear();
+	unsigned int i = 0, j = 0;
+	while(i < mKeys.size() || j < mPreviousKeys.size())
+	{
+		if(j == mPreviousKeys.size() || (i < mKeys.size() && mKeys[i] < mPreviousKeys[j]))
+		{
+			mBegin.push_back(OverlapPair(mKeys[i] >> 32, mKeys[i] & 0xffffffff));
+			mPairs.push_back(mBegin.back());
+			i++;
+		}
+		else if(i == mKeys.size() || mPreviousKeys[j] < mKeys[i])
+		{
+			mEnd.push_back(OverlapPair(mPreviousKeys[j] >> 32, mPreviousKeys[j] & 0xffffffff));
+			j++;
+		}
+		else
+		{
+			mPersist.push_back(OverlapPair(mKeys[i] >> 32, mKeys[i] & 0xffffffff));
+			mPairs.push_back(mPersist.back());
+			i++;
+			j++;
+		}
+	}
+}
+
+const std::vector<OverlapPair>& BroadPhase::getPairs() const
+{
+	return mPairs;
+}
+
+const std::vector<OverlapPair>& BroadPhase::getBeginPairs() const
+{
+	return mBegin;
+}
+
+const std::vector<OverlapPair>& BroadPhase::getPersistPairs() const
+{
+	return mPersist;
+}
+
+const std::vector<OverlapPair>& BroadPhase::getEndPairs() const
+{
+	return mEnd;
+}
+
+// order of the endpoints on the axis, minima before maxima at equal values
+bool SweepAndPrune::endpointLess(const Endpoint& a, const Endpoint& b)
+{
+	return a.value < b.value || (a.value == b.value && (a.data & 1) < (b.data & 1));
+}
+
+SweepAndPrune::SweepAndPrune()
+	: mAxis(0),
+	  mNumSwaps(0),
+	  mNumInserted(0)
+{
+}
+
+const char* SweepAndPrune::getName() const
+{
+	return "sweep and prune";
+}
+
+unsigned int SweepAndPrune::getNumSwaps() const
+{
+	return mNumSwaps;
+}
+
+void SweepAndPrune::clear()
+{
+	mEndpoints.clear();
+	mActive.clear();
+	mActiveSlot.clear();
+	mActiveBounds.clear();
+	mAxis = 0;
+	mNumSwaps = 0;
+	mNumInserted = 0;
+}
+
+void SweepAndPrune::insertObject(unsigned int id, const AABB& box)
+{
+	// appended, the next insertion sort moves the endpoints to their place
+	if(mActiveSlot.size() <= id)
+		mActiveSlot.resize(id + 1, 0);
+	Endpoint e;
+	e.value = box.minPosition[mAxis];
+	e.data = id << 1;
+	mEndpoints.push_back(e);
+	e.value = box.maxPosition[mAxis];
+	e.data = (id << 1) | 1;
+	mEndpoints.push_back(e);
+	mNumInserted++;
+}
+
+void SweepAndPrune::eraseObject(unsigned int id)
+{
+	unsigned int kept = 0;
+	for(unsigned int k = 0; k < mEndpoints.size(); ++k)
+	{
+		if((mEndpoints[k].data >> 1) != id)
+			mEndpoints[kept++] = mEndpoints[k];
+	}
+	mEndpoints.resize(kept);
+}
+
+void SweepAndPrune::findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys)
+{
+	// mostly new objects: sweep along the axis the centers spread most
+	const unsigned int numLive = mEndpoints.size() / 2;
+	if(2 * mNumInserted > numLive)
+	{
+		vec3 mean = vec3::Zero();
+		vec3 meanSq = vec3::Zero();
+		for(unsigned int k = 0; k < mEndpoints.size(); ++k)
+		{
+			if(mEndpoints[k].data & 1)
+				continue;
+			vec3 c = boxes[mEndpoints[k].data >> 1].getCenter();
+			mean += c;
+			meanSq += c.cwiseProduct(c);
+		}
+		vec3 variance = meanSq - mean.cwiseProduct(mean) / REAL(std::max(numLive, 1u));
+		variance.maxCoeff(&mAxis);
+
+		// a full sort instead of quadratic insertion sort for the first order
+		for(unsigned int k = 0; k < mEndpoints.size(); ++k)
+		{
+			const AABB& box = boxes[mEndpoints[k].data >> 1];
+			mEndpoints[k].value = (mEndpoints[k].data & 1) ? box.maxPosition[mAxis] : box.minPosition[mAxis];
+		}
+		std::sort(mEndpoints.begin(), mEndpoints.end(), endpointLess);
+	}
+	mNumInserted = 0;
+
+	// refresh the values in the old order, then insertion sort; minima go first on ties
+	for(unsigned int k = 0; k < mEndpoints.size(); ++k)
+	{
+		const AABB& box = boxes[mEndpoints[k].data >> 1];
+		mEndpoints[k].value = (mEndpoints[k].data & 1) ? box.maxPosition[mAxis] : box.minPosition[mAxis];
+	}
+
+	mNumSwaps = 0;
+	for(unsigned int k = 1; k < mEndpoints.size(); ++k)
+	{
+		Endpoint e = mEndpoints[k];
+		unsigned int j = k;
+		while(j > 0 && endpointLess(e, mEndpoints[j - 1]))
+		{
+			mEndpoints[j] = mEndpoints[j - 1];
+			j--;
+		}
+		mEndpoints[j] = e;
+		mNumSwaps += k - j;
+	}
+
+	// sweep: an opening box overlaps all open boxes on the axis, their
+	// bounds on the other axes are kept next to each other for the tests
+	const unsigned int u = (mAxis + 1) % 3;
+	const unsigned int v = (mAxis + 2) % 3;
+	mActive.clear();
+	mActiveBounds.clear();
+	for(unsigned int k = 0; k < mEndpoints.size(); ++k)
+	{
+		const unsigned int id = mEndpoints[k].data >> 1;
+		if(mEndpoints[k].data & 1)
+		{
+			// swap remove
+			unsigned int slot = mActiveSlot[id];
+			unsigned int last = mActive.size() - 1;
+			mActive[slot] = mActive[last];
+			for(unsigned int c = 0; c < 4; ++c)
+				mActiveBounds[4 * slot + c] = mActiveBounds[4 * last + c];
+			mActiveSlot[mActive[slot]] = slot;
+			mActive.pop_back();
+			mActiveBounds.resize(4 * last);
+			continue;
+		}
+
+		const AABB& a = boxes[id];
+		const REAL minU = a.minPosition[u], maxU = a.maxPosition[u];
+		const REAL minV = a.minPosition[v], maxV = a.maxPosition[v];
+		const REAL* bounds = mActiveBounds.empty() ? NULL : &mActiveBounds[0];
+		for(unsigned int m = 0; m < mActive.size(); ++m)
+		{
+			const REAL* b = bounds + 4 * m;
+			if(minU <= b[1] && b[0] <= maxU && minV <= b[3] && b[2] <= maxV)
+				keys.push_back(makeKey(id, mActive[m]));
+		}
+
+		mActiveSlot[id] = mActive.size();
+		mActive.push_back(id);
+		mActiveBounds.push_back(minU);
+		mActiveBounds.push_back(maxU);
+		mActiveBounds.push_back(minV);
+		mActiveBounds.push_back(maxV);
+	}
+}
+
+SpatialHashGrid::SpatialHashGrid()
+	: mCellSize(0),
+	  mUsedCellSize(0)
+{
+}
+
+const char* SpatialHashGrid::getName() const
+{
+	return "spatial hash grid";
+}
+
+void SpatialHashGrid::setCellSize(REAL size)
+{
+	mCellSize = std::max(size, REAL(0));
+}
+
+REAL SpatialHashGrid::getCellSize() const
+{
+	return mUsedCellSize;
+}
+
+unsigned int SpatialHashGrid::getNumEntries() const
+{
+	return mEntries.size();
+}
+
+void SpatialHashGrid::clear()
+{
+	mCellMin.clear();
+	mCellMax.clear();
+	mEntryOffsets.clear();
+	mEntries.clear();
+	mSorted.clear();
+	mBucketStart.clear();
+	mBucketFill.clear();
+	mUsedCellSize = 0;
+}
+
+// the grid is rebuilt by every update
+void SpatialHashGrid::insertObject(unsigned int id, const AABB& box)
+{
+}
+
+void SpatialHashGrid::eraseObject(unsigned int id)
+{
+}
+
+// 21 bits per cell coordinate
+unsigned long long SpatialHashGrid::cellKey(int x, int y, int z)
+{
+	const unsigned long long mask = (1ull << 21) - 1;
+	return ((unsigned long long)(x & mask) << 42) | ((unsigned long long)(y & mask) << 21) | (unsigned long long)(z & mask);
+}
+
+void SpatialHashGrid::findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys)
+{
+	const int n = boxes.size();
+	if(n == 0)
+		return;
+
+	mUsedCellSize = mCellSize;
+	if(mUsedCellSize <= 0)
+	{
+		REAL sum = 0;
+		int numLive = 0;
+		#pragma omp parallel for reduction(+:sum, numLive)
+		for(int i = 0; i < n; ++i)
+		{
+			if(mRemoved[i])
+				continue;
+			sum += boxes[i].getExtents().maxCoeff();
+			numLive++;
+		}
+		mUsedCellSize = std::max(sum / std::max(numLive, 1), EPSILON);
+	}
+	const REAL invCell = REAL(1) / mUsedCellSize;
+
+	// cell ranges and entry counts per object, removed objects get an empty range
+	mCellMin.resize(n);
+	mCellMax.resize(n);
+	mEntryOffsets.resize(n + 1);
+	mEntryOffsets[0] = 0;
+	#pragma omp parallel for
+	for(int i = 0; i < n; ++i)
+	{
+		if(mRemoved[i])
+		{
+			mCellMin[i] = Eigen::Vector3i::Zero();
+			mCellMax[i] = -Eigen::Vector3i::Ones();
+			mEntryOffsets[i + 1] = 0;
+			continue;
+		}
+		for(unsigned int k = 0; k < 3; ++k)
+		{
+			mCellMin[i][k] = (int)std::floor(boxes[i].minPosition[k] * invCell);
+			mCellMax[i][k] = (int)std::floor(boxes[i].maxPosition[k] * invCell);
+		}
+		Eigen::Vector3i cells = mCellMax[i] - mCellMin[i] + Eigen::Vector3i::Ones();
+		mEntryOffsets[i + 1] = cells[0] * cells[1] * cells[2];
+	}
+	for(int i = 0; i < n; ++i)
+		mEntryOffsets[i + 1] += mEntryOffsets[i];
+
+	// table of at least as many buckets as entries keeps the buckets short
+	const unsigned int numEntries = mEntryOffsets[n];
+	unsigned int tableSize = 1;
+	while(tableSize < numEntries)
+		tableSize <<= 1;
+	const unsigned int tableMask = tableSize - 1;
+	mEntries.resize(numEntries);
+	mSorted.resize(numEntries);
+	mBucketStart.resize(tableSize + 1);
+
+	// counting sort by bucket, every thread counts and scatters the entries
+	// of its own objects, so the sort needs no atomics and keeps the order
+	#pragma omp parallel
+	{
+#ifdef _OPENMP
+		const int thread = omp_get_thread_num();
+		const int numThreads = omp_get_num_threads();
+#else
+		const int thread = 0;
+		const int numThreads = 1;
+#endif
+		#pragma omp single
+		mBucketFill.assign((size_t)numThreads * tableSize, 0);
+
+		unsigned int* fill = &mBucketFill[(size_t)thread * tableSize];
+		const int first = (int)((long long)n * thread / numThreads);
+		const int last = (int)((long long)n * (thread + 1) / numThreads);
+		for(int i = first; i < last; ++i)
+		{
+			unsigned int e = mEntryOffsets[i];
+			for(int x = mCellMin[i][0]; x <= mCellMax[i][0]; ++x)
+			{
+				for(int y = mCellMin[i][1]; y <= mCellMax[i][1]; ++y)
+				{
+					for(int z = mCellMin[i][2]; z <= mCellMax[i][2]; ++z)
+					{
+						GridEntry& entry = mEntries[e++];
+						entry.cell = cellKey(x, y, z);
+						entry.bucket = ((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u) & tableMask;
+						entry.id = i;
+						fill[entry.bucket]++;
+					}
+				}
+			}
+		}
+
+		// bucket starts, and the start of every thread within each bucket
+		#pragma omp barrier
+		#pragma omp single
+		{
+			unsigned int sum = 0;
+			for(unsigned int b = 0; b < tableSize; ++b)
+			{
+				mBucketStart[b] = sum;
+				for(int t = 0; t < numThreads; ++t)
+				{
+					unsigned int count = mBucketFill[(size_t)t * tableSize + b];
+					mBucketFill[(size_t)t * tableSize + b] = sum;
+					sum += count;
+				}
+			}
+			mBucketStart[tableSize] = sum;
+		}
+
+		for(unsigned int e = mEntryOffsets[first]; e < mEntryOffsets[last]; ++e)
+			mSorted[fill[mEntries[e].bucket]++] = mEntries[e];
+	}
+
+	// pairs per bucket, the cell of the intersection minimum reports the pair
+	#pragma omp parallel
+	{
+		std::vector<unsigned long long> localKeys;
+
+		#pragma omp for schedule(dynamic, 256)
+		for(int b = 0; b < (int)tableSize; ++b)
+		{
+			const unsigned int end = mBucketStart[b + 1];
+			for(unsigned int i = mBucketStart[b]; i < end; ++i)
+			{
+				const GridEntry& ei = mSorted[i];
+				const AABB& a = boxes[ei.id];
+				for(unsigned int j = i + 1; j < end; ++j)
+				{
+					const GridEntry& ej = mSorted[j];
+					if(ej.cell != ei.cell || !a.overlaps(boxes[ej.id]))
+						continue;
+
+					const Eigen::Vector3i& ca = mCellMin[ei.id];
+					const Eigen::Vector3i& cb = mCellMin[ej.id];
+					if(cellKey(std::max(ca[0], cb[0]), std::max(ca[1], cb[1]), std::max(ca[2], cb[2])) == ei.cell)
+						localKeys.push_back(makeKey(ei.id, ej.id));
+				}
+			}
+		}
+
+		#pragma omp critical
+		keys.insert(keys.end(), localKeys.begin(), localKeys.end());
+	}
+}
+
+const char* BruteForceBroadPhase::getName() const
+{
+	return "brute force";
+}
+
+void BruteForceBroadPhase::clear()
+{
+}
+
+void BruteForceBroadPhase::insertObject(unsigned int id, const AABB& box)
+{
+}
+
+void BruteForceBroadPhase::eraseObject(unsigned int id)
+{
+}
+
+void BruteForceBroadPhase::findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys)
+{
+	for(unsigned int i = 0; i < boxes.size(); ++i)
+	{
+		if(mRemoved[i])
+			continue;
+		for(unsigned int j = i + 1; j < boxes.size(); ++j)
+		{
+			if(!mRemoved[j] && boxes[i].overlaps(boxes[j]))
+				keys.push_back(makeKey(i, j));
+		}
+	}
+}
+
+DynamicAABBTree::DynamicAABBTree()
+	: mRoot(-1),
+	  mFreeList(-1),
+	  mFatMargin(REAL(0.2)),
+	  mNumReinserts(0)
+{
+}
+
+const char* DynamicAABBTree::getName() const
+{
+	return "dynamic aabb tree";
+}
+
+void DynamicAABBTree::setFatMargin(REAL margin)
+{
+	mFatMargin = std::max(margin, REAL(0));
+}
+
+int DynamicAABBTree::getHeight() const
+{
+	return (mRoot < 0) ? 0 : mNodes[mRoot].height;
+}
+
+unsigned int DynamicAABBTree::getNumReinserts() const
+{
+	return mNumReinserts;
+}
+
+void DynamicAABBTree::clear()
+{
+	mNodes.clear();
+	mLeaves.clear();
+	mStack.clear();
+	mRoot = -1;
+	mFreeList = -1;
+	mNumReinserts = 0;
+}
+
+void DynamicAABBTree::insertObject(unsigned int id, const AABB& box)
+{
+	if(mLeaves.size() <= id)
+		mLeaves.resize(id + 1, -1);
+	const int leaf = allocateNode();
+	mNodes[leaf].object = id;
+	setFatBox(leaf, box);
+	insertLeaf(leaf);
+	mLeaves[id] = leaf;
+}
+
+void DynamicAABBTree::eraseObject(unsigned int id)
+{
+	removeLeaf(mLeaves[id]);
+	freeNode(mLeaves[id]);
+	mLeaves[id] = -1;
+}
+
+int DynamicAABBTree::allocateNode()
+{
+	int node = mFreeList;
+	if(node >= 0)
+		mFreeList = mNodes[node].parent;
+	else
+	{
+		node = mNodes.size();
+		mNodes.push_back(TreeNode());
+	}
+
+	TreeNode& n = mNodes[node];
+	n.parent = n.left = n.right = -1;
+	n.height = 0;
+	n.object = 0;
+	return node;
+}
+
+void DynamicAABBTree::freeNode(int node)
+{
+	mNodes[node].parent = mFreeList;
+	mNodes[node].height = -1;
+	mFreeList = node;
+}
+
+void DynamicAABBTree::setFatBox(int leaf, const AABB& box)
+{
+	vec3 margin = vec3::Constant(mFatMargin * box.getExtents().maxCoeff());
+	mNodes[leaf].box = AABB(box.minPosition - margin, box.maxPosition + margin);
+}
+
+void DynamicAABBTree::insertLeaf(int leaf)
+{
+	if(mRoot < 0)
+	{
+		mRoot = leaf;
+		mNodes[leaf].parent = -1;
+		return;
+	}
+
+	// descend to the sibling of least cost: the area of the new parent plus
+	// the growth of all ancestors
+	const AABB leafBox = mNodes[leaf].box;
+	int index = mRoot;
+	while(!mNodes[index].isLeaf())
+	{
+		const TreeNode& node = mNodes[index];
+		AABB combined = node.box;
+		combined.merge(leafBox);
+		const REAL combinedArea = combined.getSurfaceArea();
+		const REAL cost = 2 * combinedArea;
+		const REAL inheritance = 2 * (combinedArea - node.box.getSurfaceArea());
+
+		REAL childCost[2];
+		const int children[2] = { node.left, node.right };
+		for(unsigned int c = 0; c < 2; ++c)
+		{
+			const TreeNode& child = mNodes[children[c]];
+			AABB grown = child.box;
+			grown.merge(leafBox);
+			childCost[c] = grown.getSurfaceArea() + inheritance;
+			if(!child.isLeaf())
+				childCost[c] -= child.box.getSurfaceArea();
+		}
+
+		if(cost < childCost[0] && cost < childCost[1])
+			break;
+		index = (childCost[0] < childCost[1]) ? children[0] : children[1];
+	}
+
+	// new parent of sibling and leaf
+	const int sibling = index;
+	const int oldParent = mNodes[sibling].parent;
+	const int newParent = allocateNode();
+	TreeNode& p = mNodes[newParent];
+	p.parent = oldParent;
+	p.box = leafBox;
+	p.box.merge(mNodes[sibling].box);
+	p.height = mNodes[sibling].height + 1;
+	p.left = sibling;
+	p.right = leaf;
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+
+	if(oldParent < 0)
+		mRoot = newParent;
+	else if(mNodes[oldParent].left == sibling)
+		mNodes[oldParent].left = newParent;
+	else
+		mNodes[oldParent].right = newParent;
+
+	refitUpwards(oldParent);
+}
+
+void DynamicAABBTree::removeLeaf(int leaf)
+{
+	if(leaf == mRoot)
+	{
+		mRoot = -1;
+		return;
+	}
+
+	// the sibling takes the place of the parent
+	const int parent = mNodes[leaf].parent;
+	const int grandParent = mNodes[parent].parent;
+	const int sibling = (mNodes[parent].left == leaf) ? mNodes[parent].right : mNodes[parent].left;
+
+	mNodes[sibling].parent = grandParent;
+	if(grandParent < 0)
+		mRoot = sibling;
+	else if(mNodes[grandParent].left == parent)
+		mNodes[grandParent].left = sibling;
+	else
+		mNodes[grandParent].right = sibling;
+	freeNode(parent);
+
+	refitUpwards(grandParent);
+}
+
+void DynamicAABBTree::refitUpwards(int node)
+{
+	while(node >= 0)
+	{
+		rotate(node);
+
+		TreeNode& n = mNodes[node];
+		n.height = 1 + std::max(mNodes[n.left].height, mNodes[n.right].height);
+		n.box = mNodes[n.left].box;
+		n.box.merge(mNodes[n.right].box);
+
+		node = n.parent;
+	}
+}
+
+void DynamicAABBTree::rotate(int a)
+{
+	const int b = mNodes[a].left;
+	const int c = mNodes[a].right;
+	if(mNodes[a].isLeaf())
+		return;
+
+	// candidate swaps of a child with a grandchild under the other child,
+	// the gain is the area the other child loses
+	int bestChild = -1, bestGrandChild = -1;
+	REAL bestGain = 0;
+	const int children[2] = { b, c };
+	for(unsigned int k = 0; k < 2; ++k)
+	{
+		const int child = children[k];
+		const int other = children[1 - k];
+		if(mNodes[other].isLeaf())
+			continue;
+
+		const int grandChildren[2] = { mNodes[other].left, mNodes[other].right };
+		for(unsigned int l = 0; l < 2; ++l)
+		{
+			// the other child would keep its second grandchild and get child
+			AABB box = mNodes[child].box;
+			box.merge(mNodes[grandChildren[1 - l]].box);
+			REAL gain = mNodes[other].box.getSurfaceArea() - box.getSurfaceArea();
+			if(gain > bestGain)
+			{
+				bestGain = gain;
+				bestChild = child;
+				bestGrandChild = grandChildren[l];
+			}
+		}
+	}
+	if(bestChild < 0)
+		return;
+
+	const int other = (bestChild == b) ? c : b;
+	if(mNodes[a].left == bestChild)
+		mNodes[a].left = bestGrandChild;
+	else
+		mNodes[a].right = bestGrandChild;
+	mNodes[bestGrandChild].parent = a;
+
+	if(mNodes[other].left == bestGrandChild)
+		mNodes[other].left = bestChild;
+	else
+		mNodes[other].right = bestChild;
+	mNodes[bestChild].parent = other;
+
+	TreeNode& o = mNodes[other];
+	o.height = 1 + std::max(mNodes[o.left].height, mNodes[o.right].height);
+	o.box = mNodes[o.left].box;
+	o.box.merge(mNodes[o.right].box);
+}
+
+void DynamicAABBTree::findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys)
+{
+	// objects that left their fat box move in the tree
+	mNumReinserts = 0;
+	for(unsigned int i = 0; i < mLeaves.size(); ++i)
+	{
+		const int leaf = mLeaves[i];
+		if(leaf < 0 || mNodes[leaf].box.contains(boxes[i]))
+			continue;
+		removeLeaf(leaf);
+		setFatBox(leaf, boxes[i]);
+		insertLeaf(leaf);
+		mNumReinserts++;
+	}
+
+	// self query: a node against itself tests its children against themselves
+	// and each other, two nodes descend into the larger one
+	if(mRoot < 0)
+		return;
+	mStack.clear();
+	mStack.push_back(mRoot);
+	mStack.push_back(mRoot);
+	while(!mStack.empty())
+	{
+		const int b = mStack.back();
+		mStack.pop_back();
+		const int a = mStack.back();
+		mStack.pop_back();
+		const TreeNode& na = mNodes[a];
+		const TreeNode& nb = mNodes[b];
+
+		if(a == b)
+		{
+			if(na.isLeaf())
+				continue;
+			mStack.push_back(na.left);
+			mStack.push_back(na.left);
+			mStack.push_back(na.right);
+			mStack.push_back(na.right);
+			mStack.push_back(na.left);
+			mStack.push_back(na.right);
+			continue;
+		}
+
+		if(!na.box.overlaps(nb.box))
+			continue;
+
+		if(na.isLeaf() && nb.isLeaf())
+		{
+			if(boxes[na.object].overlaps(boxes[nb.object]))
+				keys.push_back(makeKey(na.object, nb.object));
+		}
+		else if(nb.isLeaf() || (!na.isLeaf() && na.box.getSurfaceArea() >= nb.box.getSurfaceArea()))
+		{
+			mStack.push_back(na.left);
+			mStack.push_back(b);
+			mStack.push_back(na.right);
+			mStack.push_back(b);
+		}
+		else
+		{
+			mStack.push_back(a);
+			mStack.push_back(nb.left);
+			mStack.push_back(a);
+			mStack.push_back(nb.right);
+		}
+	}
+}
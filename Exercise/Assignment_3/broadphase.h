@@ -0,0 +1,333 @@
+#ifndef __BROADPHASE_H__
+#define __BROADPHASE_H__
+
+#include "platform.h"
+#include "aabb.h"
+
+//! a pair of overlapping objects, a < b
+struct OverlapPair
+{
+	unsigned int a;
+	unsigned int b;
+
+	OverlapPair() : a(0), b(0) {}
+
+	OverlapPair(unsigned int _a, unsigned int _b) : a(_a), b(_b) {}
+};
+
+/*! BroadPhase
+ *
+ *  \brief  common interface of the broad phase strategies. update() takes
+ *          the world boxes of all objects (the object id is the index) and
+ *          lets the strategy find the overlapping pairs. Comparing them with
+ *          the pairs of the previous update gives the begin, persist and end
+ *          events. Objects appended to the boxes are added and objects cut
+ *          off the end are removed; removeObject() takes one out anywhere
+ *          and keeps its id free until addObject() puts it back. Either
+ *          costs the strategy one insertion or removal, not a rebuild.
+ */
+class BroadPhase
+{
+public:
+
+	//! constructor
+	BroadPhase();
+
+	//! destructor
+	virtual ~BroadPhase();
+
+	//! name for reports
+	virtual const char* getName() const = 0;
+
+	//! finds the overlapping pairs of the boxes and the events since the last update
+	void update(const std::vector<AABB>& boxes);
+
+	//! forgets all objects and pairs
+	void reset();
+
+	//! takes the object out until it is added again, its box is ignored and its pairs end with the next update
+	void removeObject(unsigned int id);
+
+	//! puts a removed object back with its box, objects beyond the last update are added by update()
+	void addObject(unsigned int id, const AABB& box);
+
+	//! true if the object was removed and not added again
+	bool isRemoved(unsigned int id) const;
+
+	//! all overlapping pairs, sorted
+	const std::vector<OverlapPair>& getPairs() const;
+
+	//! pairs that started to overlap in the last update
+	const std::vector<OverlapPair>& getBeginPairs() const;
+
+	//! pairs that overlapped before and still do
+	const std::vector<OverlapPair>& getPersistPairs() const;
+
+	//! pairs that stopped overlapping in the last update
+	const std::vector<OverlapPair>& getEndPairs() const;
+
+protected:
+
+	//! drops any state kept between updates
+	virtual void clear() = 0;
+
+	//! the object enters the strategy, new or added again
+	virtual void insertObject(unsigned int id, const AABB& box) = 0;
+
+	//! the object leaves the strategy
+	virtual void eraseObject(unsigned int id) = 0;
+
+	//! appends every overlapping pair of objects not removed once as (a << 32 | b) with a < b, in any order
+	virtual void findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys) = 0;
+
+	static unsigned long long makeKey(unsigned int a, unsigned int b);
+
+	unsigned int mNumObjects;
+
+	//! one flag per object
+	std::vector<bool> mRemoved;
+
+	std::vector<unsigned long long> mKeys;
+
+	std::vector<unsigned long long> mPreviousKeys;
+
+	std::vector<OverlapPair> mPairs;
+
+	std::vector<OverlapPair> mBegin;
+
+	std::vector<OverlapPair> mPersist;
+
+	std::vector<OverlapPair> mEnd;
+};
+
+/*! SweepAndPrune
+ *
+ *  \brief  sorts the box endpoints along one axis, the axis of the largest
+ *          spread of the box centers when most objects are new. The endpoint
+ *          array is kept between updates and re-sorted by insertion sort,
+ *          which is close to linear for coherent motion and moves the
+ *          endpoints of an added object to their place. The sweep keeps the
+ *          boxes open on the axis and tests them on the other two axes.
+ */
+class SweepAndPrune : public BroadPhase
+{
+public:
+
+	//! constructor
+	SweepAndPrune();
+
+	virtual const char* getName() const;
+
+	//! number of endpoint swaps of the last insertion sort
+	unsigned int getNumSwaps() const;
+
+protected:
+
+	//! box bound on the sweep axis, data is the object id << 1 | is maximum
+	struct Endpoint
+	{
+		REAL value;
+		unsigned int data;
+	};
+
+	virtual void clear();
+
+	virtual void insertObject(unsigned int id, const AABB& box);
+
+	virtual void eraseObject(unsigned int id);
+
+	virtual void findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys);
+
+	static bool endpointLess(const Endpoint& a, const Endpoint& b);
+
+	//! endpoint order of the previous update
+	std::vector<Endpoint> mEndpoints;
+
+	//! objects open in the sweep and the position of each object in it
+	std::vector<unsigned int> mActive;
+	std::vector<unsigned int> mActiveSlot;
+
+	//! min/max of the open boxes on the two other axes, four values per open box
+	std::vector<REAL> mActiveBounds;
+
+	unsigned int mAxis;
+
+	unsigned int mNumSwaps;
+
+	//! objects inserted since the last update
+	unsigned int mNumInserted;
+};
+
+/*! SpatialHashGrid
+ *
+ *  \brief  uniform grid for many objects of similar size. Every box is
+ *          entered into the cells it touches, the cells are hashed into a
+ *          flat table that is rebuilt each update by a counting sort of the
+ *          entries. Cells sharing a bucket are told apart by their key. A pair
+ *          is reported only by the cell holding the minimum corner of the two
+ *          boxes' intersection, so it is found once without a set. Building
+ *          and querying run in parallel with OpenMP.
+ */
+class SpatialHashGrid : public BroadPhase
+{
+public:
+
+	//! constructor
+	SpatialHashGrid();
+
+	virtual const char* getName() const;
+
+	//! cell edge length, 0 uses the mean of the largest box extents of each update
+	void setCellSize(REAL size);
+
+	//! cell edge length used by the last update
+	REAL getCellSize() const;
+
+	//! number of (cell, object) entries of the last update
+	unsigned int getNumEntries() const;
+
+protected:
+
+	//! an object in a cell
+	struct GridEntry
+	{
+		unsigned long long cell;
+		unsigned int bucket;
+		unsigned int id;
+	};
+
+	virtual void clear();
+
+	virtual void insertObject(unsigned int id, const AABB& box);
+
+	virtual void eraseObject(unsigned int id);
+
+	virtual void findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys);
+
+	static unsigned long long cellKey(int x, int y, int z);
+
+	REAL mCellSize;
+
+	REAL mUsedCellSize;
+
+	//! first and last cell of every box
+	std::vector<Eigen::Vector3i> mCellMin;
+	std::vector<Eigen::Vector3i> mCellMax;
+
+	//! first entry of every object, entries in object order and sorted by bucket
+	std::vector<unsigned int> mEntryOffsets;
+	std::vector<GridEntry> mEntries;
+	std::vector<GridEntry> mSorted;
+
+	//! first sorted entry of every bucket and the fill position of every thread during the sort
+	std::vector<unsigned int> mBucketStart;
+	std::vector<unsigned int> mBucketFill;
+};
+
+/*! BruteForceBroadPhase
+ *
+ *  \brief  tests all pairs of boxes, the reference for the other strategies
+ */
+class BruteForceBroadPhase : public BroadPhase
+{
+public:
+
+	virtual const char* getName() const;
+
+protected:
+
+	virtual void clear();
+
+	virtual void insertObject(unsigned int id, const AABB& box);
+
+	virtual void eraseObject(unsigned int id);
+
+	virtual void findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys);
+};
+
+/*! DynamicAABBTree
+ *
+ *  \brief  bounding volume tree for objects of mixed size. Every object is a
+ *          leaf with a fat box, its box grown by a margin. An object is only
+ *          removed and inserted again when its box leaves the fat box.
+ *          Insertion descends to the sibling of least surface area cost.
+ *          Rotations on the way up trade a child for a grandchild when that
+ *          shrinks the boxes, so the tree stays tight as objects move. The
+ *          pairs come from one traversal of the tree against itself.
+ */
+class DynamicAABBTree : public BroadPhase
+{
+public:
+
+	//! constructor
+	DynamicAABBTree();
+
+	virtual const char* getName() const;
+
+	//! margin of the fat boxes relative to the largest box extent
+	void setFatMargin(REAL margin);
+
+	//! height of the tree, 0 for a single leaf
+	int getHeight() const;
+
+	//! number of objects moved in the tree by the last update
+	unsigned int getNumReinserts() const;
+
+protected:
+
+	//! a tree node, leaves have no children and keep their object
+	struct TreeNode
+	{
+		AABB box;
+		int parent;
+		int left;
+		int right;
+		int height;
+		unsigned int object;
+
+		bool isLeaf() const { return left < 0; }
+	};
+
+	virtual void clear();
+
+	virtual void insertObject(unsigned int id, const AABB& box);
+
+	virtual void eraseObject(unsigned int id);
+
+	virtual void findPairs(const std::vector<AABB>& boxes, std::vector<unsigned long long>& keys);
+
+	int allocateNode();
+
+	void freeNode(int node);
+
+	void setFatBox(int leaf, const AABB& box);
+
+	void insertLeaf(int leaf);
+
+	void removeLeaf(int leaf);
+
+	//! refits and rotates from node up to the root
+	void refitUpwards(int node);
+
+	//! swaps a child of node with a grandchild under the other child if that shrinks the other child
+	void rotate(int node);
+
+	//! node pool, unused nodes are chained through parent
+	std::vector<TreeNode> mNodes;
+
+	int mRoot;
+
+	int mFreeList;
+
+	//! leaf node of every object, -1 for removed objects
+	std::vector<int> mLeaves;
+
+	REAL mFatMargin;
+
+	unsigned int mNumReinserts;
+
+	//! node pairs still to be tested by the self query
+	std::vector<int> mStack;
+};
+
+#endif //__BROADPHASE_H__
@@ -0,0 +1,572 @@
+#include "convexhull.h"
+
+#include <fstream>
+#include <queue>
+
+typedef Eigen::Vector3d dvec3;
+
+// a hull face during construction with the points it sees
+struct HullFace
+{
+	int v[3];
+	int neighbor[3];	// face across edge v[k] -> v[k+1]
+	dvec3 normal;
+	double offset;
+	std::vector<int> outside;
+	int farthest;
+	double farthestDistance;
+	bool alive;
+};
+
+// a face waiting for its farthest point to be added, ordered by the distance
+typedef std::pair<double, int> PendingFace;
+
+// plane through the face vertices, normal along (b-a)x(c-a)
+static void setFacePlane(HullFace& f, const std::vector<dvec3>& pts)
+{
+	const dvec3& a = pts[f.v[0]];
+	f.normal = (pts[f.v[1]] - a).cross(pts[f.v[2]] - a);
+	double l = f.normal.norm();
+	if(l > 0)
+		f.normal /= l;
+	f.offset = f.normal.dot(a);
+}
+
+// gives point p to the first face in [first, faces.size()) it lies above
+static void assignPoint(int p, std::vector<HullFace>& faces, unsigned int first, const std::vector<dvec3>& pts, double eps)
+{
+	for(unsigned int i = first; i < faces.size(); ++i)
+	{
+		HullFace& f = faces[i];
+		if(!f.alive)
+			continue;
+		double d = f.normal.dot(pts[p]) - f.offset;
+		if(d > eps)
+		{
+			f.outside.push_back(p);
+			if(d > f.farthestDistance)
+			{
+				f.farthestDistance = d;
+				f.farthest = p;
+			}
+			return;
+		}
+	}
+}
+
+static HullFace makeFace(int a, int b, int c, const std::vector<dvec3>& pts)
+{
+	HullFace f;
+	f.v[0] = a;
+	f.v[1] = b;
+	f.v[2] = c;
+	f.neighbor[0] = f.neighbor[1] = f.neighbor[2] = -1;
+	f.farthest = -1;
+	f.farthestDistance = 0;
+	f.alive = true;
+	setFacePlane(f, pts);
+	return f;
+}
+
+// squared distance of p to the triangle abc by the voronoi regions of the triangle (Ericson)
+static double triangleSquaredDistance(const dvec3& p, const dvec3& a, const dvec3& b, const dvec3& c)
+{
+	const dvec3 ab = b - a, ac = c - a;
+	const double d1 = ab.dot(p - a), d2 = ac.dot(p - a);
+	if(d1 <= 0 && d2 <= 0)
+		return (p - a).squaredNorm();
+	const double d3 = ab.dot(p - b), d4 = ac.dot(p - b);
+	if(d3 >= 0 && d4 <= d3)
+		return (p - b).squaredNorm();
+	const double vc = d1 * d4 - d3 * d2;
+	if(vc <= 0 && d1 >= 0 && d3 <= 0)
+		return (p - (a + ab * (d1 / (d1 - d3)))).squaredNorm();
+	const double d5 = ab.dot(p - c), d6 = ac.dot(p - c);
+	if(d6 >= 0 && d5 <= d6)
+		return (p - c).squaredNorm();
+	const double vb = d5 * d2 - d1 * d6;
+	if(vb <= 0 && d2 >= 0 && d6 <= 0)
+		return (p - (a + ac * (d2 / (d2 - d6)))).squaredNorm();
+	const double va = d3 * d6 - d5 * d4;
+	if(va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+		return (p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))))).squaredNorm();
+	const double sum = va + vb + vc;
+	return (sum > 0) ? (p - (a + ab * (vb / sum) + ac * (vc / sum))).squaredNorm() : (p - a).squaredNorm();
+}
+
+ConvexHull::ConvexHull()
+{
+	clear();
+}
+
+void ConvexHull::clear()
+{
+	mVertices.clear();
+	mTriangles.clear();
+	mNeighborOffsets.clear();
+	mNeighbors.clear();
+	mError = 0;
+}
+
+bool ConvexHull::isEmpty() const
+{
+	return mTriangles.empty();
+}
+
+const std::vector<vec3>& ConvexHull::getVertices() const
+{
+	return mVertices;
+}
+
+const std::vector<ivec3>& ConvexHull::getTriangles() const
+{
+	return mTriangles;
+}
+
+const std::vector<unsigned int>& ConvexHull::getNeighborOffsets() const
+{
+	return mNeighborOffsets;
+}
+
+const std::vector<unsigned int>& ConvexHull::getNeighbors() const
+{
+	return mNeighbors;
+}
+
+REAL ConvexHull::getError() const
+{
+	return mError;
+}
+
+bool ConvexHull::compute(const std::vector<vec3>& points, unsigned int maxVertices)
+{
+	clear();
+
+	const int n = points.size();
+	if(n < 4)
+	{
+		PRINTERROR("convex hull needs at least 4 points");
+		return false;
+	}
+	if(maxVertices > 0 && maxVertices < 4)
+	{
+		PRINTERROR("convex hull needs at least 4 vertices");
+		return false;
+	}
+
+	std::vector<dvec3> pts(n);
+	dvec3 lo = points[0].cast<double>(), hi = lo;
+	for(int i = 0; i < n; ++i)
+	{
+		pts[i] = points[i].cast<double>();
+		lo = lo.cwiseMin(pts[i]);
+		hi = hi.cwiseMax(pts[i]);
+	}
+	const double eps = 1e-7 * (hi - lo).norm();
+
+	// initial simplex: the most distant pair of axis extremes, the point
+	// farthest from their line and the point farthest from that plane
+	int extremes[6] = { 0, 0, 0, 0, 0, 0 };
+	for(int i = 0; i < n; ++i)
+	{
+		for(int k = 0; k < 3; ++k)
+		{
+			if(pts[i][k] < pts[extremes[2 * k]][k]) extremes[2 * k] = i;
+			if(pts[i][k] > pts[extremes[2 * k + 1]][k]) extremes[2 * k + 1] = i;
+		}
+	}
+	int i0 = 0, i1 = 0;
+	double best = -1;
+	for(int a = 0; a < 6; ++a)
+	{
+		for(int b = a + 1; b < 6; ++b)
+		{
+			double d = (pts[extremes[a]] - pts[extremes[b]]).squaredNorm();
+			if(d > best)
+			{
+				best = d;
+				i0 = extremes[a];
+				i1 = extremes[b];
+			}
+		}
+	}
+
+	dvec3 dir = (pts[i1] - pts[i0]).normalized();
+	int i2 = -1;
+	best = eps;
+	for(int i = 0; i < n; ++i)
+	{
+		double d = (pts[i] - pts[i0]).cross(dir).norm();
+		if(d > best)
+		{
+			best = d;
+			i2 = i;
+		}
+	}
+	if(i2 < 0)
+	{
+		PRINTERROR("convex hull input is collinear");
+		return false;
+	}
+
+	dvec3 planeN = (pts[i1] - pts[i0]).cross(pts[i2] - pts[i0]).normalized();
+	int i3 = -1;
+	best = eps;
+	for(int i = 0; i < n; ++i)
+	{
+		double d = std::abs(planeN.dot(pts[i] - pts[i0]));
+		if(d > best)
+		{
+			best = d;
+			i3 = i;
+		}
+	}
+	if(i3 < 0)
+	{
+		PRINTERROR("convex hull input is flat");
+		return false;
+	}
+
+	// tetrahedron with outward normals and its face adjacency
+	std::vector<HullFace> faces;
+	if(planeN.dot(pts[i3] - pts[i0]) > 0)
+		std::swap(i1, i2);
+	faces.push_back(makeFace(i0, i1, i2, pts));
+	faces.push_back(makeFace(i0, i3, i1, pts));
+	faces.push_back(makeFace(i1, i3, i2, pts));
+	faces.push_back(makeFace(i2, i3, i0, pts));
+	for(int f = 0; f < 4; ++f)
+	{
+		for(int k = 0; k < 3; ++k)
+		{
+			int a = faces[f].v[k];
+			int b = faces[f].v[(k + 1) % 3];
+			for(int g = 0; g < 4; ++g)
+			{
+				for(int l = 0; l < 3; ++l)
+				{
+					if(faces[g].v[l] == b && faces[g].v[(l + 1) % 3] == a)
+						faces[f].neighbor[k] = g;
+				}
+			}
+		}
+	}
+
+	for(int i = 0; i < n; ++i)
+	{
+		if(i != i0 && i != i1 && i != i2 && i != i3)
+			assignPoint(i, faces, 0, pts, eps);
+	}
+
+	// faces incident to every point, a point with none is no hull vertex
+	std::vector<int> valence(n, 0);
+	valence[i0] = valence[i1] = valence[i2] = valence[i3] = 3;
+	unsigned int numVertices = 4;
+
+	std::priority_queue<PendingFace> pending;
+	for(int f = 0; f < 4; ++f)
+	{
+		if(!faces[f].outside.empty())
+			pending.push(PendingFace(faces[f].farthestDistance, f));
+	}
+
+	// visited[f] is stamp for faces seen by the current eye, stamp + 1 for faces it does not see
+	std::vector<int> visible, stack, orphans;
+	std::vector<int> horizonFace, horizonEdge;
+	std::vector<int> fanByStart(n, -1);
+	std::vector<unsigned int> visited(faces.size(), 0);
+	unsigned int stamp = 0;
+	while(!pending.empty())
+	{
+		// always add the farthest point of all, so a vertex limit keeps the most important ones
+		const int current = pending.top().second;
+		pending.pop();
+		if(!faces[current].alive)
+			continue;
+		if(maxVertices > 0 && numVertices >= maxVertices)
+			break;
+
+		const int eye = faces[current].farthest;
+		const dvec3& e = pts[eye];
+		stamp += 2;
+
+		// flood the faces seen by the eye, starting at the current face; the
+		// edges to faces it does not see form the horizon
+		visible.clear();
+		horizonFace.clear();
+		horizonEdge.clear();
+		stack.assign(1, current);
+		visited[current] = stamp;
+		while(!stack.empty())
+		{
+			int f = stack.back();
+			stack.pop_back();
+			visible.push_back(f);
+			for(int k = 0; k < 3; ++k)
+			{
+				int g = faces[f].neighbor[k];
+				if(visited[g] >= stamp)
+				{
+					if(visited[g] == stamp + 1)
+					{
+						horizonFace.push_back(f);
+						horizonEdge.push_back(k);
+					}
+					continue;
+				}
+				if(faces[g].normal.dot(e) - faces[g].offset > eps)
+				{
+					visited[g] = stamp;
+					stack.push_back(g);
+				}
+				else
+				{
+					// not visible, may be reached again by other visible faces
+					visited[g] = stamp + 1;
+					horizonFace.push_back(f);
+					horizonEdge.push_back(k);
+				}
+			}
+		}
+
+		orphans.clear();
+		for(unsigned int i = 0; i < visible.size(); ++i)
+		{
+			HullFace& f = faces[visible[i]];
+			f.alive = false;
+			for(int k = 0; k < 3; ++k)
+			{
+				if(--valence[f.v[k]] == 0)
+					--numVertices;
+			}
+			orphans.insert(orphans.end(), f.outside.begin(), f.outside.end());
+			std::vector<int>().swap(f.outside);
+		}
+
+		// fan from the horizon to the eye, glued to the hidden faces and to each other
+		unsigned int first = faces.size();
+		for(unsigned int i = 0; i < horizonFace.size(); ++i)
+		{
+			const HullFace& f = faces[horizonFace[i]];
+			int k = horizonEdge[i];
+			int a = f.v[k];
+			int b = f.v[(k + 1) % 3];
+			int hidden = f.neighbor[k];
+
+			HullFace nf = makeFace(a, b, eye, pts);
+			nf.neighbor[0] = hidden;
+			int idx = faces.size();
+			for(int l = 0; l < 3; ++l)
+			{
+				if(faces[hidden].v[l] == b && faces[hidden].v[(l + 1) % 3] == a)
+					faces[hidden].neighbor[l] = idx;
+			}
+			fanByStart[a] = idx;
+			++valence[a];
+			++valence[b];
+			faces.push_back(nf);
+		}
+		valence[eye] += horizonFace.size();
+		++numVertices;
+		visited.resize(faces.size(), 0);
+		for(unsigned int i = first; i < faces.size(); ++i)
+		{
+			// edge b -> eye meets the fan face starting at b, edge eye -> a the one ending at a
+			int next = fanByStart[faces[i].v[1]];
+			faces[i].neighbor[1] = next;
+			faces[next].neighbor[2] = i;
+		}
+		for(unsigned int i = first; i < faces.size(); ++i)
+			fanByStart[faces[i].v[0]] = -1;
+
+		for(unsigned int i = 0; i < orphans.size(); ++i)
+		{
+			if(orphans[i] != eye)
+				assignPoint(orphans[i], faces, first, pts, eps);
+		}
+		for(unsigned int i = first; i < faces.size(); ++i)
+		{
+			if(!faces[i].outside.empty())
+				pending.push(PendingFace(faces[i].farthestDistance, i));
+		}
+	}
+
+	// the distance of a point left outside by the vertex limit is the distance to the closest
+	// face triangle, the height above a face plane only bounds it from below. Starting with
+	// the own face, a point stops as soon as it is closer than the largest distance so far
+	if(!pending.empty())
+	{
+		std::vector<int> alive;
+		for(unsigned int i = 0; i < faces.size(); ++i)
+		{
+			if(faces[i].alive)
+				alive.push_back(i);
+		}
+		double error = 0;
+		for(unsigned int i = 0; i < alive.size(); ++i)
+		{
+			const HullFace& own = faces[alive[i]];
+			for(unsigned int j = 0; j < own.outside.size(); ++j)
+			{
+				const dvec3& p = pts[own.outside[j]];
+				double d = triangleSquaredDistance(p, pts[own.v[0]], pts[own.v[1]], pts[own.v[2]]);
+				for(unsigned int k = 0; k < alive.size() && d > error; ++k)
+				{
+					const HullFace& f = faces[alive[k]];
+					d = std::min(d, triangleSquaredDistance(p, pts[f.v[0]], pts[f.v[1]], pts[f.v[2]]));
+				}
+				error = std::max(error, d);
+			}
+		}
+		// rounded up, the error is used as a conservative margin
+		error = std::sqrt(error);
+		mError = (REAL)error;
+		if(mError < error)
+			mError = std::nextafter(mError, std::numeric_limits<REAL>::max());
+	}
+
+	// compact the used vertices
+	std::vector<int> remap(n, -1);
+	for(unsigned int i = 0; i < faces.size(); ++i)
+	{
+		if(!faces[i].alive)
+			continue;
+		ivec3 t;
+		for(int k = 0; k < 3; ++k)
+		{
+			int v = faces[i].v[k];
+			if(remap[v] < 0)
+			{
+				remap[v] = mVertices.size();
+				mVertices.push_back(points[v]);
+			}
+			t[k] = remap[v];
+		}
+		mTriangles.push_back(t);
+	}
+
+	// every edge appears in two triangles, once in each direction: the
+	// directed edges a -> b list every neighbor b of a exactly once
+	const unsigned int numHullVertices = mVertices.size();
+	mNeighborOffsets.assign(numHullVertices + 1, 0);
+	for(unsigned int i = 0; i < mTriangles.size(); ++i)
+		for(unsigned int k = 0; k < 3; ++k)
+			++mNeighborOffsets[mTriangles[i][k] + 1];
+	for(unsigned int i = 0; i < numHullVertices; ++i)
+		mNeighborOffsets[i + 1] += mNeighborOffsets[i];
+	mNeighbors.resize(mNeighborOffsets[numHullVertices]);
+	std::vector<unsigned int> fill(mNeighborOffsets.begin(), mNeighborOffsets.end() - 1);
+	for(unsigned int i = 0; i < mTriangles.size(); ++i)
+		for(unsigned int k = 0; k < 3; ++k)
+			mNeighbors[fill[mTriangles[i][k]]++] = mTriangles[i][(k + 1) % 3];
+
+	return true;
+}
+
+bool ConvexHull::loadBinary(const std::string& filename)
+{
+	clear();
+
+	std::ifstream file(filename.c_str(), std::ios::binary | std::ios::ate);
+	if(!file.is_open())
+	{
+		PRINTERROR("could not open " << filename);
+		return false;
+	}
+	const unsigned long long size = file.tellg();
+	file.seekg(0);
+
+	HullFileHeader header;
+	if(!file.read((char*)&header, sizeof(header)) || header.magic != HULL_MAGIC || header.version != HULL_VERSION)
+	{
+		PRINTERROR(filename << " is no hull file of version " << HULL_VERSION);
+		return false;
+	}
+	if(header.numVertices < 4 || header.numTriangles < 4)
+	{
+		PRINTERROR(filename << ": empty hull");
+		return false;
+	}
+
+	// the counts come from the file, check them against its size before anything is allocated.
+	// In 64 bits the products of 32 bit counts and the record sizes cannot wrap around
+	const unsigned long long numVertices = header.numVertices;
+	const unsigned long long numTriangles = header.numTriangles;
+	const unsigned long long expected = sizeof(header) + numVertices * sizeof(vec3) + numTriangles * sizeof(ivec3) +
+		(numVertices + 1) * sizeof(unsigned int) + 3 * numTriangles * sizeof(unsigned int);
+	if(size < expected)
+	{
+		PRINTERROR(filename << " is truncated");
+		return false;
+	}
+
+	mVertices.resize(header.numVertices);
+	mTriangles.resize(header.numTriangles);
+	mNeighborOffsets.resize(header.numVertices + 1);
+	mNeighbors.resize(3 * header.numTriangles);
+	file.read((char*)&mVertices[0], mVertices.size() * sizeof(vec3));
+	file.read((char*)&mTriangles[0], mTriangles.size() * sizeof(ivec3));
+	file.read((char*)&mNeighborOffsets[0], mNeighborOffsets.size() * sizeof(unsigned int));
+	file.read((char*)&mNeighbors[0], mNeighbors.size() * sizeof(unsigned int));
+	if(!file)
+	{
+		PRINTERROR(filename << " is truncated");
+		clear();
+		return false;
+	}
+
+	// indices are used unchecked later
+	bool valid = mNeighborOffsets[0] == 0 && mNeighborOffsets[header.numVertices] == mNeighbors.size();
+	for(unsigned int i = 0; valid && i < header.numVertices; ++i)
+		valid = mNeighborOffsets[i] <= mNeighborOffsets[i + 1];
+	for(unsigned int i = 0; valid && i < mNeighbors.size(); ++i)
+		valid = mNeighbors[i] < header.numVertices;
+	for(unsigned int i = 0; valid && i < mTriangles.size(); ++i)
+		valid = mTriangles[i].maxCoeff() < header.numVertices;
+	if(!valid)
+	{
+		PRINTERROR(filename << ": invalid hull");
+		clear();
+		return false;
+	}
+	mError = header.error;
+
+	return true;
+}
+
+bool ConvexHull::saveBinary(const std::string& filename) const
+{
+	if(isEmpty())
+	{
+		PRINTERROR("no hull to write");
+		return false;
+	}
+
+	std::ofstream file(filename.c_str(), std::ios::binary);
+	if(!file.is_open())
+	{
+		PRINTERROR("could not open " << filename);
+		return false;
+	}
+
+	HullFileHeader header;
+	header.magic = HULL_MAGIC;
+	header.version = HULL_VERSION;
+	header.numVertices = mVertices.size();
+	header.numTriangles = mTriangles.size();
+	header.error = mError;
+
+	file.write((const char*)&header, sizeof(header));
+	file.write((const char*)&mVertices[0], mVertices.size() * sizeof(vec3));
+	file.write((const char*)&mTriangles[0], mTriangles.size() * sizeof(ivec3));
+	file.write((const char*)&mNeighborOffsets[0], mNeighborOffsets.size() * sizeof(unsigned int));
+	file.write((const char*)&mNeighbors[0], mNeighbors.size() * sizeof(unsigned int));
+
+	if(!file.good())
+	{
+		PRINTERROR("could not write " << filename);
+		return false;
+	}
+
+	return true;
+}
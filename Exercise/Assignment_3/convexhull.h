@@ -0,0 +1,79 @@
+#ifndef __CONVEXHULL_H__
+#define __CONVEXHULL_H__
+
+#include "platform.h"
+
+#define HULL_MAGIC 0x4C4C5548 // "HULL"
+#define HULL_VERSION 1
+
+//! header of the binary hull files
+struct HullFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int numVertices;
+	unsigned int numTriangles;
+	float error;
+};
+
+/*! ConvexHull
+ *
+ *  \brief  convex hull of a point set built with quickhull: start from a
+ *          tetrahedron of extreme points, repeatedly take the point farthest
+ *          outside of all faces, flood the connected faces it sees over the
+ *          face adjacency and close the hole with a fan to the horizon.
+ *          Computed in double precision, the result is a compact vertex list,
+ *          outward oriented triangles and the vertex adjacency. A vertex
+ *          limit stops early, the hull then lies inside the points by up to
+ *          getError(). The binary format is the header ("HULL", version,
+ *          number of vertices and triangles, error), the vertices, the
+ *          triangles, the neighbor offsets and the neighbors.
+ */
+class ConvexHull
+{
+public:
+
+	//! constructor
+	ConvexHull();
+
+	//! removes the hull
+	void clear();
+
+	//! computes the hull of points with at most maxVertices vertices (0 for no limit), false for degenerate (flat) input
+	bool compute(const std::vector<vec3>& points, unsigned int maxVertices = 0);
+
+	//! reads a binary hull file
+	bool loadBinary(const std::string& filename);
+
+	//! writes the hull as binary file
+	bool saveBinary(const std::string& filename) const;
+
+	//! true if no hull was computed
+	bool isEmpty() const;
+
+	//! the hull vertices
+	const std::vector<vec3>& getVertices() const;
+
+	//! outward oriented triangles indexing the hull vertices
+	const std::vector<ivec3>& getTriangles() const;
+
+	//! neighbors of vertex i are getNeighbors()[getNeighborOffsets()[i]] to getNeighbors()[getNeighborOffsets()[i + 1] - 1]
+	const std::vector<unsigned int>& getNeighborOffsets() const;
+	const std::vector<unsigned int>& getNeighbors() const;
+
+	//! largest euclidean distance of an input point to the hull, 0 unless the vertex limit was hit
+	REAL getError() const;
+
+protected:
+
+	std::vector<vec3> mVertices;
+
+	std::vector<ivec3> mTriangles;
+
+	std::vector<unsigned int> mNeighborOffsets;
+	std::vector<unsigned int> mNeighbors;
+
+	REAL mError;
+};
+
+#endif //__CONVEXHULL_H__
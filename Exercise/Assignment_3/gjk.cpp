@@ -0,0 +1,701 @@
+#include "gjk.h"
+
+typedef Eigen::Vector3d dvec3;
+
+#define GJK_MAX_ITERATIONS 64
+#define EPA_MAX_ITERATIONS 64
+#define TOI_MAX_ITERATIONS 32
+
+// relative progress below which gjk and epa stop
+#define GJK_TOLERANCE 1e-6
+
+// a vertex of the minkowski difference A - B and the hull vertices it comes from
+struct SimplexVertex
+{
+	dvec3 w;
+	dvec3 a;
+	dvec3 b;
+	unsigned int indexA;
+	unsigned int indexB;
+};
+
+// up to four vertices and the barycentric weights of the point closest to the origin
+struct Simplex
+{
+	SimplexVertex v[4];
+	double lambda[4];
+	unsigned int n;
+};
+
+// both hulls in world space, support points come from hill climbing in the local frames
+struct GJKShapes
+{
+	const HullSupport* A;
+	const HullSupport* B;
+	mat3 RA, RB;
+	vec3 tA, tB;
+	unsigned int startA, startB;
+
+	void vertex(unsigned int indexA, unsigned int indexB, SimplexVertex& out) const
+	{
+		out.indexA = indexA;
+		out.indexB = indexB;
+		out.a = (RA * A->getVertices()[indexA] + tA).cast<double>();
+		out.b = (RB * B->getVertices()[indexB] + tB).cast<double>();
+		out.w = out.a - out.b;
+	}
+
+	// support of A - B along d: A along d, B against it
+	void support(const dvec3& d, SimplexVertex& out)
+	{
+		const vec3 df = d.cast<REAL>();
+		startA = A->getSupport(RA.transpose() * df, startA);
+		startB = B->getSupport(-(RB.transpose() * df), startB);
+		vertex(startA, startB, out);
+	}
+};
+
+HullSupport::HullSupport()
+{
+	clear();
+}
+
+void HullSupport::clear()
+{
+	mVertices.clear();
+	mNeighborOffsets.clear();
+	mNeighbors.clear();
+	mSeeds.clear();
+}
+
+bool HullSupport::setHull(const ConvexHull& hull)
+{
+	clear();
+	if(hull.isEmpty())
+	{
+		PRINTERROR("hull support needs a convex hull");
+		return false;
+	}
+	mVertices = hull.getVertices();
+
+	mNeighborOffsets = hull.getNeighborOffsets();
+	mNeighbors = hull.getNeighbors();
+	const unsigned int n = mVertices.size();
+
+	// the extreme vertices along the 26 directions to the cube corners, edges and faces
+	for(int x = -1; x <= 1; ++x)
+	{
+		for(int y = -1; y <= 1; ++y)
+		{
+			for(int z = -1; z <= 1; ++z)
+			{
+				if(x == 0 && y == 0 && z == 0)
+					continue;
+				const vec3 d((REAL)x, (REAL)y, (REAL)z);
+				unsigned int best = 0;
+				for(unsigned int i = 1; i < n; ++i)
+				{
+					if(d.dot(mVertices[i]) > d.dot(mVertices[best]))
+						best = i;
+				}
+				if(std::find(mSeeds.begin(), mSeeds.end(), best) == mSeeds.end())
+					mSeeds.push_back(best);
+			}
+		}
+	}
+
+	return true;
+}
+
+bool HullSupport::isEmpty() const
+{
+	return mVertices.empty();
+}
+
+unsigned int HullSupport::getSupport(const vec3& d, unsigned int start) const
+{
+	// the start competes with the seeds, so a cold start does not climb across the hull
+	unsigned int best = start < mVertices.size() ? start : 0;
+	REAL bestDistance = d.dot(mVertices[best]);
+	for(unsigned int i = 0; i < mSeeds.size(); ++i)
+	{
+		const REAL distance = d.dot(mVertices[mSeeds[i]]);
+		if(distance > bestDistance)
+		{
+			best = mSeeds[i];
+			bestDistance = distance;
+		}
+	}
+
+	// steepest ascent over the neighbors
+	unsigned int current = mVertices.size();
+	while(current != best)
+	{
+		current = best;
+		for(unsigned int i = mNeighborOffsets[current]; i < mNeighborOffsets[current + 1]; ++i)
+		{
+			const unsigned int neighbor = mNeighbors[i];
+			const REAL distance = d.dot(mVertices[neighbor]);
+			if(distance > bestDistance)
+			{
+				best = neighbor;
+				bestDistance = distance;
+			}
+		}
+	}
+	return best;
+}
+
+const std::vector<vec3>& HullSupport::getVertices() const
+{
+	return mVertices;
+}
+
+GJKCache::GJKCache()
+{
+	reset();
+}
+
+void GJKCache::reset()
+{
+	numVertices = 0;
+	supportA = supportB = 0;
+}
+
+// reduces the simplex to the vertices given by the index list, with their weights
+static void keepVertices(Simplex& s, unsigned int n, const unsigned int* indices, const double* lambda)
+{
+	SimplexVertex v[4];
+	for(unsigned int i = 0; i < n; ++i)
+		v[i] = s.v[indices[i]];
+	for(unsigned int i = 0; i < n; ++i)
+	{
+		s.v[i] = v[i];
+		s.lambda[i] = lambda[i];
+	}
+	s.n = n;
+}
+
+static dvec3 closestOnSegment(Simplex& s)
+{
+	const dvec3& a = s.v[0].w;
+	const dvec3 ab = s.v[1].w - a;
+	const double t = -a.dot(ab);
+	const double denominator = ab.squaredNorm();
+	if(t <= 0 || denominator <= 0)
+	{
+		const unsigned int keep[1] = { 0 };
+		const double lambda[1] = { 1 };
+		keepVertices(s, 1, keep, lambda);
+		return s.v[0].w;
+	}
+	if(t >= denominator)
+	{
+		const unsigned int keep[1] = { 1 };
+		const double lambda[1] = { 1 };
+		keepVertices(s, 1, keep, lambda);
+		return s.v[0].w;
+	}
+	s.lambda[0] = 1 - t / denominator;
+	s.lambda[1] = t / denominator;
+	return a + ab * (t / denominator);
+}
+
+// closest point of the triangle to the origin by its voronoi regions (Ericson)
+static dvec3 closestOnTriangle(Simplex& s)
+{
+	const dvec3& a = s.v[0].w;
+	const dvec3& b = s.v[1].w;
+	const dvec3& c = s.v[2].w;
+	const dvec3 ab = b - a;
+	const dvec3 ac = c - a;
+
+	const double d1 = -ab.dot(a);
+	const double d2 = -ac.dot(a);
+	if(d1 <= 0 && d2 <= 0)
+	{
+		const unsigned int keep[1] = { 0 };
+		const double lambda[1] = { 1 };
+		keepVertices(s, 1, keep, lambda);
+		return s.v[0].w;
+	}
+
+	const double d3 = -ab.dot(b);
+	const double d4 = -ac.dot(b);
+	if(d3 >= 0 && d4 <= d3)
+	{
+		const unsigned int keep[1] = { 1 };
+		const double lambda[1] = { 1 };
+		keepVertices(s, 1, keep, lambda);
+		return s.v[0].w;
+	}
+
+	const double vc = d1 * d4 - d3 * d2;
+	if(vc <= 0 && d1 >= 0 && d3 <= 0)
+	{
+		const double t = d1 / (d1 - d3);
+		const unsigned int keep[2] = { 0, 1 };
+		const double lambda[2] = { 1 - t, t };
+		keepVertices(s, 2, keep, lambda);
+		return a + ab * t;
+	}
+
+	const double d5 = -ab.dot(c);
+	const double d6 = -ac.dot(c);
+	if(d6 >= 0 && d5 <= d6)
+	{
+		const unsigned int keep[1] = { 2 };
+		const double lambda[1] = { 1 };
+		keepVertices(s, 1, keep, lambda);
+		return s.v[0].w;
+	}
+
+	const double vb = d5 * d2 - d1 * d6;
+	if(vb <= 0 && d2 >= 0 && d6 <= 0)
+	{
+		const double t = d2 / (d2 - d6);
+		const dvec3 p = a + ac * t;
+		const unsigned int keep[2] = { 0, 2 };
+		const double lambda[2] = { 1 - t, t };
+		keepVertices(s, 2, keep, lambda);
+		return p;
+	}
+
+	const double va = d3 * d6 - d5 * d4;
+	if(va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+	{
+		const double t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		const dvec3 p = b + (c - b) * t;
+		const unsigned int keep[2] = { 1, 2 };
+		const double lambda[2] = { 1 - t, t };
+		keepVertices(s, 2, keep, lambda);
+		return p;
+	}
+
+	const double sum = va + vb + vc;
+	if(sum <= 0)
+	{
+		// degenerate triangle, its longest edge holds the closest point
+		const double lab = ab.squaredNorm(), lac = ac.squaredNorm(), lbc = (c - b).squaredNorm();
+		unsigned int keep[2] = { 0, 1 };
+		if(lac >= lab && lac >= lbc)
+			keep[1] = 2;
+		else if(lbc >= lab)
+			keep[0] = 2;
+		const double lambda[2] = { 0.5, 0.5 };
+		keepVertices(s, 2, keep, lambda);
+		return closestOnSegment(s);
+	}
+	const double v = vb / sum;
+	const double w = vc / sum;
+	s.lambda[0] = 1 - v - w;
+	s.lambda[1] = v;
+	s.lambda[2] = w;
+	return a + ab * v + ac * w;
+}
+
+// closest point of the tetrahedron to the origin, false if the origin lies inside
+static bool closestOnTetrahedron(Simplex& s, dvec3& closest)
+{
+	static const unsigned int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 3, 1, 2 }, { 0, 2, 3, 1 }, { 1, 3, 2, 0 } };
+	const double volume = (s.v[1].w - s.v[0].w).cross(s.v[2].w - s.v[0].w).dot(s.v[3].w - s.v[0].w);
+	double scale = 0;
+	for(unsigned int i = 1; i < 4; ++i)
+		scale = std::max(scale, (s.v[i].w - s.v[0].w).squaredNorm());
+	const bool flat = std::abs(volume) <= 1e-12 * scale * std::sqrt(scale);
+
+	double best = std::numeric_limits<double>::max();
+	Simplex bestSimplex;
+	bool outside = false;
+	for(unsigned int f = 0; f < 4; ++f)
+	{
+		const dvec3& a = s.v[faces[f][0]].w;
+		const dvec3 n = (s.v[faces[f][1]].w - a).cross(s.v[faces[f][2]].w - a);
+		const double originSide = -n.dot(a);
+		const double otherSide = n.dot(s.v[faces[f][3]].w - a);
+		// the origin is beyond the face if it is on the other side than the fourth vertex
+		if(!flat && originSide * otherSide >= 0)
+			continue;
+		outside = true;
+
+		Simplex face;
+		face.n = 3;
+		for(unsigned int k = 0; k < 3; ++k)
+			face.v[k] = s.v[faces[f][k]];
+		const dvec3 p = closestOnTriangle(face);
+		if(p.squaredNorm() < best)
+		{
+			best = p.squaredNorm();
+			bestSimplex = face;
+			closest = p;
+		}
+	}
+	if(!outside)
+	{
+		s.lambda[0] = s.lambda[1] = s.lambda[2] = s.lambda[3] = 0.25;
+		return false;
+	}
+	s = bestSimplex;
+	return true;
+}
+
+// closest point of the simplex to the origin, reducing it to the vertices that
+// support that point. False if the origin is enclosed by a tetrahedron.
+static bool closestOnSimplex(Simplex& s, dvec3& closest)
+{
+	switch(s.n)
+	{
+	case 1:
+		s.lambda[0] = 1;
+		closest = s.v[0].w;
+		return true;
+	case 2:
+		closest = closestOnSegment(s);
+		return true;
+	case 3:
+		closest = closestOnTriangle(s);
+		return true;
+	default:
+		return closestOnTetrahedron(s, closest);
+	}
+}
+
+static void storeCache(const Simplex& s, const GJKShapes& shapes, GJKCache& cache)
+{
+	cache.numVertices = s.n;
+	for(unsigned int i = 0; i < s.n; ++i)
+	{
+		cache.indexA[i] = s.v[i].indexA;
+		cache.indexB[i] = s.v[i].indexB;
+	}
+	cache.supportA = shapes.startA;
+	cache.supportB = shapes.startB;
+}
+
+// the gjk iteration, leaves the final simplex in s. True if the hulls are separated.
+static bool runGJK(GJKShapes& shapes, GJKCache& cache, Simplex& s, GJKResult& result)
+{
+	result.intersecting = false;
+	result.distance = 0;
+	result.depth = 0;
+	result.normal = vec3(1, 0, 0);
+	result.numIterations = 0;
+
+	// warm start from the simplex of the last query, at the current poses
+	s.n = 0;
+	for(unsigned int i = 0; i < cache.numVertices; ++i)
+	{
+		if(cache.indexA[i] < shapes.A->getVertices().size() && cache.indexB[i] < shapes.B->getVertices().size())
+			shapes.vertex(cache.indexA[i], cache.indexB[i], s.v[s.n++]);
+	}
+	if(s.n == 0)
+	{
+		shapes.support(dvec3(1, 0, 0), s.v[0]);
+		s.n = 1;
+		++result.numIterations;
+	}
+
+	dvec3 v;
+	bool separated = closestOnSimplex(s, v);
+	double scale = s.v[0].w.squaredNorm();
+	while(separated && result.numIterations < GJK_MAX_ITERATIONS)
+	{
+		const double vv = v.squaredNorm();
+		if(vv <= 1e-12 * scale)
+		{
+			// the origin is on the simplex, the hulls touch
+			separated = false;
+			break;
+		}
+
+		SimplexVertex w;
+		shapes.support(-v, w);
+		++result.numIterations;
+		scale = std::max(scale, w.w.squaredNorm());
+
+		// no progress towards the origin: v is the distance vector
+		if(vv - v.dot(w.w) <= GJK_TOLERANCE * vv)
+			break;
+		bool known = false;
+		for(unsigned int i = 0; i < s.n; ++i)
+			known = known || (s.v[i].indexA == w.indexA && s.v[i].indexB == w.indexB);
+		if(known)
+			break;
+
+		s.v[s.n++] = w;
+		separated = closestOnSimplex(s, v);
+	}
+	storeCache(s, shapes, cache);
+
+	if(!separated)
+	{
+		result.intersecting = true;
+		return false;
+	}
+
+	dvec3 pointA = dvec3::Zero(), pointB = dvec3::Zero();
+	for(unsigned int i = 0; i < s.n; ++i)
+	{
+		pointA += s.lambda[i] * s.v[i].a;
+		pointB += s.lambda[i] * s.v[i].b;
+	}
+	result.pointA = pointA.cast<REAL>();
+	result.pointB = pointB.cast<REAL>();
+	result.distance = (REAL)v.norm();
+	result.normal = (-v / v.norm()).cast<REAL>();
+	return true;
+}
+
+static void initShapes(const HullSupport& A, const mat4& MA, const HullSupport& B, const mat4& MB, const GJKCache& cache, GJKShapes& shapes)
+{
+	shapes.A = &A;
+	shapes.B = &B;
+	shapes.RA = MA.block<3, 3>(0, 0);
+	shapes.RB = MB.block<3, 3>(0, 0);
+	shapes.tA = MA.block<3, 1>(0, 3);
+	shapes.tB = MB.block<3, 1>(0, 3);
+	shapes.startA = cache.supportA;
+	shapes.startB = cache.supportB;
+}
+
+bool gjkDistance(const HullSupport& A, const mat4& MA, const HullSupport& B, const mat4& MB, GJKCache& cache, GJKResult& result)
+{
+	if(A.isEmpty() || B.isEmpty())
+	{
+		PRINTERROR("gjk needs two hulls");
+		return false;
+	}
+	GJKShapes shapes;
+	initShapes(A, MA, B, MB, cache, shapes);
+	Simplex s;
+	return runGJK(shapes, cache, s, result);
+}
+
+// a face of the expanding polytope with its outward normal and distance to the origin
+struct EPAFace
+{
+	unsigned int v[3];
+	dvec3 normal;
+	double distance;
+	bool alive;
+};
+
+static bool makeFace(const std::vector<SimplexVertex>& vertices, unsigned int a, unsigned int b, unsigned int c, EPAFace& face)
+{
+	face.v[0] = a;
+	face.v[1] = b;
+	face.v[2] = c;
+	face.normal = (vertices[b].w - vertices[a].w).cross(vertices[c].w - vertices[a].w);
+	const double l = face.normal.norm();
+	if(l <= 0)
+		return false;
+	face.normal /= l;
+	face.distance = face.normal.dot(vertices[a].w);
+	face.alive = true;
+	return true;
+}
+
+// grows a simplex that holds the origin to a tetrahedron, false if the hulls only touch
+static bool completeTetrahedron(GJKShapes& shapes, Simplex& s, double scale)
+{
+	const double minimum = 1e-10 * scale;
+	const dvec3 axes[3] = { dvec3(1, 0, 0), dvec3(0, 1, 0), dvec3(0, 0, 1) };
+	while(s.n < 4)
+	{
+		// search directions orthogonal to the current simplex
+		std::vector<dvec3> directions;
+		if(s.n == 1)
+		{
+			for(unsigned int k = 0; k < 3; ++k)
+			{
+				directions.push_back(axes[k]);
+				directions.push_back(-axes[k]);
+			}
+		}
+		else if(s.n == 2)
+		{
+			const dvec3 d = (s.v[1].w - s.v[0].w).normalized();
+			unsigned int k = std::abs(d[0]) < std::abs(d[1]) ? (std::abs(d[0]) < std::abs(d[2]) ? 0 : 2) : (std::abs(d[1]) < std::abs(d[2]) ? 1 : 2);
+			const dvec3 u = d.cross(axes[k]).normalized();
+			const dvec3 w = d.cross(u);
+			for(unsigned int i = 0; i < 6; ++i)
+				directions.push_back(u * std::cos(i * M_PI / 3) + w * std::sin(i * M_PI / 3));
+		}
+		else
+		{
+			const dvec3 n = (s.v[1].w - s.v[0].w).cross(s.v[2].w - s.v[0].w).normalized();
+			directions.push_back(n);
+			directions.push_back(-n);
+		}
+
+		bool added = false;
+		for(unsigned int i = 0; i < directions.size() && !added; ++i)
+		{
+			SimplexVertex w;
+			shapes.support(directions[i], w);
+			// the new vertex has to leave the span of the simplex
+			double distance;
+			if(s.n == 1)
+				distance = (w.w - s.v[0].w).squaredNorm();
+			else if(s.n == 2)
+				distance = (w.w - s.v[0].w).cross(s.v[1].w - s.v[0].w).squaredNorm() / (s.v[1].w - s.v[0].w).squaredNorm();
+			else
+			{
+				const double d = directions[i].dot(w.w - s.v[0].w);
+				distance = d * d;
+			}
+			if(distance > minimum)
+			{
+				s.v[s.n++] = w;
+				added = true;
+			}
+		}
+		if(!added)
+			return false;
+	}
+	return true;
+}
+
+bool epaPenetration(const HullSupport& A, const mat4& MA, const HullSupport& B, const mat4& MB, GJKCache& cache, GJKResult& result)
+{
+	if(A.isEmpty() || B.isEmpty())
+	{
+		PRINTERROR("epa needs two hulls");
+		return false;
+	}
+	GJKShapes shapes;
+	initShapes(A, MA, B, MB, cache, shapes);
+	Simplex s;
+	if(runGJK(shapes, cache, s, result))
+		return false;
+
+	double scale = 0;
+	for(unsigned int i = 0; i < s.n; ++i)
+		scale = std::max(scale, s.v[i].w.squaredNorm());
+	if(!completeTetrahedron(shapes, s, std::max(scale, 1e-12)))
+	{
+		// touching without volume
+		result.pointA = result.pointB = s.v[0].a.cast<REAL>();
+		return true;
+	}
+
+	// tetrahedron with outward faces, wound as in the convex hull
+	std::vector<SimplexVertex> vertices(s.v, s.v + 4);
+	vertices.reserve(4 + EPA_MAX_ITERATIONS);
+	if((vertices[1].w - vertices[0].w).cross(vertices[2].w - vertices[0].w).dot(vertices[3].w - vertices[0].w) > 0)
+		std::swap(vertices[1], vertices[2]);
+	std::vector<EPAFace> faces(4);
+	faces.reserve(64);
+	if(!makeFace(vertices, 0, 1, 2, faces[0]) || !makeFace(vertices, 0, 3, 1, faces[1]) ||
+		!makeFace(vertices, 1, 3, 2, faces[2]) || !makeFace(vertices, 2, 3, 0, faces[3]))
+	{
+		result.pointA = result.pointB = s.v[0].a.cast<REAL>();
+		return true;
+	}
+
+	std::vector<unsigned int> horizon;
+	unsigned int closest = 0;
+	for(unsigned int iteration = 0; iteration < EPA_MAX_ITERATIONS; ++iteration)
+	{
+		closest = faces.size();
+		for(unsigned int f = 0; f < faces.size(); ++f)
+		{
+			if(faces[f].alive && (closest == faces.size() || faces[f].distance < faces[closest].distance))
+				closest = f;
+		}
+
+		SimplexVertex w;
+		shapes.support(faces[closest].normal, w);
+		++result.numIterations;
+		const double distance = faces[closest].normal.dot(w.w);
+		if(distance - faces[closest].distance <= GJK_TOLERANCE * std::max(std::sqrt(scale), distance))
+			break;
+
+		// remove the faces the new vertex sees, their open edges form the horizon
+		const unsigned int index = vertices.size();
+		vertices.push_back(w);
+		horizon.clear();
+		for(unsigned int f = 0; f < faces.size(); ++f)
+		{
+			if(!faces[f].alive || faces[f].normal.dot(w.w - vertices[faces[f].v[0]].w) <= 0)
+				continue;
+			faces[f].alive = false;
+			for(unsigned int k = 0; k < 3; ++k)
+			{
+				const unsigned int a = faces[f].v[k];
+				const unsigned int b = faces[f].v[(k + 1) % 3];
+				// an edge shared with another removed face is inside the hole
+				bool shared = false;
+				for(unsigned int e = 0; e < horizon.size() && !shared; e += 2)
+				{
+					if(horizon[e] == b && horizon[e + 1] == a)
+					{
+						horizon.erase(horizon.begin() + e, horizon.begin() + e + 2);
+						shared = true;
+					}
+				}
+				if(!shared)
+				{
+					horizon.push_back(a);
+					horizon.push_back(b);
+				}
+			}
+		}
+		for(unsigned int e = 0; e < horizon.size(); e += 2)
+		{
+			EPAFace face;
+			if(makeFace(vertices, horizon[e], horizon[e + 1], index, face))
+				faces.push_back(face);
+		}
+	}
+
+	// the origin projected onto the closest face, in barycentric weights of its corners
+	const EPAFace& face = faces[closest];
+	const dvec3 p = face.normal * face.distance;
+	const dvec3& a = vertices[face.v[0]].w;
+	const dvec3& b = vertices[face.v[1]].w;
+	const dvec3& c = vertices[face.v[2]].w;
+	const double area = (b - a).cross(c - a).dot(face.normal);
+	double u = (b - p).cross(c - p).dot(face.normal) / area;
+	double v = (c - p).cross(a - p).dot(face.normal) / area;
+	double w = 1 - u - v;
+	dvec3 pointA = u * vertices[face.v[0]].a + v * vertices[face.v[1]].a + w * vertices[face.v[2]].a;
+	dvec3 pointB = u * vertices[face.v[0]].b + v * vertices[face.v[1]].b + w * vertices[face.v[2]].b;
+
+	result.depth = (REAL)face.distance;
+	result.normal = face.normal.cast<REAL>();
+	result.pointA = pointA.cast<REAL>();
+	result.pointB = pointB.cast<REAL>();
+	cache.supportA = shapes.startA;
+	cache.supportB = shapes.startB;
+	return true;
+}
+
+bool timeOfImpact(const HullSupport& A, const mat4& MA, const vec3& vA, const HullSupport& B, const mat4& MB, const vec3& vB,
+	REAL margin, REAL tolerance, GJKCache& cache, REAL& toi, GJKResult& result)
+{
+	mat4 ma = MA, mb = MB;
+	unsigned int numIterations = 0;
+	toi = 0;
+	for(unsigned int i = 0; i < TOI_MAX_ITERATIONS; ++i)
+	{
+		ma.block<3, 1>(0, 3) = MA.block<3, 1>(0, 3) + toi * vA;
+		mb.block<3, 1>(0, 3) = MB.block<3, 1>(0, 3) + toi * vB;
+		const bool separated = gjkDistance(A, ma, B, mb, cache, result);
+		numIterations += result.numIterations;
+		result.numIterations = numIterations;
+		if(!separated || result.distance <= margin + tolerance)
+			return true;
+
+		// a gap that does not close stays open for the rest of the step
+		const REAL closing = (vA - vB).dot(result.normal);
+		if(closing <= 0)
+			return false;
+		toi += (result.distance - margin) / closing;
+		if(toi > 1)
+			return false;
+	}
+
+	// not converged, toi is still before the contact
+	return true;
+}
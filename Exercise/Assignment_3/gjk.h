@@ -0,0 +1,106 @@
+#ifndef __GJK_H__
+#define __GJK_H__
+
+#include "platform.h"
+#include "convexhull.h"
+
+/*! HullSupport
+ *
+ *  \brief  support mapping of a convex hull in its local frame. The vertex
+ *          farthest along a direction is found by hill climbing over the
+ *          vertex adjacency of the hull, starting from a given vertex. On a
+ *          convex polytope a vertex with no better neighbor is the maximum.
+ *          The climb starts from the better of the given vertex, usually the
+ *          answer of the previous query, and a few extreme vertices, so it
+ *          takes a few steps.
+ */
+class HullSupport
+{
+public:
+
+	//! constructor
+	HullSupport();
+
+	//! removes the hull
+	void clear();
+
+	//! takes the hull vertices and their adjacency
+	bool setHull(const ConvexHull& hull);
+
+	//! true if no hull was set
+	bool isEmpty() const;
+
+	//! index of the vertex farthest along d, climbing from vertex start
+	unsigned int getSupport(const vec3& d, unsigned int start) const;
+
+	const std::vector<vec3>& getVertices() const;
+
+protected:
+
+	std::vector<vec3> mVertices;
+
+	//! neighbors of vertex i are mNeighbors[mNeighborOffsets[i]] to mNeighbors[mNeighborOffsets[i + 1] - 1]
+	std::vector<unsigned int> mNeighborOffsets;
+	std::vector<unsigned int> mNeighbors;
+
+	//! the extreme vertices along a few fixed directions
+	std::vector<unsigned int> mSeeds;
+};
+
+//! state of a query kept between frames for one pair of hulls: the final
+//! simplex and the last support vertices to start the next query from
+struct GJKCache
+{
+	unsigned int numVertices;
+	unsigned int indexA[4];
+	unsigned int indexB[4];
+	unsigned int supportA;
+	unsigned int supportB;
+
+	GJKCache();
+
+	//! forgets the simplex, the next query starts cold
+	void reset();
+};
+
+//! result of a distance or penetration query, in world space
+struct GJKResult
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	bool intersecting;
+
+	//! distance between the hulls, 0 if they intersect
+	REAL distance;
+
+	//! penetration depth, 0 if separated. Moving B by depth along normal separates them.
+	REAL depth;
+
+	//! unit normal pointing from A towards B
+	vec3 normal;
+
+	//! closest points of separated hulls, the deepest points of intersecting ones
+	vec3 pointA;
+	vec3 pointB;
+
+	//! support evaluations of gjk and epa
+	unsigned int numIterations;
+};
+
+//! distance of the hulls A and B placed by MA and MB (GJK), warm started from cache
+//! and leaving the final simplex in it. True if they are separated.
+bool gjkDistance(const HullSupport& A, const mat4& MA, const HullSupport& B, const mat4& MB, GJKCache& cache, GJKResult& result);
+
+//! gjkDistance, and for intersecting hulls the penetration depth and normal by
+//! expanding the gjk simplex (EPA). True if they intersect.
+bool epaPenetration(const HullSupport& A, const mat4& MA, const HullSupport& B, const mat4& MB, GJKCache& cache, GJKResult& result);
+
+//! first time in [0, 1] at which the hulls A and B, placed by MA and MB and translating
+//! by vA and vB over the step, come within margin + tolerance (conservative advancement).
+//! The gap along the gjk normal is a lower bound of the distance and closes no faster
+//! than the relative velocity along the normal, so the hulls advance by gap / speed
+//! without passing each other. True if they meet, result holds the query at toi.
+bool timeOfImpact(const HullSupport& A, const mat4& MA, const vec3& vA, const HullSupport& B, const mat4& MB, const vec3& vB,
+	REAL margin, REAL tolerance, GJKCache& cache, REAL& toi, GJKResult& result);
+
+#endif //__GJK_H__
@@ -0,0 +1,71 @@
+#include "kdop.h"
+
+KDOP18::KDOP18()
+{
+	for(unsigned int i = 0; i < KDOP_NUM_AXES; ++i)
+		minDistance[i] = maxDistance[i] = 0;
+}
+
+void KDOP18::setEmpty()
+{
+	for(unsigned int i = 0; i < KDOP_NUM_AXES; ++i)
+	{
+		minDistance[i] = std::numeric_limits<REAL>::max();
+		maxDistance[i] = -std::numeric_limits<REAL>::max();
+	}
+}
+
+void KDOP18::setFromVertices(const std::vector<vec3>& vertices)
+{
+	setEmpty();
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+		expand(vertices[i]);
+}
+
+void KDOP18::setFromTransformedVertices(const std::vector<vec3>& vertices, const mat4& M)
+{
+	setEmpty();
+	const mat3 R = M.block<3, 3>(0, 0);
+	const vec3 t = M.block<3, 1>(0, 3);
+	for(unsigned int i = 0; i < vertices.size(); ++i)
+		expand(R * vertices[i] + t);
+}
+
+void KDOP18::expand(const vec3& p)
+{
+	// the diagonals are not normalized, every slab only compares against its own kind
+	const REAL d[KDOP_NUM_AXES] = { p[0], p[1], p[2],
+		p[0] + p[1], p[0] - p[1], p[0] + p[2], p[0] - p[2], p[1] + p[2], p[1] - p[2] };
+	for(unsigned int i = 0; i < KDOP_NUM_AXES; ++i)
+	{
+		minDistance[i] = std::min(minDistance[i], d[i]);
+		maxDistance[i] = std::max(maxDistance[i], d[i]);
+	}
+}
+
+void KDOP18::translate(const vec3& t)
+{
+	const REAL d[KDOP_NUM_AXES] = { t[0], t[1], t[2],
+		t[0] + t[1], t[0] - t[1], t[0] + t[2], t[0] - t[2], t[1] + t[2], t[1] - t[2] };
+	for(unsigned int i = 0; i < KDOP_NUM_AXES; ++i)
+	{
+		minDistance[i] += d[i];
+		maxDistance[i] += d[i];
+	}
+}
+
+bool KDOP18::overlaps(const KDOP18& other) const
+{
+	for(unsigned int i = 0; i < KDOP_NUM_AXES; ++i)
+	{
+		if(minDistance[i] > other.maxDistance[i] || other.minDistance[i] > maxDistance[i])
+			return false;
+	}
+	return true;
+}
+
+void KDOP18::getBounds(AABB& out) const
+{
+	out.minPosition = vec3(minDistance[0], minDistance[1], minDistance[2]);
+	out.maxPosition = vec3(maxDistance[0], maxDistance[1], maxDistance[2]);
+}
@@ -0,0 +1,47 @@
+#ifndef __KDOP_H__
+#define __KDOP_H__
+
+#include "platform.h"
+#include "aabb.h"
+
+//! number of slab directions of the 18-dop
+#define KDOP_NUM_AXES 9
+
+/*! KDOP18
+ *
+ *  \brief  discrete oriented polytope bounded by 18 planes, the slabs along
+ *          the coordinate axes and the six edge diagonals x+y, x-y, x+z,
+ *          x-z, y+z, y-z. The directions are fixed in world space, so a
+ *          moving object rebuilds its dop from the transformed convex hull
+ *          vertices. Two dops overlap if all nine slab intervals overlap.
+ */
+struct KDOP18
+{
+	REAL minDistance[KDOP_NUM_AXES];
+	REAL maxDistance[KDOP_NUM_AXES];
+
+	KDOP18();
+
+	//! inverted dop, the neutral element of expand
+	void setEmpty();
+
+	//! dop of the vertices
+	void setFromVertices(const std::vector<vec3>& vertices);
+
+	//! dop of the vertices transformed by M, meant for the few vertices of a convex hull
+	void setFromTransformedVertices(const std::vector<vec3>& vertices, const mat4& M);
+
+	//! grows the dop to contain p
+	void expand(const vec3& p);
+
+	//! moves the dop by t, the dop of the translated vertices without visiting them
+	void translate(const vec3& t);
+
+	//! true if the dops intersect or touch
+	bool overlaps(const KDOP18& other) const;
+
+	//! the axis slabs as a box
+	void getBounds(AABB& out) const;
+};
+
+#endif //__KDOP_H__
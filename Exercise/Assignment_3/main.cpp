@@ -7,31 +7,31 @@
 #include "surface.h"
 #include "camera.h"
 #include "light.h"
+#include "aabb.h"
+#include "convexhull.h"
+#include "broadphase.h"
+#include "trianglebvh.h"
+#include "obb.h"
+#include "kdop.h"
+#include "gjk.h"
+
+#include <chrono>
 
 #define WIDTH 1024
 #define HEIGHT 768
 
-//use this macro to convert from degrees to radiants
-#define DEG_TO_RAD(x) { x*0.01745f }
+// vertex limit of the hulls used by the convex queries
+#define PROXY_VERTICES 64
 
-// structure representing an axis aligned bounding box
-struct AABB
-{
-	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+// relative motion per step, in units of the thinner object's smallest box extent,
+// above which a pair is tested continuously
+#define CONTINUOUS_THRESHOLD REAL(0.25)
 
-	vec3 minPosition;
-	vec3 maxPosition;
+// contact distance of the time of impact, in units of the thinner object's smallest box extent
+#define TOI_TOLERANCE REAL(0.01)
 
-	AABB()
-	{
-		minPosition = maxPosition = vec3::Zero();
-	}
-
-	void setFromVertices(const std::vector<vec3>& vertices)
-	{
-		//TODO: expand the Axis Aligned Bounding Box from the vertices
-	}
-};
+//use this macro to convert from degrees to radiants
+#define DEG_TO_RAD(x) { x*0.01745f }
 
 // static helper to transform a vec3 by a mat4
 static void transform(const mat4& M, const vec3& vIn, vec3& vOut)
@@ -42,6 +42,16 @@ static void transform(const mat4& M, const vec3& vIn, vec3& vOut)
 	vOut = vec3(r.x()/r.w(), r.y()/r.w(), r.z()/r.w());
 }
 
+// bounding volume an object is tested with after the broad phase
+enum BoundingVolume
+{
+	BV_AABB,
+	BV_OBB,
+	BV_KDOP
+};
+
+static const char* boundingVolumeNames[] = { "aabb", "obb", "18-dop" };
+
 // structure to represent a rigid object with its
 // transformation (rotation and translation)
 struct RObject
@@ -54,6 +64,13 @@ struct RObject
 	mat4 modelMatrix;
 	vec3 velocity;
 	AABB aabb;
+	ConvexHull hull;
+	ConvexHull proxy;
+	OBB obb;
+	KDOP18 worldDop;
+	HullSupport support;
+	BoundingVolume boundingVolume;
+	TriangleBVH bvh;
 	Renderable* ptRenderable;
 
 	RObject()
@@ -63,6 +80,7 @@ struct RObject
 		triangles.clear();
 		modelMatrix = mat4::Identity();
 		velocity = vec3::Zero();
+		boundingVolume = BV_AABB;
 		ptRenderable = NULL;
 	}
 
@@ -86,21 +104,170 @@ struct RObject
 		modelMatrix(0, 3) += t[0];
 		modelMatrix(1, 3) += t[1];
 		modelMatrix(2, 3) += t[2];
+		worldDop.translate(t);
+	}
+
+	// the world dop from the hull vertices in the current pose, a translation only shifts it
+	void updateWorldDop()
+	{
+		worldDop.setFromTransformedVertices(hull.isEmpty() ? vertices : hull.getVertices(), modelMatrix);
+	}
+
+	// conservative world box from the local box, independent of the vertex count
+	void getWorldBounds(AABB& out) const
+	{
+		aabb.transform(modelMatrix, out);
+	}
+
+	// exact world box from the convex hull vertices, the conservative one without a hull
+	void getTightWorldBounds(AABB& out) const
+	{
+		if (hull.isEmpty())
+			getWorldBounds(out);
+		else
+			out.setFromTransformedVertices(hull.getVertices(), modelMatrix);
+	}
+
+	// world box swept over the next step: the box now merged with the box moved by the velocity
+	void getSweptWorldBounds(AABB& out, bool tight) const
+	{
+		if (tight)
+			getTightWorldBounds(out);
+		else
+			getWorldBounds(out);
+		out.merge(AABB(out.minPosition + velocity, out.maxPosition + velocity));
+	}
+
+	// smallest local box extent, a measure of how far the object may move before things pass through it
+	REAL getThickness() const
+	{
+		return aabb.getExtents().minCoeff();
+	}
+
+	// true if the pair moves too far relative to each other in one step to be tested at the end of the step
+	bool needsContinuous(const RObject& other) const
+	{
+		REAL thickness = std::min(getThickness(), other.getThickness());
+		return (velocity - other.velocity).norm() > CONTINUOUS_THRESHOLD * thickness;
 	}
 
-	bool collision(const RObject& other)
+	// step fraction of the first contact of the proxy hulls over the next step. The proxies
+	// lie inside the complete hulls by up to their error, which is kept as margin
+	bool timeOfImpact(const RObject& other, GJKCache& cache, REAL& toi, GJKResult& result) const
 	{
-		// TODO: check for collision of this object with the given parameter object
-		// HINT: do not forget that AABB is stored in local object space
+		REAL margin = proxy.getError() + other.proxy.getError();
+		REAL tolerance = TOI_TOLERANCE * std::min(getThickness(), other.getThickness());
+		return ::timeOfImpact(support, modelMatrix, velocity, other.support, other.modelMatrix, other.velocity, margin, tolerance, cache, toi, result);
+	}
 
+	// the hulls may touch where the meshes do not. From the time of impact on, the triangle
+	// bvhs are tested in steps that move the pair by no more than the continuous threshold,
+	// as slow pairs are. True if the meshes touch, contact is the last free step fraction
+	bool confirmImpact(const RObject& other, REAL toi, REAL& contact) const
+	{
+		REAL thickness = std::min(getThickness(), other.getThickness());
+		REAL motion = (velocity - other.velocity).norm() * (1 - toi);
+		unsigned int numSteps = (unsigned int)std::ceil(motion / (CONTINUOUS_THRESHOLD * thickness));
+		contact = toi;
+		for (unsigned int s = 0; s <= numSteps; ++s)
+		{
+			REAL t = (numSteps > 0) ? toi + (1 - toi) * s / numSteps : toi;
+			mat4 A = modelMatrix, B = other.modelMatrix;
+			A.block<3, 1>(0, 3) += t * velocity;
+			B.block<3, 1>(0, 3) += t * other.velocity;
+			if (bvh.collide(A, other.bvh, B))
+				return true;
+			contact = t;
+		}
 		return false;
 	}
+
+	// the convex hull and the oriented box fitted to it, the support mapping runs on
+	// the simplified proxy hull, read from the proxy file if there is one
+	bool buildBoundingVolumes(const std::string& proxyFile = "")
+	{
+		if (!hull.compute(vertices) || !obb.setFromHull(hull))
+			return false;
+		bool loaded = false;
+		if (!proxyFile.empty() && std::ifstream(proxyFile.c_str()).good())
+			loaded = proxy.loadBinary(proxyFile);
+		if (!loaded && !proxy.compute(hull.getVertices(), PROXY_VERTICES))
+			return false;
+		return support.setHull(proxy);
+	}
+
+	// the centered mesh with its local box, bounding volumes and triangle bvh
+	bool load(const std::string& meshFile, const std::string& proxyFile = "")
+	{
+		if (!importTriangleMeshFromOFF(meshFile, vertices, triangles))
+			return false;
+		centerMesh(vertices);
+		aabb.setFromVertices(vertices);
+		if (!buildBoundingVolumes(proxyFile))
+			return false;
+		bvh.build(vertices, triangles);
+		LOG("bvh of " << meshFile << ": " << bvh.getNodes().size() << " nodes, depth " << bvh.getDepth() << ", " << bvh.getBuildTime() << " ms");
+		return true;
+	}
+
+	// distance or penetration of the convex hulls, warm started from the cache of the pair
+	bool convexContact(const RObject& other, GJKCache& cache, GJKResult& result) const
+	{
+		return epaPenetration(support, modelMatrix, other.support, other.modelMatrix, cache, result);
+	}
+
+	// the proxies lie inside the complete hulls by up to their error, so the meshes cannot
+	// touch if the proxies are farther apart than that
+	bool hullsSeparated(const RObject& other, GJKCache& cache) const
+	{
+		GJKResult result;
+		if (convexContact(other, cache, result))
+			return false;
+		return result.distance > proxy.getError() + other.proxy.getError();
+	}
+
+	// world space test of the bounding volumes of the given type
+	bool boundingVolumesOverlap(const RObject& other, BoundingVolume type) const
+	{
+		if (type == BV_OBB)
+		{
+			OBB a, b;
+			obb.transform(modelMatrix, a);
+			other.obb.transform(other.modelMatrix, b);
+			return a.overlaps(b);
+		}
+		if (type == BV_KDOP)
+			return worldDop.overlaps(other.worldDop);
+		AABB a, b;
+		getWorldBounds(a);
+		other.getWorldBounds(b);
+		return a.overlaps(b);
+	}
+
+	// tests the volumes both objects selected
+	bool boundingVolumesOverlap(const RObject& other) const
+	{
+		if (!boundingVolumesOverlap(other, boundingVolume))
+			return false;
+		return other.boundingVolume == boundingVolume || boundingVolumesOverlap(other, other.boundingVolume);
+	}
 };
 
 // globals
 Renderer* renderer;
 ArcballCamera* camera;
 std::vector<RObject*> rigids;
+std::vector<AABB> worldBoxes;
+std::vector<std::pair<REAL, unsigned int> > impacts;
+std::vector<bool> substepped;
+std::map<std::pair<unsigned int, unsigned int>, GJKCache> pairCaches;
+bool continuousCollision = true;
+bool tightBounds = false;
+SweepAndPrune sweepAndPrune;
+SpatialHashGrid spatialHashGrid;
+DynamicAABBTree aabbTree;
+BruteForceBroadPhase bruteForce;
+BroadPhase* broadPhase = &aabbTree;
 bool running;
 
 void init(void)
@@ -165,9 +332,8 @@ void initModels()
 	rigids[0] = new RObject;
 	rigids[0]->setTransformation(mat3::Identity(), vec3(-1, 0, 0));
 	rigids[0]->setVelocity(vec3(0, 0, 0));
-	importTriangleMeshFromOFF("../Media/bunny.off", rigids[0]->vertices, rigids[0]->triangles);
-	centerMesh(rigids[0]->vertices);
-	rigids[0]->aabb.setFromVertices(rigids[0]->vertices);
+	rigids[0]->load("../Media/bunny.off", "../Media/bunny.hull");
+	rigids[0]->boundingVolume = BV_OBB;
 	computeTriangleMeshNormals(rigids[0]->vertices, rigids[0]->triangles, rigids[0]->normals);
 	renderer->addRenderable("mesh0", rigids[0]->vertices, rigids[0]->triangles, "material0", rigids[0]->modelMatrix);
 	rigids[0]->ptRenderable = renderer->getPtRenderable("mesh0");
@@ -177,9 +343,8 @@ void initModels()
 	rigids[1] = new RObject;
 	rigids[1]->setTransformation(mat3::Identity(), vec3(0.5f, 0, 0));
 	rigids[1]->setVelocity(vec3(-0.01f, 0, 0));
-	importTriangleMeshFromOFF("../Media/sphere.off", rigids[1]->vertices, rigids[1]->triangles);
-	centerMesh(rigids[1]->vertices);
-	rigids[1]->aabb.setFromVertices(rigids[1]->vertices);
+	rigids[1]->load("../Media/sphere.off", "../Media/sphere.hull");
+	rigids[1]->boundingVolume = BV_AABB;
 	computeTriangleMeshNormals(rigids[1]->vertices, rigids[1]->triangles, rigids[1]->normals);
 	renderer->addRenderable("mesh1", rigids[1]->vertices, rigids[1]->triangles, "material1", rigids[1]->modelMatrix);
 	rigids[1]->ptRenderable = renderer->getPtRenderable("mesh1");
@@ -189,9 +354,8 @@ void initModels()
 	rigids[2] = new RObject;
 	rigids[2]->setTransformation(mat3::Identity(), vec3(1, 0, 0));
 	rigids[2]->setVelocity(vec3(0, 0, 0));
-	importTriangleMeshFromOFF("../Media/bunny.off", rigids[2]->vertices, rigids[2]->triangles);
-	centerMesh(rigids[2]->vertices);
-	rigids[2]->aabb.setFromVertices(rigids[2]->vertices);
+	rigids[2]->load("../Media/bunny.off", "../Media/bunny.hull");
+	rigids[2]->boundingVolume = BV_OBB;
 	computeTriangleMeshNormals(rigids[2]->vertices, rigids[2]->triangles, rigids[2]->normals);
 	renderer->addRenderable("mesh2", rigids[2]->vertices, rigids[2]->triangles, "material0", rigids[2]->modelMatrix);
 	rigids[2]->ptRenderable = renderer->getPtRenderable("mesh2");
@@ -245,16 +409,753 @@ void idle()
 	if (!running)
 		return;
 
-	// move objects
-	
-	// TODO: move the objects
-	
-	// check for collisions
-	// TODO: check for each object-object collision and react on detected collisions
+	// the broad phase finds the overlapping world boxes swept over the step. The world dops
+	// are built once per step and follow the translations of the step from there
+	worldBoxes.resize(rigids.size());
+	for (unsigned int i = 0; i < rigids.size(); ++i)
+	{
+		rigids[i]->getSweptWorldBounds(worldBoxes[i], tightBounds);
+		if (rigids[i]->boundingVolume == BV_KDOP)
+			rigids[i]->updateWorldDop();
+	}
+	broadPhase->update(worldBoxes);
+	const std::vector<OverlapPair>& pairs = broadPhase->getPairs();
+
+	// a pair keeps the gjk cache of its convex queries while its boxes overlap
+	const std::vector<OverlapPair>& ended = broadPhase->getEndPairs();
+	for (unsigned int p = 0; p < ended.size(); ++p)
+		pairCaches.erase(std::make_pair(ended[p].a, ended[p].b));
+
+	// pairs too fast for the test at the end of the step find their time of impact and
+	// the triangle bvhs confirm it. Earliest first, both objects move to the last free
+	// fraction, exchange their velocities and spend the rest of the step with them; an
+	// object takes one impact per step. A contact of the hulls only moves on unchanged
+	impacts.clear();
+	for (unsigned int p = 0; continuousCollision && p < pairs.size(); ++p)
+	{
+		RObject* a = rigids[pairs[p].a];
+		RObject* b = rigids[pairs[p].b];
+		GJKCache& cache = pairCaches[std::make_pair(pairs[p].a, pairs[p].b)];
+		GJKResult result;
+		REAL toi, contact;
+		if (a->needsContinuous(*b) && a->timeOfImpact(*b, cache, toi, result) && a->confirmImpact(*b, toi, contact))
+			impacts.push_back(std::make_pair(contact, p));
+	}
+	std::sort(impacts.begin(), impacts.end());
+
+	substepped.assign(rigids.size(), false);
+	for (unsigned int i = 0; i < impacts.size(); ++i)
+	{
+		const OverlapPair& pair = pairs[impacts[i].second];
+		if (substepped[pair.a] || substepped[pair.b])
+			continue;
+		RObject* a = rigids[pair.a];
+		RObject* b = rigids[pair.b];
+		const REAL contact = impacts[i].first;
+		a->addTranslation(contact * a->velocity);
+		b->addTranslation(contact * b->velocity);
+		std::swap(a->velocity, b->velocity);
+		a->addTranslation((1 - contact) * a->velocity);
+		b->addTranslation((1 - contact) * b->velocity);
+		substepped[pair.a] = substepped[pair.b] = true;
+	}
+
+	// everything else moves the whole step
+	for (unsigned int i = 0; i < rigids.size(); ++i)
+	{
+		if (!substepped[i])
+			rigids[i]->move();
+	}
+
+	// the bounding volumes selected by the objects and the warm started hulls prune the
+	// other pairs and the triangle bvhs decide. Colliding objects step back and exchange
+	// their velocities
+	for (unsigned int p = 0; p < pairs.size(); ++p)
+	{
+		RObject* a = rigids[pairs[p].a];
+		RObject* b = rigids[pairs[p].b];
+		if (substepped[pairs[p].a] || substepped[pairs[p].b])
+			continue;
+		if (!a->boundingVolumesOverlap(*b))
+			continue;
+		GJKCache& cache = pairCaches[std::make_pair(pairs[p].a, pairs[p].b)];
+		if (a->hullsSeparated(*b, cache) || !a->bvh.collide(a->modelMatrix, b->bvh, b->modelMatrix))
+			continue;
+
+		a->addTranslation(-a->velocity);
+		b->addTranslation(-b->velocity);
+		std::swap(a->velocity, b->velocity);
+	}
 
 	glutPostRedisplay();
 }
 
+// runs a broad phase over the frames of moving boxes, returns the milliseconds per frame
+static double runBroadPhase(BroadPhase& broadPhase, std::vector<AABB> boxes, const std::vector<vec3>& velocities, unsigned int numFrames)
+{
+	broadPhase.reset();
+	broadPhase.update(boxes);
+
+	unsigned long long numEvents = 0;
+	double ms = 0;
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		for (unsigned int i = 0; i < boxes.size(); ++i)
+		{
+			boxes[i].minPosition += velocities[i];
+			boxes[i].maxPosition += velocities[i];
+		}
+
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		broadPhase.update(boxes);
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+		numEvents += broadPhase.getBeginPairs().size() + broadPhase.getEndPairs().size();
+	}
+
+	double perFrame = ms / numFrames;
+	LOG(broadPhase.getName() << " per frame: " << perFrame << " ms, " << numEvents / numFrames << " events, " << broadPhase.getPairs().size() << " pairs at the end");
+	return perFrame;
+}
+
+// runs all broad phases on the same moving boxes and checks their final pairs against all pairs
+static void compareBroadPhases(const std::vector<AABB>& boxes, const std::vector<vec3>& velocities, unsigned int numFrames, bool withBruteForce)
+{
+	// same steps as the broad phases take
+	std::vector<AABB> last = boxes;
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		for (unsigned int i = 0; i < last.size(); ++i)
+		{
+			last[i].minPosition += velocities[i];
+			last[i].maxPosition += velocities[i];
+		}
+	}
+	BruteForceBroadPhase reference;
+	reference.update(last);
+	const std::vector<OverlapPair>& expected = reference.getPairs();
+
+	SweepAndPrune sap;
+	SpatialHashGrid grid;
+	DynamicAABBTree tree;
+	BruteForceBroadPhase bruteForce;
+	BroadPhase* strategies[] = { &sap, &grid, &tree, &bruteForce };
+	const unsigned int numStrategies = withBruteForce ? 4 : 3;
+
+	for (unsigned int s = 0; s < numStrategies; ++s)
+	{
+		runBroadPhase(*strategies[s], boxes, velocities, numFrames);
+
+		const std::vector<OverlapPair>& pairs = strategies[s]->getPairs();
+		bool same = pairs.size() == expected.size();
+		for (unsigned int p = 0; same && p < pairs.size(); ++p)
+			same = pairs[p].a == expected[p].a && pairs[p].b == expected[p].b;
+		if (!same)
+			LOG(strategies[s]->getName() << " differs from the all pairs test with " << expected.size() << " pairs");
+	}
+
+	LOG("endpoint swaps in the last frame " << sap.getNumSwaps());
+	LOG("cell size " << grid.getCellSize() << ", " << grid.getNumEntries() << " cell entries");
+	LOG("tree height " << tree.getHeight() << ", " << tree.getNumReinserts() << " reinserts in the last frame");
+}
+
+// broad phase cost for many coherently moving boxes of similar size
+void benchmarkBroadPhase()
+{
+	const unsigned int numObjects = 10000;
+	const unsigned int numFrames = 100;
+
+	std::vector<AABB> boxes(numObjects);
+	std::vector<vec3> velocities(numObjects);
+	srand(0);
+	for (unsigned int i = 0; i < numObjects; ++i)
+	{
+		vec3 c = vec3::Random() * REAL(50);
+		vec3 h = (vec3::Random() + vec3::Constant(3)) * REAL(0.25);
+		boxes[i] = AABB(c - h, c + h);
+		velocities[i] = vec3::Random() * REAL(0.1);
+	}
+
+	LOG("broad phases on " << numObjects << " boxes of similar size");
+	compareBroadPhases(boxes, velocities, numFrames, false);
+}
+
+// runs a broad phase over frames that each remove one object and add one, alternately
+// appended and put back into a removed id. Returns the milliseconds per frame, the boxes
+// and the removed ids of the last frame
+static double runBroadPhaseChanges(BroadPhase& broadPhase, std::vector<AABB>& boxes, std::vector<vec3> velocities, unsigned int numFrames, std::vector<unsigned int>& removed)
+{
+	broadPhase.reset();
+	broadPhase.update(boxes);
+	removed.clear();
+
+	// the same changes for every broad phase
+	srand(1);
+	double ms = 0;
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		for (unsigned int i = 0; i < boxes.size(); ++i)
+		{
+			boxes[i].minPosition += velocities[i];
+			boxes[i].maxPosition += velocities[i];
+		}
+
+		unsigned int gone = rand() % boxes.size();
+		vec3 c = vec3::Random() * REAL(50);
+		vec3 h = (vec3::Random() + vec3::Constant(3)) * REAL(0.25);
+		vec3 v = vec3::Random() * REAL(0.1);
+
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		if (!broadPhase.isRemoved(gone))
+		{
+			broadPhase.removeObject(gone);
+			removed.push_back(gone);
+		}
+		if (f % 2 == 0 || removed.empty())
+		{
+			boxes.push_back(AABB(c - h, c + h));
+			velocities.push_back(v);
+		}
+		else
+		{
+			unsigned int back = removed.front();
+			removed.erase(removed.begin());
+			boxes[back] = AABB(c - h, c + h);
+			velocities[back] = v;
+			broadPhase.addObject(back, boxes[back]);
+		}
+		broadPhase.update(boxes);
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		ms += std::chrono::duration<double, std::milli>(t1 - t0).count();
+	}
+	return ms / numFrames;
+}
+
+// broad phases on boxes that come and go: each change costs one insertion or removal,
+// compared to a rebuild of all objects. The final pairs are checked against all pairs
+void benchmarkBroadPhaseChanges()
+{
+	const unsigned int numObjects = 10000;
+	const unsigned int numFrames = 100;
+
+	std::vector<AABB> boxes(numObjects);
+	std::vector<vec3> velocities(numObjects);
+	srand(0);
+	for (unsigned int i = 0; i < numObjects; ++i)
+	{
+		vec3 c = vec3::Random() * REAL(50);
+		vec3 h = (vec3::Random() + vec3::Constant(3)) * REAL(0.25);
+		boxes[i] = AABB(c - h, c + h);
+		velocities[i] = vec3::Random() * REAL(0.1);
+	}
+
+	SweepAndPrune sap;
+	SpatialHashGrid grid;
+	DynamicAABBTree tree;
+	BroadPhase* strategies[] = { &sap, &grid, &tree };
+
+	LOG("broad phases on " << numObjects << " boxes, one removed and one added per frame");
+	for (unsigned int s = 0; s < 3; ++s)
+	{
+		std::vector<AABB> last = boxes;
+		std::vector<unsigned int> removed;
+		double perFrame = runBroadPhaseChanges(*strategies[s], last, velocities, numFrames, removed);
+
+		BruteForceBroadPhase reference;
+		reference.update(last);
+		for (unsigned int r = 0; r < removed.size(); ++r)
+			reference.removeObject(removed[r]);
+		reference.update(last);
+		const std::vector<OverlapPair>& expected = reference.getPairs();
+		const std::vector<OverlapPair>& pairs = strategies[s]->getPairs();
+		bool same = pairs.size() == expected.size();
+		for (unsigned int p = 0; same && p < pairs.size(); ++p)
+			same = pairs[p].a == expected[p].a && pairs[p].b == expected[p].b;
+
+		// the same objects from scratch
+		strategies[s]->reset();
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		strategies[s]->update(last);
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		double rebuild = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+		LOG(strategies[s]->getName() << " per frame: " << perFrame << " ms, rebuild " << rebuild << " ms, " << removed.size() << " removed, " << expected.size() << " pairs" << (same ? "" : ", differs from the all pairs test"));
+	}
+}
+
+// broad phase cost for rotated bunnies moving above a large floor
+void benchmarkMixedScene()
+{
+	const unsigned int numBunnies = 2000;
+	const unsigned int numFrames = 100;
+	const REAL floorSize = 50;
+
+	std::vector<vec3> vertices, normals;
+	std::vector<vec2> texCoords;
+	std::vector<ivec3> triangles;
+	if (!importTriangleMeshFromOFF("../Media/bunny.off", vertices, triangles))
+		return;
+	centerMesh(vertices);
+	AABB bunny;
+	bunny.setFromVertices(vertices);
+
+	createXZPlane(floorSize, vertices, normals, texCoords, triangles);
+	AABB floor;
+	floor.setFromVertices(vertices);
+
+	// the floor is object 0 and does not move
+	std::vector<AABB> boxes(numBunnies + 1);
+	std::vector<vec3> velocities(numBunnies + 1, vec3::Zero());
+	boxes[0] = floor;
+	srand(0);
+	for (unsigned int i = 1; i <= numBunnies; ++i)
+	{
+		vec3 t = vec3::Random() * REAL(0.5) * floorSize;
+		t[1] = (t[1] / floorSize + REAL(0.5)) * REAL(2);
+		mat4 M = mat4::Identity();
+		M.block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+		M.block<3, 1>(0, 3) = t;
+		bunny.transform(M, boxes[i]);
+		velocities[i] = vec3::Random() * REAL(0.02);
+	}
+
+	LOG("broad phases on " << numBunnies << " bunnies above a floor");
+	compareBroadPhases(boxes, velocities, numFrames, true);
+}
+
+// compares the four wide triangle test with the scalar one on random triangles: general
+// position, coplanar, sharing a corner and nested. Also checks that the contacts lie on both triangles.
+void checkTriangleKernel()
+{
+	const unsigned int numBlocks = 10000;
+	const unsigned int n = 4 * numBlocks;
+
+	std::vector<vec3> v(3 * n), u(3 * n);
+	srand(0);
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		for (unsigned int k = 0; k < 3; ++k)
+		{
+			v[3 * i + k] = vec3::Random();
+			u[3 * i + k] = vec3::Random() * REAL(0.5) + vec3::Constant(REAL(0.3));
+			if (i % 4 == 1)
+				v[3 * i + k][2] = u[3 * i + k][2] = REAL(0.25);
+			else if (i % 4 == 3)
+				u[3 * i + k] = v[3 * i + k] * REAL(0.01) + vec3::Constant(REAL(0.001) * k);
+		}
+		if (i % 4 == 2)
+			u[3 * i] = v[3 * i];
+	}
+	std::vector<TriangleBlock4> blocks(numBlocks);
+	for (unsigned int i = 0; i < n; ++i)
+		setBlockTriangle(blocks[i / 4], i % 4, u[3 * i], u[3 * i + 1], u[3 * i + 2]);
+
+	// every triangle of v against the four of its block
+	std::vector<unsigned int> masks(n, 0);
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		for (unsigned int l = 0; l < 4; ++l)
+		{
+			const vec3* q = &u[3 * (i / 4 * 4 + l)];
+			if (trianglesIntersect(v[3 * i], v[3 * i + 1], v[3 * i + 2], q[0], q[1], q[2]))
+				masks[i] |= 1u << l;
+		}
+	}
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	unsigned int numMismatches = 0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		if (trianglesIntersect4(v[3 * i], v[3 * i + 1], v[3 * i + 2], blocks[i / 4]) != masks[i])
+			++numMismatches;
+	}
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+	unsigned int numContacts = 0;
+	REAL worst = 0;
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		if (!(masks[i] & (1u << (i % 4))))
+			continue;
+		const vec3* p = &v[3 * i];
+		const vec3* q = &u[3 * i];
+		TriangleContact contact;
+		computeTriangleContact(p[0], p[1], p[2], q[0], q[1], q[2], contact);
+		vec3 normal = (p[1] - p[0]).cross(p[2] - p[0]).normalized();
+		worst = std::max(worst, std::abs(normal.dot(contact.start - p[0])));
+		worst = std::max(worst, std::abs(normal.dot(contact.end - p[0])));
+		worst = std::max(worst, std::abs(contact.normal.dot(contact.start - q[0])));
+		worst = std::max(worst, std::abs(contact.normal.dot(contact.end - q[0])));
+		++numContacts;
+	}
+
+	double scalarTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+	double wideTime = std::chrono::duration<double, std::milli>(t2 - t1).count();
+	LOG("triangle kernel: " << 4 * n << " tests, " << numMismatches << " mismatches");
+	LOG("  scalar " << scalarTime << " ms, four wide " << wideTime << " ms");
+	LOG("  " << numContacts << " contacts, largest distance to a triangle plane " << worst);
+}
+
+// compares the triangle bvhs of a bunny and a sphere with testing all triangle pairs, on
+// random poses in the frame of the bunny: the same collision answers and the same pairs
+void checkTriangleBVH()
+{
+	const unsigned int numPoses = 20;
+
+	RObject a, b;
+	if (!a.load("../Media/bunny.off") || !b.load("../Media/sphere.off"))
+		return;
+
+	// the sphere within a box diagonal of the bunny, a quarter of the poses miss
+	const REAL distance = a.aabb.getExtents().norm();
+	unsigned int numColliding = 0, numWrongAnswers = 0, numWrongPairs = 0, numPairs = 0;
+	double bvhTime = 0, bruteTime = 0;
+	srand(0);
+	for (unsigned int i = 0; i < numPoses; ++i)
+	{
+		mat4 M = mat4::Identity();
+		M.block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+		M.block<3, 1>(0, 3) = vec3::Random().normalized() * distance * (REAL)rand() / RAND_MAX;
+
+		std::vector<TrianglePair> pairs;
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		bool hit = a.bvh.collide(mat4::Identity(), b.bvh, M, &pairs);
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+		std::vector<vec3> w(b.vertices.size());
+		for (unsigned int k = 0; k < w.size(); ++k)
+			transform(M, b.vertices[k], w[k]);
+		std::vector<TrianglePair> expected;
+		for (unsigned int ta = 0; ta < a.triangles.size(); ++ta)
+		{
+			const ivec3& p = a.triangles[ta];
+			for (unsigned int tb = 0; tb < b.triangles.size(); ++tb)
+			{
+				const ivec3& q = b.triangles[tb];
+				if (trianglesIntersect(a.vertices[p[0]], a.vertices[p[1]], a.vertices[p[2]], w[q[0]], w[q[1]], w[q[2]]))
+				{
+					TrianglePair pair;
+					pair.a = ta;
+					pair.b = tb;
+					expected.push_back(pair);
+				}
+			}
+		}
+		std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+		bvhTime += std::chrono::duration<double, std::milli>(t1 - t0).count();
+		bruteTime += std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+		// the pairs come in traversal order
+		std::set<std::pair<unsigned int, unsigned int> > found, all;
+		for (unsigned int k = 0; k < pairs.size(); ++k)
+			found.insert(std::make_pair(pairs[k].a, pairs[k].b));
+		for (unsigned int k = 0; k < expected.size(); ++k)
+			all.insert(std::make_pair(expected[k].a, expected[k].b));
+		numColliding += !expected.empty();
+		numWrongAnswers += hit != !expected.empty();
+		numWrongPairs += found != all;
+		numPairs += expected.size();
+	}
+
+	LOG("triangle bvh: " << numColliding << " of " << numPoses << " poses collide with " << numPairs << " triangle pairs, " << numWrongAnswers << " wrong answers, " << numWrongPairs << " poses with other pairs");
+	LOG("  bvh " << bvhTime / numPoses << " ms, all pairs " << bruteTime / numPoses << " ms per pose");
+}
+
+// false positives and cost of the bounding volumes on the media meshes: two
+// copies of a mesh in random poses, checked against the exact triangle test
+void benchmarkBoundingVolumes()
+{
+	const char* names[] = { "bunny", "sphere", "aircraft", "prop", "avatar" };
+	const unsigned int numMeshes = 5;
+	const unsigned int numPoses = 2000;
+
+	for (unsigned int m = 0; m < numMeshes; ++m)
+	{
+		RObject a;
+		if (!importTriangleMeshFromOFF(std::string("../Media/") + names[m] + ".off", a.vertices, a.triangles))
+			continue;
+		centerMesh(a.vertices);
+		a.aabb.setFromVertices(a.vertices);
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		a.buildBoundingVolumes();
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		a.bvh.build(a.vertices, a.triangles);
+		RObject b = a;
+
+		// the second copy within a box diagonal of the first, about half of the poses touch
+		std::vector<mat4> posesA(numPoses), posesB(numPoses);
+		std::vector<bool> exact(numPoses);
+		const REAL distance = a.aabb.getExtents().norm();
+		unsigned int numExact = 0;
+		srand(m);
+		for (unsigned int i = 0; i < numPoses; ++i)
+		{
+			posesA[i] = posesB[i] = mat4::Identity();
+			posesA[i].block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+			posesB[i].block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+			posesB[i].block<3, 1>(0, 3) = vec3::Random().normalized() * distance * (REAL)rand() / RAND_MAX;
+			exact[i] = a.bvh.collide(posesA[i], b.bvh, posesB[i]);
+			numExact += exact[i];
+		}
+
+		double buildTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+		REAL boxVolume = a.aabb.getExtents().prod();
+		LOG(names[m] << ": " << a.hull.getVertices().size() << " hull vertices, hull and obb built in " << buildTime << " ms, local obb/aabb volume " << a.obb.getVolume() / boxVolume);
+		LOG("  " << numExact << " of " << numPoses << " poses collide");
+
+		// the world dops are built once per pose as in a step of the simulation, the pair test only reads them
+		std::vector<KDOP18> dopsA(numPoses), dopsB(numPoses);
+		std::chrono::high_resolution_clock::time_point t4 = std::chrono::high_resolution_clock::now();
+		for (unsigned int i = 0; i < numPoses; ++i)
+		{
+			a.modelMatrix = posesA[i];
+			b.modelMatrix = posesB[i];
+			a.updateWorldDop();
+			b.updateWorldDop();
+			dopsA[i] = a.worldDop;
+			dopsB[i] = b.worldDop;
+		}
+		std::chrono::high_resolution_clock::time_point t5 = std::chrono::high_resolution_clock::now();
+		double perUpdate = std::chrono::duration<double, std::micro>(t5 - t4).count() / (2 * numPoses);
+		LOG("  world dop built in " << perUpdate << " us per object and pose");
+
+		for (unsigned int type = BV_AABB; type <= BV_KDOP; ++type)
+		{
+			unsigned int numFalse = 0, numMissed = 0;
+			std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+			for (unsigned int i = 0; i < numPoses; ++i)
+			{
+				a.modelMatrix = posesA[i];
+				b.modelMatrix = posesB[i];
+				a.worldDop = dopsA[i];
+				b.worldDop = dopsB[i];
+				bool overlap = a.boundingVolumesOverlap(b, (BoundingVolume)type);
+				numFalse += overlap && !exact[i];
+				numMissed += !overlap && exact[i];
+			}
+			std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now();
+			double perTest = std::chrono::duration<double, std::micro>(t3 - t2).count() / numPoses;
+			LOG("  " << boundingVolumeNames[type] << ": " << 100.0 * numFalse / std::max(numPoses - numExact, 1u) << "% false positives, " << numMissed << " missed, " << perTest << " us per test");
+		}
+	}
+}
+
+// gjk/epa on the proxy hulls of a bunny and a sphere. The results are checked on random
+// poses: closest points against the supporting planes of the hulls, penetrations by
+// moving the sphere out by the depth. Then cold and warm started queries on a coherent motion.
+void benchmarkConvexQueries()
+{
+	const unsigned int numPoses = 2000;
+	const unsigned int numFrames = 5000;
+
+	RObject a, b;
+	if (!a.load("../Media/bunny.off") || !b.load("../Media/sphere.off"))
+		return;
+
+	unsigned int numSeparated = 0, numPenetrating = 0, numWrong = 0;
+	srand(0);
+	for (unsigned int i = 0; i < numPoses; ++i)
+	{
+		a.modelMatrix = b.modelMatrix = mat4::Identity();
+		a.modelMatrix.block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+		b.modelMatrix.block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+		b.modelMatrix.block<3, 1>(0, 3) = vec3::Random() * REAL(0.3);
+
+		GJKCache cache;
+		GJKResult result;
+		if (a.convexContact(b, cache, result))
+		{
+			// out by a little more than the depth separates, a little less does not
+			++numPenetrating;
+			GJKResult moved;
+			b.modelMatrix.block<3, 1>(0, 3) += result.normal * result.depth * REAL(1.01);
+			cache.reset();
+			bool out = gjkDistance(a.support, a.modelMatrix, b.support, b.modelMatrix, cache, moved);
+			b.modelMatrix.block<3, 1>(0, 3) -= result.normal * result.depth * REAL(0.03);
+			cache.reset();
+			bool in = !gjkDistance(a.support, a.modelMatrix, b.support, b.modelMatrix, cache, moved);
+			numWrong += !out || !in;
+		}
+		else
+		{
+			// the planes through the closest points along the normal support the hulls
+			++numSeparated;
+			REAL maxA = -std::numeric_limits<REAL>::max();
+			REAL minB = std::numeric_limits<REAL>::max();
+			const mat3 RA = a.modelMatrix.block<3, 3>(0, 0), RB = b.modelMatrix.block<3, 3>(0, 0);
+			for (unsigned int k = 0; k < a.proxy.getVertices().size(); ++k)
+				maxA = std::max(maxA, result.normal.dot(RA * a.proxy.getVertices()[k] + a.modelMatrix.block<3, 1>(0, 3)));
+			for (unsigned int k = 0; k < b.proxy.getVertices().size(); ++k)
+				minB = std::min(minB, result.normal.dot(RB * b.proxy.getVertices()[k] + b.modelMatrix.block<3, 1>(0, 3)));
+			numWrong += std::abs(minB - maxA - result.distance) > REAL(1e-4) * std::max(result.distance, REAL(1));
+		}
+	}
+	LOG("gjk/epa: " << numSeparated << " separated and " << numPenetrating << " penetrating poses, " << numWrong << " wrong");
+
+	// the sphere slides through the turning bunny, once with a fresh cache per frame and once warm started
+	for (unsigned int warm = 0; warm < 2; ++warm)
+	{
+		GJKCache cache;
+		unsigned int numIterations = 0, numContacts = 0;
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		for (unsigned int f = 0; f < numFrames; ++f)
+		{
+			a.modelMatrix = b.modelMatrix = mat4::Identity();
+			a.modelMatrix.block<3, 3>(0, 0) = Eigen::AngleAxis<REAL>(f * REAL(0.002), vec3(0, 1, 0)).toRotationMatrix();
+			b.modelMatrix.block<3, 3>(0, 0) = Eigen::AngleAxis<REAL>(f * REAL(0.003), vec3(1, 0, 0)).toRotationMatrix();
+			b.modelMatrix.block<3, 1>(0, 3) = vec3(REAL(0.3) * std::sin(f * REAL(0.004)), REAL(0.05), 0);
+			if (!warm)
+				cache.reset();
+			GJKResult result;
+			numContacts += a.convexContact(b, cache, result);
+			numIterations += result.numIterations;
+		}
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		double perQuery = std::chrono::duration<double, std::micro>(t1 - t0).count() / numFrames;
+		LOG((warm ? "  warm" : "  cold") << " start: " << (double)numIterations / numFrames << " support evaluations and " << perQuery << " us per query, " << numContacts << " of " << numFrames << " frames penetrating");
+	}
+}
+
+// spheres shot past a bunny in random poses, one step per shot. The first contact of
+// the meshes found by sampling the step densely is the reference: the test at the end
+// of the step misses it, the time of impact of the proxy hulls must find every contact
+// and never after the reference. The bvh confirmation must keep the contacts and drop
+// the impacts of the hulls only
+void checkContinuousCollision()
+{
+	const unsigned int numShots = 1000;
+	const unsigned int numSamples = 256;
+
+	RObject a, b;
+	if (!a.load("../Media/bunny.off") || !b.load("../Media/sphere.off"))
+		return;
+
+	// the shots start and end clear of the bunny and pass its center within the sum of
+	// the box diagonals, about half of them touch
+	const REAL reach = a.aabb.getExtents().norm() + b.aabb.getExtents().norm();
+	const REAL spread = REAL(0.5) * reach;
+	unsigned int numContacts = 0, numAtEnd = 0, numFound = 0, numMissed = 0, numLate = 0, numProxyOnly = 0;
+	unsigned int numConfirmed = 0, numConfirmedLate = 0, numRejected = 0;
+	unsigned int numIterations = 0;
+	double toiTime = 0;
+	srand(0);
+	for (unsigned int i = 0; i < numShots; ++i)
+	{
+		a.modelMatrix = b.modelMatrix = mat4::Identity();
+		a.modelMatrix.block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+		b.modelMatrix.block<3, 3>(0, 0) = quat(vec4::Random().normalized()).toRotationMatrix();
+		const vec3 direction = vec3::Random().normalized();
+		const vec3 offset = vec3::Random() * spread;
+		b.modelMatrix.block<3, 1>(0, 3) = offset - direction * reach;
+		b.setVelocity(direction * 2 * reach);
+
+		int first = -1;
+		mat4 M = b.modelMatrix;
+		for (unsigned int s = 0; s <= numSamples && first < 0; ++s)
+		{
+			M.block<3, 1>(0, 3) = b.modelMatrix.block<3, 1>(0, 3) + b.velocity * ((REAL)s / numSamples);
+			if (a.bvh.collide(a.modelMatrix, b.bvh, M))
+				first = s;
+		}
+		M.block<3, 1>(0, 3) = b.modelMatrix.block<3, 1>(0, 3) + b.velocity;
+		numContacts += first >= 0;
+		numAtEnd += first >= 0 && a.bvh.collide(a.modelMatrix, b.bvh, M);
+
+		GJKCache cache;
+		GJKResult result;
+		REAL toi;
+		std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+		bool hit = a.timeOfImpact(b, cache, toi, result);
+		std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+		toiTime += std::chrono::duration<double, std::micro>(t1 - t0).count();
+		numIterations += result.numIterations;
+
+		if (first < 0)
+			numProxyOnly += hit;
+		else if (!hit)
+			++numMissed;
+		else if (toi > (REAL)first / numSamples)
+			++numLate;
+		else
+			++numFound;
+
+		REAL contact;
+		bool confirmed = hit && a.confirmImpact(b, toi, contact);
+		if (first < 0)
+			numRejected += hit && !confirmed;
+		else if (confirmed)
+		{
+			++numConfirmed;
+			numConfirmedLate += contact > (REAL)first / numSamples;
+		}
+	}
+
+	LOG("continuous collision: " << numContacts << " of " << numShots << " shots touch the bunny, " << numAtEnd << " of them at the end of the step");
+	LOG("  time of impact finds " << numFound << ", misses " << numMissed << ", " << numLate << " late, " << numProxyOnly << " on the hulls only");
+	LOG("  " << (double)numIterations / numShots << " support evaluations and " << toiTime / numShots << " us per query");
+	LOG("  the bvhs confirm " << numConfirmed << " contacts, " << numConfirmedLate << " late, and drop " << numRejected << " of the " << numProxyOnly << " hull only impacts");
+}
+
+// hull build times on the media meshes and on a large point cloud, complete and
+// limited to the proxy vertex count, and the time to read the limited hull back
+void benchmarkHulls()
+{
+	const char* names[] = { "bunny", "sphere", "aircraft", "prop", "avatar", "cloud" };
+	const unsigned int numInputs = 6;
+	const unsigned int numRuns = 5;
+
+	for (unsigned int m = 0; m < numInputs; ++m)
+	{
+		std::vector<vec3> points;
+		std::vector<ivec3> triangles;
+		if (m + 1 < numInputs)
+		{
+			if (!importTriangleMeshFromOFF(std::string("../Media/") + names[m] + ".off", points, triangles))
+				continue;
+		}
+		else
+		{
+			// a million points in the unit ball and some on its surface
+			srand(0);
+			while (points.size() < 1000000)
+			{
+				vec3 p = vec3::Random();
+				if (p.squaredNorm() <= 1)
+					points.push_back(points.size() % 100 == 0 ? p.normalized() : p);
+			}
+		}
+
+		// the best of a few runs, the first pays for the allocations
+		ConvexHull complete, limited, loaded;
+		double completeTime = std::numeric_limits<double>::max();
+		double limitedTime = std::numeric_limits<double>::max();
+		for (unsigned int r = 0; r < numRuns; ++r)
+		{
+			std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+			complete.compute(points);
+			std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+			limited.compute(points, PROXY_VERTICES);
+			std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+			completeTime = std::min(completeTime, std::chrono::duration<double, std::milli>(t1 - t0).count());
+			limitedTime = std::min(limitedTime, std::chrono::duration<double, std::milli>(t2 - t1).count());
+		}
+
+		std::string file = std::string("/tmp/") + names[m] + ".hull";
+		limited.saveBinary(file);
+		std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now();
+		loaded.loadBinary(file);
+		std::chrono::high_resolution_clock::time_point t4 = std::chrono::high_resolution_clock::now();
+		double loadTime = std::chrono::duration<double, std::milli>(t4 - t3).count();
+		std::remove(file.c_str());
+
+		AABB box;
+		box.setFromVertices(points);
+		REAL relativeError = limited.getError() / box.getExtents().norm();
+		LOG(names[m] << ": " << points.size() << " points, " << complete.getVertices().size() << " hull vertices in " << completeTime << " ms");
+		LOG("  " << limited.getVertices().size() << " vertices in " << limitedTime << " ms, error " << relativeError << " of the box diagonal, read back in " << loadTime << " ms");
+	}
+}
+
 void mouseButton(int button, int state, int x, int y)
 {
 	// catch the wheel event
@@ -320,6 +1221,77 @@ void key(unsigned char key, int x, int y)
 		// start stop animation
 		running = !running;
 		break;
+
+	case 'b':
+		benchmarkBroadPhase();
+		break;
+
+	case 'm':
+		benchmarkMixedScene();
+		break;
+
+	case 'd':
+		benchmarkBroadPhaseChanges();
+		break;
+
+	case 't':
+		checkTriangleKernel();
+		break;
+
+	case 'l':
+		checkTriangleBVH();
+		break;
+
+	case 'o':
+		benchmarkBoundingVolumes();
+		break;
+
+	case 'g':
+		benchmarkConvexQueries();
+		break;
+
+	case 'h':
+		benchmarkHulls();
+		break;
+
+	case 'k':
+		checkContinuousCollision();
+		break;
+
+	case 'c': // continuous collision on and off
+		continuousCollision = !continuousCollision;
+		LOG("continuous collision " << (continuousCollision ? "on" : "off"));
+		break;
+
+	case 'a': // world boxes from the hulls or from the local boxes
+		tightBounds = !tightBounds;
+		LOG("world boxes from the " << (tightBounds ? "convex hulls" : "local boxes"));
+		break;
+
+	case 'f': // model 1 four times faster
+		rigids[1]->setVelocity(rigids[1]->velocity * 4);
+		LOG("speed of model 1: " << rigids[1]->velocity.norm());
+		break;
+
+	case 'v': // next bounding volume for all objects
+		for (unsigned int i = 0; i < rigids.size(); ++i)
+			rigids[i]->boundingVolume = (BoundingVolume)((rigids[i]->boundingVolume + 1) % 3);
+		LOG("bounding volume of model 0: " << boundingVolumeNames[rigids[0]->boundingVolume]);
+		break;
+
+	case 'n': // next broad phase for the simulation
+		if (broadPhase == &aabbTree)
+			broadPhase = &sweepAndPrune;
+		else if (broadPhase == &sweepAndPrune)
+			broadPhase = &spatialHashGrid;
+		else if (broadPhase == &spatialHashGrid)
+			broadPhase = &bruteForce;
+		else
+			broadPhase = &aabbTree;
+		broadPhase->reset();
+		pairCaches.clear();
+		LOG("broad phase " << broadPhase->getName());
+		break;
 	}
 
 	glutPostRedisplay();
@@ -327,6 +1299,23 @@ void key(unsigned char key, int x, int y)
 
 int main(int argc, char** argv)
 {
+	// Application3 <mesh> <hull file> [vertex limit] writes the proxy hull of the
+	// centered mesh without opening a window
+	if (argc > 2)
+	{
+		std::vector<vec3> vertices;
+		std::vector<ivec3> triangles;
+		ConvexHull hull, proxy;
+		unsigned int maxVertices = argc > 3 ? atoi(argv[3]) : PROXY_VERTICES;
+		if (!importTriangleMeshFromOFF(argv[1], vertices, triangles))
+			return 1;
+		centerMesh(vertices);
+		if (!hull.compute(vertices) || !proxy.compute(hull.getVertices(), maxVertices) || !proxy.saveBinary(argv[2]))
+			return 1;
+		LOG("wrote " << proxy.getVertices().size() << " hull vertices of " << argv[1] << " to " << argv[2] << ", error " << proxy.getError());
+		return 0;
+	}
+
 	// init window and gl
 	glutInit(&argc, argv);
 	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH);
@@ -0,0 +1,221 @@
+#include "obb.h"
+
+#include <Eigen/Eigenvalues>
+
+// padding of the absolute rotation terms, keeps the edge axes usable for near parallel edges
+#define OBB_EPSILON REAL(1e-6)
+
+// center and half extents of the points along the given axes
+static void fitToAxes(const std::vector<vec3>& points, const mat3& axes, vec3& center, vec3& halfExtents)
+{
+	vec3 lo = axes.transpose() * points[0];
+	vec3 hi = lo;
+	for(unsigned int i = 1; i < points.size(); ++i)
+	{
+		vec3 p = axes.transpose() * points[i];
+		lo = lo.cwiseMin(p);
+		hi = hi.cwiseMax(p);
+	}
+	center = axes * ((lo + hi) / 2);
+	halfExtents = (hi - lo) / 2;
+}
+
+// z of (a - o) x (b - o), positive for a left turn
+static inline REAL cross2d(const vec2& o, const vec2& a, const vec2& b)
+{
+	return (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0]);
+}
+
+static bool lessXY(const vec2& a, const vec2& b)
+{
+	return a[0] < b[0] || (a[0] == b[0] && a[1] < b[1]);
+}
+
+// counter clockwise 2d convex hull of the points (monotone chain)
+static void convexHull2d(std::vector<vec2> points, std::vector<vec2>& hull)
+{
+	std::sort(points.begin(), points.end(), lessXY);
+	hull.resize(2 * points.size());
+	unsigned int k = 0;
+	for(unsigned int i = 0; i < points.size(); ++i)
+	{
+		while(k >= 2 && cross2d(hull[k - 2], hull[k - 1], points[i]) <= 0)
+			--k;
+		hull[k++] = points[i];
+	}
+	for(int i = (int)points.size() - 2, lower = k + 1; i >= 0; --i)
+	{
+		while((int)k >= lower && cross2d(hull[k - 2], hull[k - 1], points[i]) <= 0)
+			--k;
+		hull[k++] = points[i];
+	}
+	hull.resize(k > 1 ? k - 1 : k);
+}
+
+OBB::OBB()
+{
+	center = vec3::Zero();
+	axes = mat3::Identity();
+	halfExtents = vec3::Zero();
+}
+
+bool OBB::setFromHull(const ConvexHull& hull)
+{
+	if(hull.isEmpty())
+	{
+		PRINTERROR("obb needs a convex hull");
+		return false;
+	}
+	const std::vector<vec3>& points = hull.getVertices();
+	const std::vector<ivec3>& triangles = hull.getTriangles();
+
+	// covariance of the hull surface, every triangle weighted by its area so
+	// the box does not lean towards densely sampled regions
+	Eigen::Matrix3d covariance = Eigen::Matrix3d::Zero();
+	Eigen::Vector3d mean = Eigen::Vector3d::Zero();
+	double totalArea = 0;
+	for(unsigned int i = 0; i < triangles.size(); ++i)
+	{
+		Eigen::Vector3d p = points[triangles[i][0]].cast<double>();
+		Eigen::Vector3d q = points[triangles[i][1]].cast<double>();
+		Eigen::Vector3d r = points[triangles[i][2]].cast<double>();
+		double area = (q - p).cross(r - p).norm() / 2;
+		Eigen::Vector3d m = (p + q + r) / 3;
+		covariance += area / 12 * (9 * m * m.transpose() + p * p.transpose() + q * q.transpose() + r * r.transpose());
+		mean += area * m;
+		totalArea += area;
+	}
+	mean /= totalArea;
+	covariance = covariance / totalArea - mean * mean.transpose();
+
+	Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(covariance);
+	axes = solver.eigenvectors().cast<REAL>();
+	fitToAxes(points, axes, center, halfExtents);
+
+	// refinement: with one axis kept, the smallest rectangle around the
+	// projected hull has a side along an edge of the projection's 2d hull
+	std::vector<vec2> projected(points.size()), outline;
+	for(unsigned int pass = 0; pass < 2; ++pass)
+	{
+		bool improved = false;
+		for(unsigned int k = 0; k < 3; ++k)
+		{
+			const vec3 n = axes.col(k);
+			const vec3 u = axes.col((k + 1) % 3);
+			const vec3 w = axes.col((k + 2) % 3);
+			for(unsigned int i = 0; i < points.size(); ++i)
+				projected[i] = vec2(u.dot(points[i]), w.dot(points[i]));
+			convexHull2d(projected, outline);
+
+			REAL bestArea = 4 * halfExtents[(k + 1) % 3] * halfExtents[(k + 2) % 3];
+			vec2 bestDirection(1, 0);
+			for(unsigned int e = 0; e < outline.size(); ++e)
+			{
+				vec2 d = outline[(e + 1) % outline.size()] - outline[e];
+				REAL l = d.norm();
+				if(l <= 0)
+					continue;
+				d /= l;
+				REAL dMin = std::numeric_limits<REAL>::max(), dMax = -dMin;
+				REAL pMin = dMin, pMax = dMax;
+				for(unsigned int i = 0; i < outline.size(); ++i)
+				{
+					REAL a = d.dot(outline[i]);
+					REAL b = d[0] * outline[i][1] - d[1] * outline[i][0];
+					dMin = std::min(dMin, a);
+					dMax = std::max(dMax, a);
+					pMin = std::min(pMin, b);
+					pMax = std::max(pMax, b);
+				}
+				REAL area = (dMax - dMin) * (pMax - pMin);
+				if(area < bestArea * (1 - REAL(1e-4)))
+				{
+					bestArea = area;
+					bestDirection = d;
+					improved = true;
+				}
+			}
+
+			// turn the two axes in their plane
+			axes.col((k + 1) % 3) = (bestDirection[0] * u + bestDirection[1] * w).normalized();
+			axes.col((k + 2) % 3) = n.cross(axes.col((k + 1) % 3));
+			fitToAxes(points, axes, center, halfExtents);
+		}
+		if(!improved)
+			break;
+	}
+
+	return true;
+}
+
+void OBB::transform(const mat4& M, OBB& out) const
+{
+	const mat3 A = M.block<3, 3>(0, 0);
+	const REAL scale = A.col(0).norm();
+	out.center = A * center + M.block<3, 1>(0, 3);
+	out.axes = A * axes / scale;
+	out.halfExtents = halfExtents * scale;
+}
+
+bool OBB::overlaps(const OBB& other) const
+{
+	// the other box in the frame of this one
+	const mat3 R = axes.transpose() * other.axes;
+	const vec3 t = axes.transpose() * (other.center - center);
+	mat3 absR;
+	for(unsigned int i = 0; i < 3; ++i)
+		for(unsigned int j = 0; j < 3; ++j)
+			absR(i, j) = std::abs(R(i, j)) + OBB_EPSILON;
+
+	const vec3& a = halfExtents;
+	const vec3& b = other.halfExtents;
+	REAL ra, rb;
+
+	// face axes of this box
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		ra = a[i];
+		rb = b[0] * absR(i, 0) + b[1] * absR(i, 1) + b[2] * absR(i, 2);
+		if(std::abs(t[i]) > ra + rb)
+			return false;
+	}
+
+	// face axes of the other box
+	for(unsigned int j = 0; j < 3; ++j)
+	{
+		ra = a[0] * absR(0, j) + a[1] * absR(1, j) + a[2] * absR(2, j);
+		rb = b[j];
+		if(std::abs(t[0] * R(0, j) + t[1] * R(1, j) + t[2] * R(2, j)) > ra + rb)
+			return false;
+	}
+
+	// cross products of edge i of this box and edge j of the other
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		const unsigned int i1 = (i + 1) % 3;
+		const unsigned int i2 = (i + 2) % 3;
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			const unsigned int j1 = (j + 1) % 3;
+			const unsigned int j2 = (j + 2) % 3;
+			ra = a[i1] * absR(i2, j) + a[i2] * absR(i1, j);
+			rb = b[j1] * absR(i, j2) + b[j2] * absR(i, j1);
+			if(std::abs(t[i2] * R(i1, j) - t[i1] * R(i2, j)) > ra + rb)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+REAL OBB::getVolume() const
+{
+	return 8 * halfExtents[0] * halfExtents[1] * halfExtents[2];
+}
+
+void OBB::getBounds(AABB& out) const
+{
+	const vec3 extent = axes.cwiseAbs() * halfExtents;
+	out.minPosition = center - extent;
+	out.maxPosition = center + extent;
+}
@@ -0,0 +1,46 @@
+#ifndef __OBB_H__
+#define __OBB_H__
+
+#include "platform.h"
+#include "aabb.h"
+#include "convexhull.h"
+
+/*! OBB
+ *
+ *  \brief  oriented bounding box. It is fitted to the convex hull: the
+ *          principal axes of the hull surface give a first box, then each
+ *          axis in turn is kept and the other two are turned to the minimum
+ *          area rectangle of the hull projected along it. World boxes follow
+ *          the model matrix in O(1), the overlap test is the separating axis
+ *          test over the 15 candidate axes and stops at the first separating
+ *          one.
+ */
+struct OBB
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	vec3 center;
+
+	//! orthonormal box axes as columns
+	mat3 axes;
+
+	vec3 halfExtents;
+
+	OBB();
+
+	//! fits the box to the hull vertices, false for an empty hull
+	bool setFromHull(const ConvexHull& hull);
+
+	//! box transformed by M, which may rotate, translate and scale uniformly
+	void transform(const mat4& M, OBB& out) const;
+
+	//! true if the boxes intersect or touch
+	bool overlaps(const OBB& other) const;
+
+	REAL getVolume() const;
+
+	//! axis aligned box around the box
+	void getBounds(AABB& out) const;
+};
+
+#endif //__OBB_H__
@@ -0,0 +1,494 @@
+#include "trianglebvh.h"
+
+#include <chrono>
+
+#ifdef __SSE__
+ #include <xmmintrin.h>
+#endif
+
+#define BVH_NUM_BINS 16
+
+// bounds of four floats per corner, lane 3 is ignored. The build merges
+// them in its inner loops, with sse a merge is one min and one max.
+struct BVHBounds
+{
+#ifdef __SSE__
+	__m128 lo;
+	__m128 hi;
+
+	void setEmpty()
+	{
+		lo = _mm_set1_ps(std::numeric_limits<float>::max());
+		hi = _mm_set1_ps(-std::numeric_limits<float>::max());
+	}
+
+	void merge(const float* minP, const float* maxP)
+	{
+		lo = _mm_min_ps(lo, _mm_loadu_ps(minP));
+		hi = _mm_max_ps(hi, _mm_loadu_ps(maxP));
+	}
+
+	void merge(const BVHBounds& other)
+	{
+		lo = _mm_min_ps(lo, other.lo);
+		hi = _mm_max_ps(hi, other.hi);
+	}
+
+	void get(float* minP, float* maxP) const
+	{
+		_mm_storeu_ps(minP, lo);
+		_mm_storeu_ps(maxP, hi);
+	}
+
+	float getSurfaceArea() const
+	{
+		// (x, y, z) * (y, z, x) summed over the first three lanes
+		__m128 e = _mm_sub_ps(hi, lo);
+		__m128 p = _mm_mul_ps(e, _mm_shuffle_ps(e, e, _MM_SHUFFLE(3, 0, 2, 1)));
+		__m128 sum = _mm_add_ss(_mm_add_ss(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+		return 2 * _mm_cvtss_f32(sum);
+	}
+#else
+	float lo[4];
+	float hi[4];
+
+	void setEmpty()
+	{
+		for(unsigned int k = 0; k < 4; ++k)
+		{
+			lo[k] = std::numeric_limits<float>::max();
+			hi[k] = -std::numeric_limits<float>::max();
+		}
+	}
+
+	void merge(const float* minP, const float* maxP)
+	{
+		for(unsigned int k = 0; k < 4; ++k)
+		{
+			lo[k] = std::min(lo[k], minP[k]);
+			hi[k] = std::max(hi[k], maxP[k]);
+		}
+	}
+
+	void merge(const BVHBounds& other)
+	{
+		merge(other.lo, other.hi);
+	}
+
+	void get(float* minP, float* maxP) const
+	{
+		for(unsigned int k = 0; k < 4; ++k)
+		{
+			minP[k] = lo[k];
+			maxP[k] = hi[k];
+		}
+	}
+
+	float getSurfaceArea() const
+	{
+		float x = hi[0] - lo[0], y = hi[1] - lo[1], z = hi[2] - lo[2];
+		return 2 * (x * y + y * z + z * x);
+	}
+#endif
+};
+
+// triangle bounds and centroids shared by the recursive build, four floats per triangle
+struct BVHBuildContext
+{
+	std::vector<float> minPositions;
+	std::vector<float> maxPositions;
+	std::vector<float> centroids;
+	std::vector<unsigned int> order;
+	std::vector<BVHNode>* nodes;
+	unsigned int maxLeafSize;
+	unsigned int depth;
+};
+
+// bounds and centroid bounds of the triangles order[begin, end)
+static void computeBounds(const BVHBuildContext& ctx, unsigned int begin, unsigned int end, BVHBounds& bounds, BVHBounds& centroidBounds)
+{
+	bounds.setEmpty();
+	centroidBounds.setEmpty();
+	for(unsigned int i = begin; i < end; ++i)
+	{
+		const unsigned int t = 4 * ctx.order[i];
+		bounds.merge(&ctx.minPositions[t], &ctx.maxPositions[t]);
+		centroidBounds.merge(&ctx.centroids[t], &ctx.centroids[t]);
+	}
+}
+
+// builds the node for order[begin, end) with the given bounds, returns its index
+static unsigned int buildNode(BVHBuildContext& ctx, unsigned int begin, unsigned int end, unsigned int depth,
+	const BVHBounds& bounds, const BVHBounds& centroidBounds)
+{
+	const unsigned int index = ctx.nodes->size();
+	ctx.nodes->push_back(BVHNode());
+	ctx.depth = std::max(ctx.depth, depth);
+
+	BVHNode& node = (*ctx.nodes)[index];
+	float minP[4], maxP[4], centroidMin[4], centroidMax[4];
+	bounds.get(minP, maxP);
+	centroidBounds.get(centroidMin, centroidMax);
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		node.minPosition[k] = minP[k];
+		node.maxPosition[k] = maxP[k];
+	}
+
+	const unsigned int count = end - begin;
+	node.offset = begin;
+	node.count = count;
+	if(count <= ctx.maxLeafSize)
+		return index;
+
+	// binned sah along the axis of the largest centroid spread: bins of the
+	// centroid bounds, cost of the split after every bin from sweeps in both
+	// directions. Small nodes use fewer bins.
+	unsigned int axis = 0;
+	for(unsigned int k = 1; k < 3; ++k)
+	{
+		if(centroidMax[k] - centroidMin[k] > centroidMax[axis] - centroidMin[axis])
+			axis = k;
+	}
+	const float lo = centroidMin[axis];
+	const float extent = centroidMax[axis] - lo;
+	const unsigned int numBins = std::min(count, (unsigned int)BVH_NUM_BINS);
+	const float scale = (extent > 0) ? numBins * (1 - 1e-5f) / extent : 0;
+
+	int bestSplit = -1;
+	if(extent > 0)
+	{
+		BVHBounds binBounds[BVH_NUM_BINS];
+		unsigned int binCounts[BVH_NUM_BINS];
+		for(unsigned int b = 0; b < numBins; ++b)
+		{
+			binBounds[b].setEmpty();
+			binCounts[b] = 0;
+		}
+		for(unsigned int i = begin; i < end; ++i)
+		{
+			const unsigned int t = 4 * ctx.order[i];
+			unsigned int b = (unsigned int)((ctx.centroids[t + axis] - lo) * scale);
+			binBounds[b].merge(&ctx.minPositions[t], &ctx.maxPositions[t]);
+			binCounts[b]++;
+		}
+
+		float rightArea[BVH_NUM_BINS];
+		unsigned int rightCount[BVH_NUM_BINS];
+		BVHBounds box;
+		box.setEmpty();
+		unsigned int n = 0;
+		for(unsigned int b = numBins - 1; b > 0; --b)
+		{
+			box.merge(binBounds[b]);
+			n += binCounts[b];
+			rightArea[b] = (n > 0) ? box.getSurfaceArea() : 0;
+			rightCount[b] = n;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		box.setEmpty();
+		n = 0;
+		for(unsigned int b = 0; b + 1 < numBins; ++b)
+		{
+			box.merge(binBounds[b]);
+			n += binCounts[b];
+			if(n == 0 || rightCount[b + 1] == 0)
+				continue;
+			float cost = box.getSurfaceArea() * n + rightArea[b + 1] * rightCount[b + 1];
+			if(cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+	}
+
+	// partition, collecting the bounds of both children on the way;
+	// identical centroids split in the middle of the list
+	unsigned int mid = begin + count / 2;
+	BVHBounds childBounds[2], childCentroids[2];
+	if(bestSplit >= 0)
+	{
+		for(unsigned int c = 0; c < 2; ++c)
+		{
+			childBounds[c].setEmpty();
+			childCentroids[c].setEmpty();
+		}
+		mid = begin;
+		for(unsigned int i = begin; i < end; ++i)
+		{
+			// without branches: always swap, only advance for the left side
+			const unsigned int tri = ctx.order[i];
+			const unsigned int t = 4 * tri;
+			const unsigned int right = (int)((ctx.centroids[t + axis] - lo) * scale) > bestSplit;
+			childBounds[right].merge(&ctx.minPositions[t], &ctx.maxPositions[t]);
+			childCentroids[right].merge(&ctx.centroids[t], &ctx.centroids[t]);
+			ctx.order[i] = ctx.order[mid];
+			ctx.order[mid] = tri;
+			mid += 1 - right;
+		}
+	}
+	else
+	{
+		computeBounds(ctx, begin, mid, childBounds[0], childCentroids[0]);
+		computeBounds(ctx, mid, end, childBounds[1], childCentroids[1]);
+	}
+
+	buildNode(ctx, begin, mid, depth + 1, childBounds[0], childCentroids[0]);
+	unsigned int right = buildNode(ctx, mid, end, depth + 1, childBounds[1], childCentroids[1]);
+	(*ctx.nodes)[index].offset = right;
+	(*ctx.nodes)[index].count = 0;
+	return index;
+}
+
+static AABB getNodeBounds(const BVHNode& node)
+{
+	return AABB(vec3(node.minPosition[0], node.minPosition[1], node.minPosition[2]),
+		vec3(node.maxPosition[0], node.maxPosition[1], node.maxPosition[2]));
+}
+
+TriangleBVH::TriangleBVH()
+{
+	clear();
+}
+
+void TriangleBVH::clear()
+{
+	mNodes.clear();
+	mCorners.clear();
+	mBlocks.clear();
+	mTriangleIds.clear();
+	mDepth = 0;
+	mBuildTime = 0;
+}
+
+bool TriangleBVH::isEmpty() const
+{
+	return mNodes.empty();
+}
+
+const std::vector<BVHNode>& TriangleBVH::getNodes() const
+{
+	return mNodes;
+}
+
+const std::vector<vec3>& TriangleBVH::getCorners() const
+{
+	return mCorners;
+}
+
+const std::vector<TriangleBlock4>& TriangleBVH::getBlocks() const
+{
+	return mBlocks;
+}
+
+const std::vector<unsigned int>& TriangleBVH::getTriangleIds() const
+{
+	return mTriangleIds;
+}
+
+unsigned int TriangleBVH::getDepth() const
+{
+	return mDepth;
+}
+
+double TriangleBVH::getBuildTime() const
+{
+	return mBuildTime;
+}
+
+bool TriangleBVH::build(const std::vector<vec3>& vertices, const std::vector<ivec3>& triangles, unsigned int maxLeafSize)
+{
+	clear();
+	if(triangles.empty())
+	{
+		PRINTERROR("triangle bvh needs triangles");
+		return false;
+	}
+
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+
+	const unsigned int n = triangles.size();
+	BVHBuildContext ctx;
+	ctx.minPositions.resize(4 * n, 0);
+	ctx.maxPositions.resize(4 * n, 0);
+	ctx.centroids.resize(4 * n, 0);
+	ctx.order.resize(n);
+	ctx.nodes = &mNodes;
+	ctx.maxLeafSize = std::max(maxLeafSize, 1u);
+	ctx.depth = 0;
+	for(unsigned int t = 0; t < n; ++t)
+	{
+		const vec3& a = vertices[triangles[t][0]];
+		const vec3& b = vertices[triangles[t][1]];
+		const vec3& c = vertices[triangles[t][2]];
+		for(unsigned int k = 0; k < 3; ++k)
+		{
+			ctx.minPositions[4 * t + k] = std::min(std::min(a[k], b[k]), c[k]);
+			ctx.maxPositions[4 * t + k] = std::max(std::max(a[k], b[k]), c[k]);
+			ctx.centroids[4 * t + k] = (a[k] + b[k] + c[k]) / 3;
+		}
+		ctx.order[t] = t;
+	}
+
+	BVHBounds bounds, centroidBounds;
+	computeBounds(ctx, 0, n, bounds, centroidBounds);
+	mNodes.reserve(2 * n);
+	buildNode(ctx, 0, n, 0, bounds, centroidBounds);
+	mDepth = ctx.depth;
+
+	// triangles in leaf order, every leaf starts a block of four and its
+	// offset becomes the block index. Unused slots repeat the last triangle.
+	unsigned int numBlocks = 0;
+	for(unsigned int i = 0; i < mNodes.size(); ++i)
+	{
+		BVHNode& node = mNodes[i];
+		if(node.count == 0)
+			continue;
+		const unsigned int first = node.offset;
+		node.offset = numBlocks;
+		mTriangleIds.resize(4 * (numBlocks + (node.count + 3) / 4));
+		for(unsigned int j = 4 * numBlocks; j < mTriangleIds.size(); ++j)
+			mTriangleIds[j] = ctx.order[first + std::min(j - 4 * numBlocks, node.count - 1)];
+		numBlocks = mTriangleIds.size() / 4;
+	}
+	mCorners.resize(3 * mTriangleIds.size());
+	mBlocks.resize(numBlocks);
+	for(unsigned int i = 0; i < mTriangleIds.size(); ++i)
+	{
+		for(unsigned int k = 0; k < 3; ++k)
+			mCorners[3 * i + k] = vertices[triangles[mTriangleIds[i]][k]];
+		setBlockTriangle(mBlocks[i / 4], i % 4, mCorners[3 * i], mCorners[3 * i + 1], mCorners[3 * i + 2]);
+	}
+
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+	mBuildTime = std::chrono::duration<double, std::milli>(t1 - t0).count();
+	return true;
+}
+
+// moves the four triangles of in by R and t
+static void transformBlock(const mat3& R, const vec3& t, const TriangleBlock4& in, TriangleBlock4& out)
+{
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+#ifdef __SSE__
+		const __m128 x = _mm_loadu_ps(in.corner[k][0]);
+		const __m128 y = _mm_loadu_ps(in.corner[k][1]);
+		const __m128 z = _mm_loadu_ps(in.corner[k][2]);
+		for(unsigned int c = 0; c < 3; ++c)
+		{
+			__m128 r = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(R(c, 0)), x), _mm_mul_ps(_mm_set1_ps(R(c, 1)), y));
+			r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(R(c, 2)), z));
+			_mm_storeu_ps(out.corner[k][c], _mm_add_ps(r, _mm_set1_ps(t[c])));
+		}
+#else
+		for(unsigned int c = 0; c < 3; ++c)
+			for(unsigned int i = 0; i < 4; ++i)
+				out.corner[k][c][i] = R(c, 0) * in.corner[k][0][i] + R(c, 1) * in.corner[k][1][i] + R(c, 2) * in.corner[k][2][i] + t[c];
+#endif
+	}
+}
+
+bool TriangleBVH::collide(const mat4& M, const TriangleBVH& other, const mat4& otherM, std::vector<TrianglePair>* pairs, std::vector<TriangleContact>* contacts) const
+{
+	if(isEmpty() || other.isEmpty())
+		return false;
+
+	// the other mesh in the local frame of this one
+	const mat4 T = M.inverse() * otherM;
+	const mat3 R = T.block<3, 3>(0, 0);
+	const vec3 t = T.block<3, 1>(0, 3);
+
+	bool hit = false;
+	std::vector<unsigned int> stack;
+	stack.reserve(128);
+	stack.push_back(0);
+	stack.push_back(0);
+	std::vector<TriangleBlock4> blocks;
+	while(!stack.empty())
+	{
+		const unsigned int b = stack.back();
+		stack.pop_back();
+		const unsigned int a = stack.back();
+		stack.pop_back();
+		const BVHNode& na = mNodes[a];
+		const BVHNode& nb = other.mNodes[b];
+
+		const AABB boxA = getNodeBounds(na);
+		AABB boxB;
+		getNodeBounds(nb).transform(T, boxB);
+		if(!boxA.overlaps(boxB))
+			continue;
+
+		if(na.count > 0 && nb.count > 0)
+		{
+			// leaf against leaf: the other blocks moved into this frame once,
+			// then every triangle here is tested against four at a time
+			const unsigned int numBlocks = (nb.count + 3) / 4;
+			blocks.resize(numBlocks);
+			for(unsigned int j = 0; j < numBlocks; ++j)
+				transformBlock(R, t, other.mBlocks[nb.offset + j], blocks[j]);
+
+			for(unsigned int i = 4 * na.offset; i < 4 * na.offset + na.count; ++i)
+			{
+				const vec3* p = &mCorners[3 * i];
+				for(unsigned int j = 0; j < numBlocks; ++j)
+				{
+					unsigned int mask = trianglesIntersect4(p[0], p[1], p[2], blocks[j]);
+					if(nb.count < 4 * j + 4)
+						mask &= (1u << (nb.count - 4 * j)) - 1;
+					if(!mask)
+						continue;
+
+					hit = true;
+					if(!pairs && !contacts)
+						return true;
+					for(unsigned int l = 0; l < 4; ++l)
+					{
+						if(!(mask & (1u << l)))
+							continue;
+						if(pairs)
+						{
+							TrianglePair pair;
+							pair.a = mTriangleIds[i];
+							pair.b = other.mTriangleIds[4 * (nb.offset + j) + l];
+							pairs->push_back(pair);
+						}
+						if(contacts)
+						{
+							// found in this frame, reported in world space
+							vec3 q0, q1, q2;
+							getBlockTriangle(blocks[j], l, q0, q1, q2);
+							TriangleContact contact;
+							computeTriangleContact(p[0], p[1], p[2], q0, q1, q2, contact);
+							contact.start = M.block<3, 3>(0, 0) * contact.start + M.block<3, 1>(0, 3);
+							contact.end = M.block<3, 3>(0, 0) * contact.end + M.block<3, 1>(0, 3);
+							contact.normal = (M.block<3, 3>(0, 0) * contact.normal).normalized();
+							contacts->push_back(contact);
+						}
+					}
+				}
+			}
+			continue;
+		}
+
+		// descend into the larger node, the left child follows its parent
+		if(nb.count > 0 || (na.count == 0 && boxA.getSurfaceArea() >= boxB.getSurfaceArea()))
+		{
+			stack.push_back(a + 1);
+			stack.push_back(b);
+			stack.push_back(na.offset);
+			stack.push_back(b);
+		}
+		else
+		{
+			stack.push_back(a);
+			stack.push_back(b + 1);
+			stack.push_back(a);
+			stack.push_back(nb.offset);
+		}
+	}
+
+	return hit;
+}
@@ -0,0 +1,89 @@
+#ifndef __TRIANGLEBVH_H__
+#define __TRIANGLEBVH_H__
+
+#include "platform.h"
+#include "aabb.h"
+#include "tritri.h"
+
+//! bvh node of 32 bytes. A leaf holds count triangles starting at block offset, an
+//! inner node has count 0, its left child follows it and offset is its right child.
+struct BVHNode
+{
+	float minPosition[3];
+	unsigned int offset;
+	float maxPosition[3];
+	unsigned int count;
+};
+
+//! two intersecting triangles, as indices into the original triangle lists
+struct TrianglePair
+{
+	unsigned int a;
+	unsigned int b;
+};
+
+/*! TriangleBVH
+ *
+ *  \brief  static bounding volume hierarchy over the triangles of one mesh in
+ *          its local frame, built top down with a binned surface area
+ *          heuristic. The nodes are stored depth first and the triangles are
+ *          copied in leaf order into blocks of four in structure of arrays
+ *          layout, so a leaf reads one piece of memory and the triangle tests
+ *          run four wide. Two meshes are tested in the frame of the first one.
+ */
+class TriangleBVH
+{
+public:
+
+	//! constructor
+	TriangleBVH();
+
+	//! removes the hierarchy
+	void clear();
+
+	//! builds the hierarchy, leaves hold at most maxLeafSize triangles
+	bool build(const std::vector<vec3>& vertices, const std::vector<ivec3>& triangles, unsigned int maxLeafSize = 4);
+
+	//! true if nothing was built
+	bool isEmpty() const;
+
+	const std::vector<BVHNode>& getNodes() const;
+
+	//! corners of the triangles in leaf order, three per triangle slot. Every leaf
+	//! starts at a multiple of four slots, unused slots repeat its last triangle.
+	const std::vector<vec3>& getCorners() const;
+
+	//! the triangle slots in blocks of four
+	const std::vector<TriangleBlock4>& getBlocks() const;
+
+	//! index in the original triangle list of every triangle slot
+	const std::vector<unsigned int>& getTriangleIds() const;
+
+	//! number of levels below the root
+	unsigned int getDepth() const;
+
+	//! milliseconds taken by the last build
+	double getBuildTime() const;
+
+	//! true if the meshes intersect when this one is placed by M and the other by otherM.
+	//! Collects all intersecting triangle pairs and their world space contacts (normals of
+	//! the other mesh) if pairs or contacts are given, else stops at the first one.
+	bool collide(const mat4& M, const TriangleBVH& other, const mat4& otherM,
+		std::vector<TrianglePair>* pairs = NULL, std::vector<TriangleContact>* contacts = NULL) const;
+
+protected:
+
+	std::vector<BVHNode> mNodes;
+
+	std::vector<vec3> mCorners;
+
+	std::vector<TriangleBlock4> mBlocks;
+
+	std::vector<unsigned int> mTriangleIds;
+
+	unsigned int mDepth;
+
+	double mBuildTime;
+};
+
+#endif //__TRIANGLEBVH_H__
@@ -0,0 +1,493 @@
+#include "tritri.h"
+
+#ifdef __SSE__
+ #include <xmmintrin.h>
+#endif
+
+// plane distances below this fraction of the triangle size are taken as on the plane
+#define TRITRI_EPSILON REAL(1e-6)
+
+// dot product in a fixed order, the vectorized test sums the same way and so gives the same answers
+static inline REAL dot3(const vec3& a, const vec3& b)
+{
+	return (a[0] * b[0] + a[1] * b[1]) + a[2] * b[2];
+}
+
+// orientation of c relative to the 2d segment a -> b
+static inline REAL orient2d(const vec2& a, const vec2& b, const vec2& c)
+{
+	return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+// p on the segment a - b, given that the three points are collinear
+static inline bool onSegment2d(const vec2& a, const vec2& b, const vec2& p)
+{
+	return std::min(a[0], b[0]) <= p[0] && p[0] <= std::max(a[0], b[0]) &&
+		std::min(a[1], b[1]) <= p[1] && p[1] <= std::max(a[1], b[1]);
+}
+
+static bool segmentsIntersect2d(const vec2& a, const vec2& b, const vec2& c, const vec2& d)
+{
+	REAL d1 = orient2d(c, d, a);
+	REAL d2 = orient2d(c, d, b);
+	REAL d3 = orient2d(a, b, c);
+	REAL d4 = orient2d(a, b, d);
+	if(((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+		return true;
+
+	// collinear cases: an endpoint on the other segment
+	return (d1 == 0 && onSegment2d(c, d, a)) || (d2 == 0 && onSegment2d(c, d, b)) ||
+		(d3 == 0 && onSegment2d(a, b, c)) || (d4 == 0 && onSegment2d(a, b, d));
+}
+
+static bool pointInTriangle2d(const vec2& p, const vec2& a, const vec2& b, const vec2& c)
+{
+	REAL d1 = orient2d(a, b, p);
+	REAL d2 = orient2d(b, c, p);
+	REAL d3 = orient2d(c, a, p);
+	bool hasNeg = d1 < 0 || d2 < 0 || d3 < 0;
+	bool hasPos = d1 > 0 || d2 > 0 || d3 > 0;
+	return !(hasNeg && hasPos);
+}
+
+// projects two triangles in one plane with normal n onto the axis plane where they are largest
+static void projectCoplanar(const vec3& n, const vec3* v, const vec3* u, vec2* p, vec2* q)
+{
+	vec3 a = n.cwiseAbs();
+	unsigned int i0, i1;
+	if(a[0] > a[1] && a[0] > a[2])
+	{
+		i0 = 1;
+		i1 = 2;
+	}
+	else if(a[1] > a[2])
+	{
+		i0 = 0;
+		i1 = 2;
+	}
+	else
+	{
+		i0 = 0;
+		i1 = 1;
+	}
+
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		p[k] = vec2(v[k][i0], v[k][i1]);
+		q[k] = vec2(u[k][i0], u[k][i1]);
+	}
+}
+
+// both triangles in one plane with normal n: edge crossings or containment in the projection
+static bool coplanarTrianglesIntersect(const vec3& n, const vec3* v, const vec3* u)
+{
+	vec2 p[3], q[3];
+	projectCoplanar(n, v, u, p, q);
+
+	for(unsigned int i = 0; i < 3; ++i)
+		for(unsigned int j = 0; j < 3; ++j)
+			if(segmentsIntersect2d(p[i], p[(i + 1) % 3], q[j], q[(j + 1) % 3]))
+				return true;
+
+	return pointInTriangle2d(p[0], q[0], q[1], q[2]) || pointInTriangle2d(q[0], p[0], p[1], p[2]);
+}
+
+// interval of a triangle on the intersection line: projections vv, plane distances d. Returns false if coplanar.
+static inline bool computeIntervals(REAL vv0, REAL vv1, REAL vv2, REAL d0, REAL d1, REAL d2, REAL d0d1, REAL d0d2,
+	REAL& a, REAL& b, REAL& c, REAL& x0, REAL& x1)
+{
+	if(d0d1 > 0)
+	{
+		// d2 alone on its side
+		a = vv2; b = (vv0 - vv2) * d2; c = (vv1 - vv2) * d2; x0 = d2 - d0; x1 = d2 - d1;
+	}
+	else if(d0d2 > 0)
+	{
+		a = vv1; b = (vv0 - vv1) * d1; c = (vv2 - vv1) * d1; x0 = d1 - d0; x1 = d1 - d2;
+	}
+	else if(d1 * d2 > 0 || d0 != 0)
+	{
+		a = vv0; b = (vv1 - vv0) * d0; c = (vv2 - vv0) * d0; x0 = d0 - d1; x1 = d0 - d2;
+	}
+	else if(d1 != 0)
+	{
+		a = vv1; b = (vv0 - vv1) * d1; c = (vv2 - vv1) * d1; x0 = d1 - d0; x1 = d1 - d2;
+	}
+	else if(d2 != 0)
+	{
+		a = vv2; b = (vv0 - vv2) * d2; c = (vv1 - vv2) * d2; x0 = d2 - d0; x1 = d2 - d1;
+	}
+	else
+		return false;
+	return true;
+}
+
+bool trianglesIntersect(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& u0, const vec3& u1, const vec3& u2)
+{
+	// u against the plane of v
+	vec3 n1 = (v1 - v0).cross(v2 - v0);
+	REAL d1 = -dot3(n1, v0);
+	REAL du0 = dot3(n1, u0) + d1;
+	REAL du1 = dot3(n1, u1) + d1;
+	REAL du2 = dot3(n1, u2) + d1;
+	// the normal is not normalized, its length is twice the area
+	REAL eps = TRITRI_EPSILON * std::sqrt(dot3(n1, n1)) * std::sqrt(dot3(v1 - v0, v1 - v0));
+	if(std::abs(du0) < eps) du0 = 0;
+	if(std::abs(du1) < eps) du1 = 0;
+	if(std::abs(du2) < eps) du2 = 0;
+	REAL du0du1 = du0 * du1;
+	REAL du0du2 = du0 * du2;
+	if(du0du1 > 0 && du0du2 > 0)
+		return false;
+
+	// v against the plane of u
+	vec3 n2 = (u1 - u0).cross(u2 - u0);
+	REAL d2 = -dot3(n2, u0);
+	REAL dv0 = dot3(n2, v0) + d2;
+	REAL dv1 = dot3(n2, v1) + d2;
+	REAL dv2 = dot3(n2, v2) + d2;
+	eps = TRITRI_EPSILON * std::sqrt(dot3(n2, n2)) * std::sqrt(dot3(u1 - u0, u1 - u0));
+	if(std::abs(dv0) < eps) dv0 = 0;
+	if(std::abs(dv1) < eps) dv1 = 0;
+	if(std::abs(dv2) < eps) dv2 = 0;
+	REAL dv0dv1 = dv0 * dv1;
+	REAL dv0dv2 = dv0 * dv2;
+	if(dv0dv1 > 0 && dv0dv2 > 0)
+		return false;
+
+	// project onto the largest axis of the intersection line direction
+	vec3 dir = n1.cross(n2).cwiseAbs();
+	unsigned int index = 0;
+	if(dir[1] > dir[index]) index = 1;
+	if(dir[2] > dir[index]) index = 2;
+
+	REAL a, b, c, x0, x1;
+	REAL d, e, f, y0, y1;
+	if(!computeIntervals(v0[index], v1[index], v2[index], dv0, dv1, dv2, dv0dv1, dv0dv2, a, b, c, x0, x1) ||
+		!computeIntervals(u0[index], u1[index], u2[index], du0, du1, du2, du0du1, du0du2, d, e, f, y0, y1))
+	{
+		const vec3 v[3] = { v0, v1, v2 };
+		const vec3 u[3] = { u0, u1, u2 };
+		return coplanarTrianglesIntersect(n1, v, u);
+	}
+
+	// the intervals scaled by the common denominator x0 * x1 * y0 * y1
+	REAL xx = x0 * x1;
+	REAL yy = y0 * y1;
+	REAL xxyy = xx * yy;
+
+	REAL tmp = a * xxyy;
+	REAL isect1[2] = { tmp + b * x1 * yy, tmp + c * x0 * yy };
+	tmp = d * xxyy;
+	REAL isect2[2] = { tmp + e * xx * y1, tmp + f * xx * y0 };
+
+	if(isect1[0] > isect1[1]) std::swap(isect1[0], isect1[1]);
+	if(isect2[0] > isect2[1]) std::swap(isect2[0], isect2[1]);
+
+	return !(isect1[1] < isect2[0] || isect2[1] < isect1[0]);
+}
+
+#ifdef __SSE__
+
+// lanes of mask from a, the others from b
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// n.dot(p) + d for four points
+static inline __m128 planeDistance4(const __m128* n, __m128 d, const __m128* p)
+{
+	__m128 s = _mm_add_ps(_mm_mul_ps(n[0], p[0]), _mm_mul_ps(n[1], p[1]));
+	return _mm_add_ps(_mm_add_ps(s, _mm_mul_ps(n[2], p[2])), d);
+}
+
+// distances within eps set to 0
+static inline __m128 snapToZero4(__m128 d, __m128 eps)
+{
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	return _mm_andnot_ps(_mm_cmplt_ps(_mm_andnot_ps(sign, d), eps), d);
+}
+
+// computeIntervals for four triangles, the cascade of cases turned into masks.
+// Returns the lanes that are not coplanar.
+static inline __m128 computeIntervals4(const __m128* vv, const __m128* d, __m128 d0d1, __m128 d0d2,
+	__m128& a, __m128& b, __m128& c, __m128& x0, __m128& x1)
+{
+	const __m128 zero = _mm_setzero_ps();
+	__m128 alone2 = _mm_cmpgt_ps(d0d1, zero);
+	__m128 taken = alone2;
+	__m128 alone1 = _mm_andnot_ps(taken, _mm_cmpgt_ps(d0d2, zero));
+	taken = _mm_or_ps(taken, alone1);
+	__m128 alone0 = _mm_andnot_ps(taken, _mm_or_ps(_mm_cmpgt_ps(_mm_mul_ps(d[1], d[2]), zero), _mm_cmpneq_ps(d[0], zero)));
+	taken = _mm_or_ps(taken, alone0);
+	__m128 m = _mm_andnot_ps(taken, _mm_cmpneq_ps(d[1], zero));
+	alone1 = _mm_or_ps(alone1, m);
+	taken = _mm_or_ps(taken, m);
+	m = _mm_andnot_ps(taken, _mm_cmpneq_ps(d[2], zero));
+	alone2 = _mm_or_ps(alone2, m);
+	taken = _mm_or_ps(taken, m);
+
+	// corner k alone, i and j the other two in order
+	__m128 vk = select4(alone2, vv[2], select4(alone1, vv[1], vv[0]));
+	__m128 dk = select4(alone2, d[2], select4(alone1, d[1], d[0]));
+	__m128 vi = select4(alone0, vv[1], vv[0]);
+	__m128 di = select4(alone0, d[1], d[0]);
+	__m128 vj = select4(alone2, vv[1], vv[2]);
+	__m128 dj = select4(alone2, d[1], d[2]);
+	a = vk;
+	b = _mm_mul_ps(_mm_sub_ps(vi, vk), dk);
+	c = _mm_mul_ps(_mm_sub_ps(vj, vk), dk);
+	x0 = _mm_sub_ps(dk, di);
+	x1 = _mm_sub_ps(dk, dj);
+	return taken;
+}
+
+#endif
+
+unsigned int trianglesIntersect4(const vec3& v0, const vec3& v1, const vec3& v2, const TriangleBlock4& block)
+{
+#ifdef __SSE__
+	// the same steps as trianglesIntersect in the same order, so the answers agree
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 eps = _mm_set1_ps(TRITRI_EPSILON);
+	const vec3 v[3] = { v0, v1, v2 };
+	__m128 u[3][3];
+	for(unsigned int k = 0; k < 3; ++k)
+		for(unsigned int c = 0; c < 3; ++c)
+			u[k][c] = _mm_loadu_ps(block.corner[k][c]);
+
+	// the four triangles against the plane of v
+	const vec3 n1 = (v1 - v0).cross(v2 - v0);
+	const __m128 n1s[3] = { _mm_set1_ps(n1[0]), _mm_set1_ps(n1[1]), _mm_set1_ps(n1[2]) };
+	const __m128 d1 = _mm_set1_ps(-dot3(n1, v0));
+	const __m128 eps1 = _mm_set1_ps(TRITRI_EPSILON * std::sqrt(dot3(n1, n1)) * std::sqrt(dot3(v1 - v0, v1 - v0)));
+	__m128 du[3];
+	for(unsigned int k = 0; k < 3; ++k)
+		du[k] = snapToZero4(planeDistance4(n1s, d1, u[k]), eps1);
+	const __m128 du0du1 = _mm_mul_ps(du[0], du[1]);
+	const __m128 du0du2 = _mm_mul_ps(du[0], du[2]);
+	__m128 active = _mm_cmpeq_ps(zero, zero);
+	active = _mm_andnot_ps(_mm_and_ps(_mm_cmpgt_ps(du0du1, zero), _mm_cmpgt_ps(du0du2, zero)), active);
+	if(!_mm_movemask_ps(active))
+		return 0;
+
+	// v against the planes of the four triangles
+	__m128 e1[3], e2[3];
+	for(unsigned int c = 0; c < 3; ++c)
+	{
+		e1[c] = _mm_sub_ps(u[1][c], u[0][c]);
+		e2[c] = _mm_sub_ps(u[2][c], u[0][c]);
+	}
+	const __m128 n2[3] = {
+		_mm_sub_ps(_mm_mul_ps(e1[1], e2[2]), _mm_mul_ps(e1[2], e2[1])),
+		_mm_sub_ps(_mm_mul_ps(e1[2], e2[0]), _mm_mul_ps(e1[0], e2[2])),
+		_mm_sub_ps(_mm_mul_ps(e1[0], e2[1]), _mm_mul_ps(e1[1], e2[0])) };
+	const __m128 d2 = _mm_xor_ps(planeDistance4(n2, zero, u[0]), sign);
+	const __m128 n2Length = _mm_sqrt_ps(planeDistance4(n2, zero, n2));
+	const __m128 e1Length = _mm_sqrt_ps(planeDistance4(e1, zero, e1));
+	const __m128 eps2 = _mm_mul_ps(_mm_mul_ps(eps, n2Length), e1Length);
+	__m128 dv[3];
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		const __m128 vk[3] = { _mm_set1_ps(v[k][0]), _mm_set1_ps(v[k][1]), _mm_set1_ps(v[k][2]) };
+		dv[k] = snapToZero4(planeDistance4(n2, d2, vk), eps2);
+	}
+	const __m128 dv0dv1 = _mm_mul_ps(dv[0], dv[1]);
+	const __m128 dv0dv2 = _mm_mul_ps(dv[0], dv[2]);
+	active = _mm_andnot_ps(_mm_and_ps(_mm_cmpgt_ps(dv0dv1, zero), _mm_cmpgt_ps(dv0dv2, zero)), active);
+	if(!_mm_movemask_ps(active))
+		return 0;
+
+	// project onto the largest axis of the intersection line directions
+	const __m128 dir[3] = {
+		_mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(n1s[1], n2[2]), _mm_mul_ps(n1s[2], n2[1]))),
+		_mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(n1s[2], n2[0]), _mm_mul_ps(n1s[0], n2[2]))),
+		_mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(n1s[0], n2[1]), _mm_mul_ps(n1s[1], n2[0]))) };
+	const __m128 axis1 = _mm_cmpgt_ps(dir[1], dir[0]);
+	const __m128 axis2 = _mm_cmpgt_ps(dir[2], select4(axis1, dir[1], dir[0]));
+	__m128 vv[3], uu[3];
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		vv[k] = select4(axis2, _mm_set1_ps(v[k][2]), select4(axis1, _mm_set1_ps(v[k][1]), _mm_set1_ps(v[k][0])));
+		uu[k] = select4(axis2, u[k][2], select4(axis1, u[k][1], u[k][0]));
+	}
+
+	__m128 a, b, c, x0, x1;
+	__m128 d, e, f, y0, y1;
+	const __m128 notCoplanar = _mm_and_ps(computeIntervals4(vv, dv, dv0dv1, dv0dv2, a, b, c, x0, x1),
+		computeIntervals4(uu, du, du0du1, du0du2, d, e, f, y0, y1));
+
+	const __m128 xx = _mm_mul_ps(x0, x1);
+	const __m128 yy = _mm_mul_ps(y0, y1);
+	const __m128 xxyy = _mm_mul_ps(xx, yy);
+	__m128 tmp = _mm_mul_ps(a, xxyy);
+	const __m128 isect10 = _mm_add_ps(tmp, _mm_mul_ps(_mm_mul_ps(b, x1), yy));
+	const __m128 isect11 = _mm_add_ps(tmp, _mm_mul_ps(_mm_mul_ps(c, x0), yy));
+	tmp = _mm_mul_ps(d, xxyy);
+	const __m128 isect20 = _mm_add_ps(tmp, _mm_mul_ps(_mm_mul_ps(e, xx), y1));
+	const __m128 isect21 = _mm_add_ps(tmp, _mm_mul_ps(_mm_mul_ps(f, xx), y0));
+	const __m128 separated = _mm_or_ps(
+		_mm_cmplt_ps(_mm_max_ps(isect10, isect11), _mm_min_ps(isect20, isect21)),
+		_mm_cmplt_ps(_mm_max_ps(isect20, isect21), _mm_min_ps(isect10, isect11)));
+
+	unsigned int result = _mm_movemask_ps(_mm_andnot_ps(separated, _mm_and_ps(active, notCoplanar)));
+
+	// the rare coplanar lanes go the scalar way
+	const unsigned int coplanar = _mm_movemask_ps(_mm_andnot_ps(notCoplanar, active));
+	for(unsigned int i = 0; i < 4; ++i)
+	{
+		if(!(coplanar & (1u << i)))
+			continue;
+		vec3 w[3];
+		getBlockTriangle(block, i, w[0], w[1], w[2]);
+		if(coplanarTrianglesIntersect(n1, v, w))
+			result |= 1u << i;
+	}
+	return result;
+#else
+	unsigned int result = 0;
+	for(unsigned int i = 0; i < 4; ++i)
+	{
+		vec3 u0, u1, u2;
+		getBlockTriangle(block, i, u0, u1, u2);
+		if(trianglesIntersect(v0, v1, v2, u0, u1, u2))
+			result |= 1u << i;
+	}
+	return result;
+#endif
+}
+
+// points where the edges of triangle p meet a plane, d are the plane distances of its corners
+static unsigned int planeCrossings(const vec3* p, const REAL* d, vec3* out)
+{
+	unsigned int n = 0;
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		const unsigned int l = (k + 1) % 3;
+		if(d[k] == 0)
+			out[n++] = p[k];
+		else if((d[k] < 0 && d[l] > 0) || (d[k] > 0 && d[l] < 0))
+			out[n++] = p[k] + (p[l] - p[k]) * (d[k] / (d[k] - d[l]));
+	}
+	return n;
+}
+
+// mean of the corners of the overlap of two coplanar triangles: corners inside the other triangle and edge crossings
+static vec3 coplanarContactPoint(const vec3& n, const vec3* v, const vec3* u)
+{
+	vec2 p[3], q[3];
+	projectCoplanar(n, v, u, p, q);
+
+	vec3 sum = vec3::Zero();
+	unsigned int count = 0;
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		if(pointInTriangle2d(p[k], q[0], q[1], q[2]))
+		{
+			sum += v[k];
+			++count;
+		}
+		if(pointInTriangle2d(q[k], p[0], p[1], p[2]))
+		{
+			sum += u[k];
+			++count;
+		}
+	}
+	for(unsigned int i = 0; i < 3; ++i)
+	{
+		const unsigned int i1 = (i + 1) % 3;
+		for(unsigned int j = 0; j < 3; ++j)
+		{
+			const unsigned int j1 = (j + 1) % 3;
+			REAL d1 = orient2d(q[j], q[j1], p[i]);
+			REAL d2 = orient2d(q[j], q[j1], p[i1]);
+			REAL d3 = orient2d(p[i], p[i1], q[j]);
+			REAL d4 = orient2d(p[i], p[i1], q[j1]);
+			if(((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0)))
+			{
+				sum += v[i] + (v[i1] - v[i]) * (d1 / (d1 - d2));
+				++count;
+			}
+		}
+	}
+
+	if(count == 0)
+		return (v[0] + v[1] + v[2] + u[0] + u[1] + u[2]) / 6;
+	return sum / REAL(count);
+}
+
+void computeTriangleContact(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& u0, const vec3& u1, const vec3& u2, TriangleContact& contact)
+{
+	const vec3 v[3] = { v0, v1, v2 };
+	const vec3 u[3] = { u0, u1, u2 };
+
+	// plane distances as in trianglesIntersect
+	const vec3 n1 = (v1 - v0).cross(v2 - v0);
+	const vec3 n2 = (u1 - u0).cross(u2 - u0);
+	REAL du[3], dv[3];
+	REAL eps1 = TRITRI_EPSILON * std::sqrt(dot3(n1, n1)) * std::sqrt(dot3(v1 - v0, v1 - v0));
+	REAL eps2 = TRITRI_EPSILON * std::sqrt(dot3(n2, n2)) * std::sqrt(dot3(u1 - u0, u1 - u0));
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		du[k] = dot3(n1, u[k]) - dot3(n1, v0);
+		dv[k] = dot3(n2, v[k]) - dot3(n2, u0);
+		if(std::abs(du[k]) < eps1) du[k] = 0;
+		if(std::abs(dv[k]) < eps2) dv[k] = 0;
+	}
+
+	contact.normal = n2;
+	REAL l = n2.norm();
+	if(l > 0)
+		contact.normal /= l;
+
+	vec3 pv[3], pu[3];
+	unsigned int nv = planeCrossings(v, dv, pv);
+	unsigned int nu = planeCrossings(u, du, pu);
+	if(nv == 3 || nu == 3 || nv == 0 || nu == 0)
+	{
+		contact.start = contact.end = coplanarContactPoint(n1, v, u);
+		return;
+	}
+
+	// both segments lie on the intersection line, their overlap is the contact
+	const vec3 dir = n1.cross(n2);
+	unsigned int vMin = 0, vMax = 0, uMin = 0, uMax = 0;
+	for(unsigned int i = 1; i < nv; ++i)
+	{
+		if(dir.dot(pv[i]) < dir.dot(pv[vMin])) vMin = i;
+		if(dir.dot(pv[i]) > dir.dot(pv[vMax])) vMax = i;
+	}
+	for(unsigned int i = 1; i < nu; ++i)
+	{
+		if(dir.dot(pu[i]) < dir.dot(pu[uMin])) uMin = i;
+		if(dir.dot(pu[i]) > dir.dot(pu[uMax])) uMax = i;
+	}
+	contact.start = dir.dot(pv[vMin]) > dir.dot(pu[uMin]) ? pv[vMin] : pu[uMin];
+	contact.end = dir.dot(pv[vMax]) < dir.dot(pu[uMax]) ? pv[vMax] : pu[uMax];
+
+	// numerically disjoint segments of touching triangles meet in the middle
+	if(dir.dot(contact.start) > dir.dot(contact.end))
+		contact.start = contact.end = (contact.start + contact.end) / 2;
+}
+
+void setBlockTriangle(TriangleBlock4& block, unsigned int i, const vec3& a, const vec3& b, const vec3& c)
+{
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		block.corner[0][k][i] = a[k];
+		block.corner[1][k][i] = b[k];
+		block.corner[2][k][i] = c[k];
+	}
+}
+
+void getBlockTriangle(const TriangleBlock4& block, unsigned int i, vec3& a, vec3& b, vec3& c)
+{
+	for(unsigned int k = 0; k < 3; ++k)
+	{
+		a[k] = block.corner[0][k][i];
+		b[k] = block.corner[1][k][i];
+		c[k] = block.corner[2][k][i];
+	}
+}
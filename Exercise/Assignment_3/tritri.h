@@ -0,0 +1,39 @@
+#ifndef __TRITRI_H__
+#define __TRITRI_H__
+
+#include "platform.h"
+
+//! four triangles in structure of arrays layout, coordinate c of corner k of triangle i is corner[k][c][i]
+struct TriangleBlock4
+{
+	float corner[3][3][4];
+};
+
+//! where two intersecting triangles meet
+struct TriangleContact
+{
+	//! ends of the intersection segment, equal if the triangles touch in a point or are coplanar
+	vec3 start;
+	vec3 end;
+
+	//! unit normal of the second triangle
+	vec3 normal;
+};
+
+//! true if the triangles (v0, v1, v2) and (u0, u1, u2) intersect, touching counts (Moeller's interval test)
+bool trianglesIntersect(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& u0, const vec3& u1, const vec3& u2);
+
+//! tests the triangle (v0, v1, v2) against the four triangles of block at once, bit i
+//! of the result is set if triangle i intersects. Gives the same answers as trianglesIntersect.
+unsigned int trianglesIntersect4(const vec3& v0, const vec3& v1, const vec3& v2, const TriangleBlock4& block);
+
+//! intersection segment and normal of two triangles that are known to intersect
+void computeTriangleContact(const vec3& v0, const vec3& v1, const vec3& v2, const vec3& u0, const vec3& u1, const vec3& u2, TriangleContact& contact);
+
+//! stores the triangle (a, b, c) as triangle i of block
+void setBlockTriangle(TriangleBlock4& block, unsigned int i, const vec3& a, const vec3& b, const vec3& c);
+
+//! reads triangle i of block
+void getBlockTriangle(const TriangleBlock4& block, unsigned int i, vec3& a, vec3& b, vec3& c);
+
+#endif //__TRITRI_H__
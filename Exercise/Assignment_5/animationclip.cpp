@@ -0,0 +1,91 @@
+#include "animationclip.h"
+#include "skeleton.h"
+
+AnimationClip::AnimationClip()
+	: mNumFrames(0),
+	  mNumBones(0),
+	  mFrameRate(REAL(30))
+{
+	mRotations.clear();
+	mOffsets.clear();
+}
+
+void AnimationClip::resize(unsigned int numFrames, unsigned int numBones)
+{
+	mNumFrames = numFrames;
+	mNumBones = numBones;
+	mRotations.assign(numFrames * numBones, mat3::Identity());
+	mOffsets.assign(numFrames * numBones, vec3::Zero());
+}
+
+unsigned int AnimationClip::getNumFrames() const
+{
+	return mNumFrames;
+}
+
+unsigned int AnimationClip::getNumBones() const
+{
+	return mNumBones;
+}
+
+REAL AnimationClip::getFrameRate() const
+{
+	return mFrameRate;
+}
+
+void AnimationClip::setFrameRate(REAL fps)
+{
+	mFrameRate = fps;
+}
+
+mat3& AnimationClip::rotation(unsigned int frame, unsigned int bone)
+{
+	return mRotations[frame * mNumBones + bone];
+}
+
+const mat3& AnimationClip::rotation(unsigned int frame, unsigned int bone) const
+{
+	return mRotations[frame * mNumBones + bone];
+}
+
+vec3& AnimationClip::offset(unsigned int frame, unsigned int bone)
+{
+	return mOffsets[frame * mNumBones + bone];
+}
+
+const vec3& AnimationClip::offset(unsigned int frame, unsigned int bone) const
+{
+	return mOffsets[frame * mNumBones + bone];
+}
+
+bool AnimationClip::setFrameFromSkeleton(unsigned int frame, const Skeleton& skel)
+{
+	if(frame >= mNumFrames || skel.getNumBones() != mNumBones)
+	{
+		PRINTERROR("AnimationClip::setFrameFromSkeleton error: frame out of bounds or skeleton does not match");
+		return false;
+	}
+
+	for(unsigned int i = 0; i < mNumBones; ++i)
+	{
+		skel.getBoneBasis(i, rotation(frame, i), offset(frame, i));
+	}
+
+	return true;
+}
+
+bool AnimationClip::applyFrame(unsigned int frame, Skeleton& skel) const
+{
+	if(frame >= mNumFrames || skel.getNumBones() != mNumBones)
+	{
+		PRINTERROR("AnimationClip::applyFrame error: frame out of bounds or skeleton does not match");
+		return false;
+	}
+
+	for(unsigned int i = 0; i < mNumBones; ++i)
+	{
+		skel.setBoneTransform(i, rotation(frame, i), offset(frame, i));
+	}
+
+	return true;
+}
@@ -0,0 +1,66 @@
+#ifndef __ANIMATIONCLIP_H__
+#define __ANIMATIONCLIP_H__
+
+#include "platform.h"
+
+class Skeleton;
+
+/*! AnimationClip
+ *
+ *  \brief  dense sampled skeleton animation, one basis and offset per bone
+ *          and frame (the Bone::R and Bone::t of a posed skeleton). The
+ *          samples are stored frame by frame in flat arrays, so a frame is a
+ *          contiguous block that can be processed independently.
+ */
+class AnimationClip
+{
+public:
+
+	//! constructor
+	AnimationClip();
+
+	//! allocates numFrames x numBones samples (set to identity)
+	void resize(unsigned int numFrames, unsigned int numBones);
+
+	//! get number of frames
+	unsigned int getNumFrames() const;
+
+	//! get number of bones per frame
+	unsigned int getNumBones() const;
+
+	//! sampling rate in frames per second
+	REAL getFrameRate() const;
+
+	//! set the sampling rate in frames per second
+	void setFrameRate(REAL fps);
+
+	//! basis of a bone in a frame
+	mat3& rotation(unsigned int frame, unsigned int bone);
+	const mat3& rotation(unsigned int frame, unsigned int bone) const;
+
+	//! offset of a bone in a frame
+	vec3& offset(unsigned int frame, unsigned int bone);
+	const vec3& offset(unsigned int frame, unsigned int bone) const;
+
+	//! stores the current pose of skel in frame
+	bool setFrameFromSkeleton(unsigned int frame, const Skeleton& skel);
+
+	//! poses skel (bases and joints) by the given frame
+	bool applyFrame(unsigned int frame, Skeleton& skel) const;
+
+protected:
+
+	unsigned int mNumFrames;
+
+	unsigned int mNumBones;
+
+	REAL mFrameRate;
+
+	//! bases, frame major
+	std::vector<mat3> mRotations;
+
+	//! offsets, frame major
+	std::vector<vec3> mOffsets;
+};
+
+#endif //__ANIMATIONCLIP_H__
@@ -0,0 +1,342 @@
+#include "bvhimporter.h"
+#include "skeleton.h"
+#include "animationclip.h"
+#include "geomutils.h"
+
+#include <cstdlib>
+
+BVHImporter::BVHImporter()
+	: mNumChannels(0),
+	  mNumFrames(0),
+	  mNumFramesRead(0),
+	  mFrameTime(0),
+	  mOriginJoint(-1)
+{
+}
+
+BVHImporter::~BVHImporter()
+{
+	close();
+}
+
+bool BVHImporter::open(const std::string& filename)
+{
+	close();
+	mJoints.clear();
+	mBoneJoints.clear();
+	mBoneRest.clear();
+	mNumChannels = 0;
+	mNumFrames = 0;
+	mNumFramesRead = 0;
+	mFrameTime = 0;
+	mOriginJoint = -1;
+
+	mFile.open(filename.c_str());
+	if(!mFile.good())
+	{
+		PRINTERROR("BVHImporter::open error: file " << filename.c_str() << " not found");
+		return false;
+	}
+
+	std::string token, name;
+	mFile >> token;
+	if(token != "HIERARCHY")
+	{
+		PRINTERROR("BVHImporter::open error: " << filename.c_str() << " is no bvh file");
+		close();
+		return false;
+	}
+
+	mFile >> token >> name;
+	if(token != "ROOT" || !parseJoint(mFile, name, -1, false))
+	{
+		PRINTERROR("BVHImporter::open error: invalid hierarchy in " << filename.c_str());
+		close();
+		return false;
+	}
+
+	// MOTION / Frames: n / Frame Time: t
+	mFile >> token;
+	if(token != "MOTION")
+	{
+		PRINTERROR("BVHImporter::open error: MOTION section missing in " << filename.c_str());
+		close();
+		return false;
+	}
+	mFile >> token >> mNumFrames >> token >> token >> mFrameTime;
+	std::getline(mFile, mLine);
+	if(!mFile.good())
+	{
+		PRINTERROR("BVHImporter::open error: invalid MOTION header in " << filename.c_str());
+		close();
+		return false;
+	}
+
+	// the fitting of the skeleton expects a single root bone. A root joint with
+	// several children gets a bone of length 0 to an extra joint at the root,
+	// the links leaving the root become children of that bone
+	const unsigned int numLinkJoints = mJoints.size();
+	unsigned int numRootLinks = 0;
+	for(unsigned int j = 1; j < numLinkJoints; ++j)
+	{
+		if(mJoints[j].parent == 0)
+			numRootLinks++;
+	}
+	if(numRootLinks > 1)
+	{
+		Joint origin;
+		origin.name = mJoints[0].name + "_origin";
+		origin.parent = 0;
+		origin.offset.setZero();
+		origin.firstChannel = mNumChannels;
+		origin.numChannels = 0;
+		mOriginJoint = mJoints.size();
+		mJoints.push_back(origin);
+		mBoneJoints.push_back(0);
+		mBoneJoints.push_back(mOriginJoint);
+		mBoneRest.push_back(mat3::Identity());
+	}
+
+	// one bone per link, its parent is the bone ending in its start joint
+	for(unsigned int j = 1; j < numLinkJoints; ++j)
+	{
+		int p = mJoints[j].parent;
+		mBoneJoints.push_back(p);
+		mBoneJoints.push_back(j);
+
+		// rest basis as Skeleton::updateBonesByJoints sets it up
+		mat3 R = mat3::Identity();
+		vec3 d = mJoints[j].offset;
+		if(d.norm() > 0)
+			getGoodBasis(d.normalized(), R);
+		mBoneRest.push_back(R);
+	}
+
+	mValues.resize(mNumChannels);
+	mGlobalRot.resize(mJoints.size());
+	mGlobalPos.resize(mJoints.size());
+
+	return true;
+}
+
+void BVHImporter::close()
+{
+	if(mFile.is_open())
+		mFile.close();
+	mFile.clear();
+}
+
+bool BVHImporter::parseJoint(std::istream& in, const std::string& name, int parent, bool endSite)
+{
+	std::string token;
+	in >> token;
+	if(token != "{")
+		return false;
+
+	Joint joint;
+	joint.name = name;
+	joint.parent = parent;
+	joint.offset.setZero();
+	joint.firstChannel = mNumChannels;
+	joint.numChannels = 0;
+	int self = mJoints.size();
+	mJoints.push_back(joint);
+
+	while(in >> token)
+	{
+		if(token == "}")
+		{
+			return true;
+		}
+		else if(token == "OFFSET")
+		{
+			vec3& o = mJoints[self].offset;
+			in >> o[0] >> o[1] >> o[2];
+		}
+		else if(token == "CHANNELS" && !endSite)
+		{
+			unsigned int n = 0;
+			in >> n;
+			if(n > 6)
+				return false;
+			mJoints[self].numChannels = n;
+			mNumChannels += n;
+			for(unsigned int c = 0; c < n; ++c)
+			{
+				in >> token;
+				if(token.size() != 9 || token[0] < 'X' || token[0] > 'Z')
+					return false;
+				unsigned char axis = token[0] - 'X';
+				mJoints[self].channels[c] = (token.compare(1, 8, "position") == 0) ? XPOSITION + axis : XROTATION + axis;
+			}
+		}
+		else if(token == "JOINT" && !endSite)
+		{
+			std::string child;
+			in >> child;
+			if(!parseJoint(in, child, self, false))
+				return false;
+		}
+		else if(token == "End" && !endSite)
+		{
+			in >> token; // Site
+			if(!parseJoint(in, name + "_end", self, true))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool BVHImporter::parseFrameLine(const std::string& line)
+{
+	const char* cur = line.c_str();
+	char* end = NULL;
+	for(unsigned int c = 0; c < mNumChannels; ++c)
+	{
+		mValues[c] = std::strtof(cur, &end);
+		if(end == cur)
+			return false;
+		cur = end;
+	}
+	return true;
+}
+
+unsigned int BVHImporter::getNumJoints() const
+{
+	return mJoints.size();
+}
+
+unsigned int BVHImporter::getNumBones() const
+{
+	return mBoneRest.size();
+}
+
+unsigned int BVHImporter::getNumFrames() const
+{
+	return mNumFrames;
+}
+
+unsigned int BVHImporter::getNumFramesRead() const
+{
+	return mNumFramesRead;
+}
+
+REAL BVHImporter::getFrameTime() const
+{
+	return mFrameTime;
+}
+
+const std::string& BVHImporter::getJointName(unsigned int idx) const
+{
+	return mJoints[idx].name;
+}
+
+int BVHImporter::findJoint(const std::string& name) const
+{
+	for(unsigned int i = 0; i < mJoints.size(); ++i)
+	{
+		if(mJoints[i].name == name)
+			return i;
+	}
+	return -1;
+}
+
+void BVHImporter::createSkeleton(Skeleton& skel) const
+{
+	skel.clear();
+
+	// rest pose joints, parents are stored before their children
+	std::vector<vec3> rest(mJoints.size());
+	for(unsigned int j = 0; j < mJoints.size(); ++j)
+	{
+		rest[j] = mJoints[j].offset;
+		if(mJoints[j].parent > -1)
+			rest[j] += rest[mJoints[j].parent];
+		skel.addJoint(rest[j]);
+	}
+
+	std::vector<int> boneOfEndJoint(mJoints.size(), -1);
+	for(unsigned int b = 0; b < mBoneRest.size(); ++b)
+	{
+		int j0 = mBoneJoints[2 * b];
+		int j1 = mBoneJoints[2 * b + 1];
+		skel.addBone(j0, j1, boneOfEndJoint[j0]);
+		boneOfEndJoint[j1] = b;
+
+		// the bone to the origin joint stands for the root joint itself
+		if(j1 == mOriginJoint)
+			boneOfEndJoint[j0] = b;
+	}
+
+	skel.updateBonesByJoints();
+}
+
+unsigned int BVHImporter::readFrames(unsigned int maxFrames, AnimationClip& clip)
+{
+	const unsigned int numBones = mBoneRest.size();
+	unsigned int count = std::min(maxFrames, mNumFrames - mNumFramesRead);
+	if(!mFile.is_open())
+		count = 0;
+
+	if(clip.getNumFrames() != count || clip.getNumBones() != numBones)
+		clip.resize(count, numBones);
+	if(mFrameTime > 0)
+		clip.setFrameRate(REAL(1) / mFrameTime);
+
+	const REAL degToRad = REAL(M_PI / 180.0);
+	for(unsigned int f = 0; f < count; ++f)
+	{
+		if(!std::getline(mFile, mLine) || !parseFrameLine(mLine))
+		{
+			PRINTERROR("BVHImporter::readFrames error: frame " << mNumFramesRead << " is broken");
+			clip.resize(f, numBones);
+			close();
+			return f;
+		}
+
+		// channels to global quaternions and positions, parents come first
+		for(unsigned int j = 0; j < mJoints.size(); ++j)
+		{
+			const Joint& joint = mJoints[j];
+			vec3 t = joint.offset;
+			quat q = quat::Identity();
+			for(unsigned int c = 0; c < joint.numChannels; ++c)
+			{
+				REAL v = mValues[joint.firstChannel + c];
+				unsigned char ch = joint.channels[c];
+				if(ch < XROTATION)
+					t[ch] += v;
+				else
+					q = q * quat(anax(v * degToRad, vec3::Unit(ch - XROTATION)));
+			}
+
+			if(joint.parent > -1)
+			{
+				mGlobalPos[j] = mGlobalPos[joint.parent] + mGlobalRot[joint.parent] * t;
+				mGlobalRot[j] = mGlobalRot[joint.parent] * q;
+			}
+			else
+			{
+				mGlobalPos[j] = t;
+				mGlobalRot[j] = q;
+			}
+		}
+
+		// a bone moves with its start joint
+		for(unsigned int b = 0; b < numBones; ++b)
+		{
+			int j0 = mBoneJoints[2 * b];
+			clip.rotation(f, b) = mGlobalRot[j0].toRotationMatrix() * mBoneRest[b];
+			clip.offset(f, b) = mGlobalPos[j0];
+		}
+
+		mNumFramesRead++;
+	}
+
+	return count;
+}
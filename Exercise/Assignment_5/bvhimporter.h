@@ -0,0 +1,123 @@
+#ifndef __BVHIMPORTER_H__
+#define __BVHIMPORTER_H__
+
+#include "platform.h"
+
+class Skeleton;
+class AnimationClip;
+
+/*! BVHImporter
+ *
+ *  \brief  streaming reader for Biovision hierarchy files. open() parses the
+ *          HIERARCHY and the MOTION header only, the frames are read chunk
+ *          by chunk with readFrames(), so large takes are never held in
+ *          memory. The channels of each frame are turned into global joint
+ *          quaternions on the fly and stored as bone bases of the skeleton
+ *          created by createSkeleton() (one joint per bvh joint or end site,
+ *          one bone per parent-child link, a root with several children
+ *          gets a bone of length 0 as single root bone).
+ */
+class BVHImporter
+{
+public:
+
+	//! constructor
+	BVHImporter();
+
+	//! destructor
+	~BVHImporter();
+
+	//! opens the file and parses everything up to the first frame
+	bool open(const std::string& filename);
+
+	//! closes the file
+	void close();
+
+	//! get number of joints (including end sites and the origin joint of a branching root)
+	unsigned int getNumJoints() const;
+
+	//! get number of bones of the created skeleton
+	unsigned int getNumBones() const;
+
+	//! number of frames announced in the file
+	unsigned int getNumFrames() const;
+
+	//! number of frames read so far
+	unsigned int getNumFramesRead() const;
+
+	//! seconds per frame
+	REAL getFrameTime() const;
+
+	//! name of a joint
+	const std::string& getJointName(unsigned int idx) const;
+
+	//! index of a named joint or -1
+	int findJoint(const std::string& name) const;
+
+	//! replaces skel by the hierarchy in its rest pose
+	void createSkeleton(Skeleton& skel) const;
+
+	//! reads up to maxFrames frames into clip (resized to the frames read), returns that count
+	unsigned int readFrames(unsigned int maxFrames, AnimationClip& clip);
+
+protected:
+
+	enum Channel
+	{
+		XPOSITION = 0,
+		YPOSITION,
+		ZPOSITION,
+		XROTATION,
+		YROTATION,
+		ZROTATION
+	};
+
+	struct Joint
+	{
+		std::string name;
+		int parent;
+		vec3 offset;
+		unsigned int firstChannel;
+		unsigned int numChannels;
+		unsigned char channels[6];
+	};
+
+	//! parses a JOINT/ROOT/End Site block recursively
+	bool parseJoint(std::istream& in, const std::string& name, int parent, bool endSite);
+
+	//! parses the values of one frame line into mValues
+	bool parseFrameLine(const std::string& line);
+
+	std::ifstream mFile;
+
+	std::vector<Joint> mJoints;
+
+	//! start and end joint of each bone
+	std::vector<int> mBoneJoints;
+
+	//! rest bases of the bones
+	std::vector<mat3> mBoneRest;
+
+	unsigned int mNumChannels;
+
+	unsigned int mNumFrames;
+
+	unsigned int mNumFramesRead;
+
+	REAL mFrameTime;
+
+	//! scratch: channel values of the current frame
+	std::vector<REAL> mValues;
+
+	//! scratch: global joint rotations and positions of the current frame
+	std::vector<quat, Eigen::aligned_allocator<quat> > mGlobalRot;
+	std::vector<vec3> mGlobalPos;
+
+	//! scratch: the current line
+	std::string mLine;
+
+	//! extra joint at a root with several children, ending the root bone, or -1
+	int mOriginJoint;
+};
+
+#endif //__BVHIMPORTER_H__
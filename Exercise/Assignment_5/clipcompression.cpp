@@ -0,0 +1,306 @@
+#include "clipcompression.h"
+#include "skeleton.h"
+#include "animationclip.h"
+
+// longest key interval tried by the reduction, bounds its cost
+#define MAX_KEY_SPAN 1024
+
+// angle between two unit quaternions. The acos of their dot product is 0 in float below
+// about 7e-4, the chord and the sum keep the small angles the tolerance is made of
+static REAL quatAngle(const quat& a, const quat& b)
+{
+	const REAL s = (a.dot(b) < 0) ? REAL(-1) : REAL(1);
+	return REAL(4) * std::atan2((a.coeffs() - s * b.coeffs()).norm(), (a.coeffs() + s * b.coeffs()).norm());
+}
+
+// normalized linear interpolation, a and b have to be in the same hemisphere
+static quat nlerp(const quat& a, const quat& b, REAL u)
+{
+	quat q;
+	q.coeffs() = (REAL(1) - u) * a.coeffs() + u * b.coeffs();
+	q.normalize();
+	return q;
+}
+
+static short quantizeUnit(REAL v)
+{
+	return (short)std::floor(std::max(REAL(-1), std::min(REAL(1), v)) * REAL(32767) + REAL(0.5));
+}
+
+CompressedClip::CompressedClip()
+	: mNumFrames(0),
+	  mNumBones(0),
+	  mNumExceeded(0),
+	  mFrameRate(REAL(30))
+{
+}
+
+bool CompressedClip::compress(const AnimationClip& clip, const Skeleton& skel, REAL toleranceMM, REAL unitsPerMM)
+{
+	mNumFrames = 0;
+	mNumBones = 0;
+	mNumExceeded = 0;
+	mRotOffsets.clear();
+	mRotTimes.clear();
+	mRotKeys.clear();
+	mPosOffsets.clear();
+	mPosTimes.clear();
+	mPosKeys.clear();
+	mPosMin.clear();
+	mPosScale.clear();
+
+	const unsigned int n = clip.getNumFrames();
+	const unsigned int numBones = clip.getNumBones();
+	if(n == 0 || n > 65535 || skel.getNumBones() != numBones)
+	{
+		PRINTERROR("CompressedClip::compress error: clip needs 1..65535 frames and has to match the skeleton");
+		return false;
+	}
+
+	mNumFrames = n;
+	mNumBones = numBones;
+	mFrameRate = clip.getFrameRate();
+
+	// the end of a bone moves by the translation error plus angle * length, both get half
+	const REAL halfTol = REAL(0.5) * toleranceMM * unitsPerMM;
+	std::vector<REAL> lengths;
+	skel.getBoneLengths(lengths);
+
+	std::vector<quat, Eigen::aligned_allocator<quat> > src(n), quant(n);
+	std::vector<vec3> pos(n), posQuant(n);
+	std::vector<unsigned int> keys(0);
+
+	for(unsigned int b = 0; b < numBones; ++b)
+	{
+		// rotation track: continuous hemisphere, quantize every sample up front
+		for(unsigned int f = 0; f < n; ++f)
+		{
+			src[f] = quat(clip.rotation(f, b));
+			src[f].normalize();
+			if(f > 0 && src[f].dot(src[f - 1]) < 0)
+				src[f].coeffs() = -src[f].coeffs();
+
+			for(unsigned int c = 0; c < 4; ++c)
+				quant[f].coeffs()[c] = REAL(quantizeUnit(src[f].coeffs()[c])) / REAL(32767);
+			quant[f].normalize();
+		}
+
+		const REAL rotTol = halfTol / std::max(lengths[b], REAL(2) * halfTol);
+
+		// a sample the quantization puts over the tolerance fails every span ending at it,
+		// so it only becomes a key of a single frame span, whose error is checked here
+		keys.clear();
+		keys.push_back(0);
+		mNumExceeded += quatAngle(quant[0], src[0]) > rotTol;
+		unsigned int i = 0;
+		while(i < n - 1)
+		{
+			unsigned int best = i + 1;
+			unsigned int last = std::min(n - 1, i + MAX_KEY_SPAN);
+			for(unsigned int e = i + 2; e <= last; ++e)
+			{
+				// the span includes its keys, so their quantization error is checked too
+				bool ok = true;
+				for(unsigned int f = i; f <= e && ok; ++f)
+				{
+					quat q = nlerp(quant[i], quant[e], REAL(f - i) / REAL(e - i));
+					ok = quatAngle(q, src[f]) <= rotTol;
+				}
+				if(!ok)
+					break;
+				best = e;
+			}
+			if(best == i + 1)
+				mNumExceeded += quatAngle(quant[best], src[best]) > rotTol;
+			keys.push_back(best);
+			i = best;
+		}
+
+		mRotOffsets.push_back(mRotTimes.size());
+		for(unsigned int k = 0; k < keys.size(); ++k)
+		{
+			mRotTimes.push_back(keys[k]);
+			for(unsigned int c = 0; c < 4; ++c)
+				mRotKeys.push_back(quantizeUnit(src[keys[k]].coeffs()[c]));
+		}
+
+		// translation track: 16 bit in the range of the track
+		vec3 minP = clip.offset(0, b);
+		vec3 maxP = minP;
+		for(unsigned int f = 0; f < n; ++f)
+		{
+			pos[f] = clip.offset(f, b);
+			minP = minP.cwiseMin(pos[f]);
+			maxP = maxP.cwiseMax(pos[f]);
+		}
+		vec3 scale = (maxP - minP) / REAL(65535);
+		mPosMin.push_back(minP);
+		mPosScale.push_back(scale);
+
+		std::vector<unsigned short> q16(3 * n);
+		for(unsigned int f = 0; f < n; ++f)
+		{
+			for(unsigned int c = 0; c < 3; ++c)
+			{
+				REAL v = (scale[c] > 0) ? (pos[f][c] - minP[c]) / scale[c] : REAL(0);
+				q16[3 * f + c] = (unsigned short)std::floor(std::min(REAL(65535), v) + REAL(0.5));
+				posQuant[f][c] = minP[c] + REAL(q16[3 * f + c]) * scale[c];
+			}
+		}
+
+		keys.clear();
+		keys.push_back(0);
+		mNumExceeded += (posQuant[0] - pos[0]).norm() > halfTol;
+		i = 0;
+		while(i < n - 1)
+		{
+			unsigned int best = i + 1;
+			unsigned int last = std::min(n - 1, i + MAX_KEY_SPAN);
+			for(unsigned int e = i + 2; e <= last; ++e)
+			{
+				bool ok = true;
+				for(unsigned int f = i; f <= e && ok; ++f)
+				{
+					REAL u = REAL(f - i) / REAL(e - i);
+					vec3 p = (REAL(1) - u) * posQuant[i] + u * posQuant[e];
+					ok = (p - pos[f]).norm() <= halfTol;
+				}
+				if(!ok)
+					break;
+				best = e;
+			}
+			if(best == i + 1)
+				mNumExceeded += (posQuant[best] - pos[best]).norm() > halfTol;
+			keys.push_back(best);
+			i = best;
+		}
+
+		mPosOffsets.push_back(mPosTimes.size());
+		for(unsigned int k = 0; k < keys.size(); ++k)
+		{
+			mPosTimes.push_back(keys[k]);
+			for(unsigned int c = 0; c < 3; ++c)
+				mPosKeys.push_back(q16[3 * keys[k] + c]);
+		}
+	}
+
+	mRotOffsets.push_back(mRotTimes.size());
+	mPosOffsets.push_back(mPosTimes.size());
+
+	return true;
+}
+
+unsigned int CompressedClip::findKey(const std::vector<unsigned short>& times, unsigned int first, unsigned int last, REAL frame) const
+{
+	std::vector<unsigned short>::const_iterator it = std::upper_bound(times.begin() + first, times.begin() + last, frame);
+	if(it == times.begin() + first)
+		return first;
+	return (it - times.begin()) - 1;
+}
+
+quat CompressedClip::getRotationKey(unsigned int k) const
+{
+	const short* q = &mRotKeys[4 * k];
+	quat r;
+	r.coeffs() << REAL(q[0]), REAL(q[1]), REAL(q[2]), REAL(q[3]);
+	r.normalize();
+	return r;
+}
+
+vec3 CompressedClip::getTranslationKey(unsigned int track, unsigned int k) const
+{
+	const unsigned short* p = &mPosKeys[3 * k];
+	return mPosMin[track] + vec3(REAL(p[0]), REAL(p[1]), REAL(p[2])).cwiseProduct(mPosScale[track]);
+}
+
+void CompressedClip::sample(REAL frame, unsigned int bone, mat3& R, vec3& t) const
+{
+	frame = std::max(REAL(0), std::min(frame, REAL(mNumFrames - 1)));
+
+	unsigned int first = mRotOffsets[bone];
+	unsigned int last = mRotOffsets[bone + 1];
+	unsigned int k = findKey(mRotTimes, first, last, frame);
+	if(k + 1 < last)
+	{
+		REAL u = (frame - mRotTimes[k]) / REAL(mRotTimes[k + 1] - mRotTimes[k]);
+		R = nlerp(getRotationKey(k), getRotationKey(k + 1), u).toRotationMatrix();
+	}
+	else
+	{
+		R = getRotationKey(k).toRotationMatrix();
+	}
+
+	first = mPosOffsets[bone];
+	last = mPosOffsets[bone + 1];
+	k = findKey(mPosTimes, first, last, frame);
+	if(k + 1 < last)
+	{
+		REAL u = (frame - mPosTimes[k]) / REAL(mPosTimes[k + 1] - mPosTimes[k]);
+		t = (REAL(1) - u) * getTranslationKey(bone, k) + u * getTranslationKey(bone, k + 1);
+	}
+	else
+	{
+		t = getTranslationKey(bone, k);
+	}
+}
+
+void CompressedClip::samplePose(REAL frame, mat3* R, vec3* t) const
+{
+	for(unsigned int b = 0; b < mNumBones; ++b)
+	{
+		sample(frame, b, R[b], t[b]);
+	}
+}
+
+void CompressedClip::decompress(AnimationClip& out) const
+{
+	out.resize(mNumFrames, mNumBones);
+	out.setFrameRate(mFrameRate);
+	for(unsigned int f = 0; f < mNumFrames; ++f)
+	{
+		for(unsigned int b = 0; b < mNumBones; ++b)
+		{
+			sample(REAL(f), b, out.rotation(f, b), out.offset(f, b));
+		}
+	}
+}
+
+unsigned int CompressedClip::getNumFrames() const
+{
+	return mNumFrames;
+}
+
+unsigned int CompressedClip::getNumBones() const
+{
+	return mNumBones;
+}
+
+unsigned int CompressedClip::getNumKeys() const
+{
+	return mRotTimes.size() + mPosTimes.size();
+}
+
+unsigned int CompressedClip::getCompressedSize() const
+{
+	return (mRotOffsets.size() + mPosOffsets.size()) * sizeof(unsigned int)
+		+ (mRotTimes.size() + mPosTimes.size()) * sizeof(unsigned short)
+		+ mRotKeys.size() * sizeof(short)
+		+ mPosKeys.size() * sizeof(unsigned short)
+		+ (mPosMin.size() + mPosScale.size()) * sizeof(vec3);
+}
+
+unsigned int CompressedClip::getUncompressedSize() const
+{
+	return mNumFrames * mNumBones * (sizeof(mat3) + sizeof(vec3));
+}
+
+unsigned int CompressedClip::getNumExceeded() const
+{
+	return mNumExceeded;
+}
+
+REAL CompressedClip::getCompressionRatio() const
+{
+	unsigned int c = getCompressedSize();
+	return (c > 0) ? REAL(getUncompressedSize()) / REAL(c) : REAL(0);
+}
@@ -0,0 +1,97 @@
+#ifndef __CLIPCOMPRESSION_H__
+#define __CLIPCOMPRESSION_H__
+
+#include "platform.h"
+
+class Skeleton;
+class AnimationClip;
+
+/*! CompressedClip
+ *
+ *  \brief  keyframe reduced and quantized version of an AnimationClip. Each
+ *          bone has a rotation and a translation track, keys are removed as
+ *          long as the piecewise linear (nlerp/lerp) curve through the
+ *          remaining keys keeps the bone end position within the tolerance,
+ *          i.e. translation error + rotation angle * bone length. Rotations
+ *          are stored as 4 x 16 bit, translations as 3 x 16 bit in the range
+ *          of their track, key times as 16 bit frame numbers, so a clip may
+ *          have at most 65535 frames (compress longer takes in blocks).
+ *          A tolerance below the quantization step cannot hold at every
+ *          sample, getNumExceeded() counts the samples where it fails.
+ *          Sampling at arbitrary times is a binary search per track.
+ */
+class CompressedClip
+{
+public:
+
+	//! constructor
+	CompressedClip();
+
+	//! compresses clip, skel provides the bone lengths, tolerance in mm with unitsPerMM scene units per mm
+	bool compress(const AnimationClip& clip, const Skeleton& skel, REAL toleranceMM, REAL unitsPerMM = REAL(0.001));
+
+	//! samples one bone at a (fractional) frame
+	void sample(REAL frame, unsigned int bone, mat3& R, vec3& t) const;
+
+	//! samples all bones at a (fractional) frame, R and t have getNumBones() entries
+	void samplePose(REAL frame, mat3* R, vec3* t) const;
+
+	//! expands into a dense clip
+	void decompress(AnimationClip& out) const;
+
+	//! get number of frames
+	unsigned int getNumFrames() const;
+
+	//! get number of bones
+	unsigned int getNumBones() const;
+
+	//! number of rotation and translation keys left
+	unsigned int getNumKeys() const;
+
+	//! bytes used by the compressed tracks
+	unsigned int getCompressedSize() const;
+
+	//! bytes used by the dense source clip
+	unsigned int getUncompressedSize() const;
+
+	//! uncompressed / compressed size
+	REAL getCompressionRatio() const;
+
+	//! number of track samples the 16 bit quantization alone puts over the tolerance, the bound fails there
+	unsigned int getNumExceeded() const;
+
+protected:
+
+	//! index of the last key at or before frame in [first, last)
+	unsigned int findKey(const std::vector<unsigned short>& times, unsigned int first, unsigned int last, REAL frame) const;
+
+	//! dequantized rotation key
+	quat getRotationKey(unsigned int k) const;
+
+	//! dequantized translation key of a track
+	vec3 getTranslationKey(unsigned int track, unsigned int k) const;
+
+	unsigned int mNumFrames;
+
+	unsigned int mNumBones;
+
+	unsigned int mNumExceeded;
+
+	REAL mFrameRate;
+
+	//! rotation keys of bone b are [mRotOffsets[b], mRotOffsets[b+1])
+	std::vector<unsigned int> mRotOffsets;
+	std::vector<unsigned short> mRotTimes;
+	std::vector<short> mRotKeys;
+
+	//! translation keys of bone b are [mPosOffsets[b], mPosOffsets[b+1])
+	std::vector<unsigned int> mPosOffsets;
+	std::vector<unsigned short> mPosTimes;
+	std::vector<unsigned short> mPosKeys;
+
+	//! quantization range per translation track
+	std::vector<vec3> mPosMin;
+	std::vector<vec3> mPosScale;
+};
+
+#endif //__CLIPCOMPRESSION_H__
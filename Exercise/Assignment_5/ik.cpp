@@ -0,0 +1,666 @@
+#include "ik.h"
+
+// collects bone and all its descendants, parents before children
+static void collectSubtreeBones(const Skeleton& skel, int bone, std::vector<int>& out)
+{
+	unsigned int sp = out.size();
+	out.push_back(bone);
+
+	Bone cur;
+	while(sp < out.size())
+	{
+		skel.getBone(out[sp], cur);
+
+		for(unsigned int j = 0; j < cur.children.size(); ++j)
+		{
+			out.push_back(cur.children[j]);
+		}
+
+		sp++;
+	}
+}
+
+// collects the end joints of bone and all its descendants
+static void collectSubtreeJoints(const Skeleton& skel, int bone, std::vector<int>& out)
+{
+	std::vector<int> bones(0);
+	collectSubtreeBones(skel, bone, bones);
+
+	Bone cur;
+	for(unsigned int i = 0; i < bones.size(); ++i)
+	{
+		skel.getBone(bones[i], cur);
+		out.push_back(cur.j1);
+	}
+}
+
+CCDSolver::CCDSolver()
+	: mEffector(-1),
+	  mMaxIterations(16),
+	  mTolerance(REAL(0.001)),
+	  mNumIterations(0),
+	  mError(0)
+{
+}
+
+bool CCDSolver::init(const Skeleton& skel, unsigned int rootBone, unsigned int endBone)
+{
+	mEffector = -1;
+	if(!skel.getBoneChain(rootBone, endBone, mChainBones))
+	{
+		PRINTERROR("CCDSolver::init error: bone " << endBone << " is not below bone " << rootBone);
+		return false;
+	}
+
+	mPivots.resize(mChainBones.size());
+	mEnds.resize(mChainBones.size());
+	mLengths.resize(mChainBones.size());
+	mSubtreeOffsets.resize(mChainBones.size() + 1);
+	mSubtreeJoints.clear();
+
+	Bone b;
+	for(unsigned int k = 0; k < mChainBones.size(); ++k)
+	{
+		skel.getBone(mChainBones[k], b);
+		if(b.j0 < 0 || b.j1 < 0)
+		{
+			PRINTERROR("CCDSolver::init error: invalid bone " << mChainBones[k]);
+			return false;
+		}
+		mPivots[k] = b.j0;
+		mEnds[k] = b.j1;
+		mLengths[k] = b.length;
+
+		mSubtreeOffsets[k] = mSubtreeJoints.size();
+		collectSubtreeJoints(skel, mChainBones[k], mSubtreeJoints);
+	}
+	mSubtreeOffsets[mChainBones.size()] = mSubtreeJoints.size();
+
+	mPositions.resize(skel.getNumJoints());
+	mEffector = mEnds.back();
+
+	return true;
+}
+
+bool CCDSolver::solve(Skeleton& skel, const vec3& target)
+{
+	mNumIterations = 0;
+	if(mEffector < 0 || mPositions.size() != skel.getNumJoints())
+	{
+		PRINTERROR("CCDSolver::solve error: solver not initialized for this skeleton");
+		return false;
+	}
+
+	for(unsigned int j = 0; j < mPositions.size(); ++j)
+	{
+		skel.getJoint(j, mPositions[j]);
+	}
+
+	mError = (mPositions[mEffector] - target).norm();
+
+	while(mError > mTolerance && mNumIterations < mMaxIterations)
+	{
+		// sweep from the end of the chain to its root
+		for(int k = (int)mChainBones.size() - 1; k >= 0; --k)
+		{
+			const vec3 pivot = mPositions[mPivots[k]];
+			vec3 toEnd = mPositions[mEffector] - pivot;
+			vec3 toTarget = target - pivot;
+
+			if(ZERO(toEnd.squaredNorm()) || ZERO(toTarget.squaredNorm()))
+				continue;
+
+			mat3 R = quat::FromTwoVectors(toEnd, toTarget).toRotationMatrix();
+
+			for(unsigned int s = mSubtreeOffsets[k]; s < mSubtreeOffsets[k + 1]; ++s)
+			{
+				vec3& p = mPositions[mSubtreeJoints[s]];
+				p = pivot + R * (p - pivot);
+			}
+		}
+
+		mNumIterations++;
+		mError = (mPositions[mEffector] - target).norm();
+	}
+
+	restoreLengths();
+	mError = (mPositions[mEffector] - target).norm();
+
+	// write back everything below the chain root
+	for(unsigned int s = mSubtreeOffsets[0]; s < mSubtreeJoints.size(); ++s)
+	{
+		skel.setJoint(mSubtreeJoints[s], mPositions[mSubtreeJoints[s]]);
+	}
+
+	skel.updateBonesByJoints();
+
+	return mError <= mTolerance;
+}
+
+void CCDSolver::restoreLengths()
+{
+	// rotations keep the lengths, this removes the accumulated float drift
+	for(unsigned int k = 0; k < mChainBones.size(); ++k)
+	{
+		vec3 d = mPositions[mEnds[k]] - mPositions[mPivots[k]];
+		REAL len = d.norm();
+		if(ZERO(len))
+			continue;
+
+		vec3 delta = d * (mLengths[k] / len - REAL(1));
+		for(unsigned int s = mSubtreeOffsets[k]; s < mSubtreeOffsets[k + 1]; ++s)
+		{
+			mPositions[mSubtreeJoints[s]] += delta;
+		}
+	}
+}
+
+void CCDSolver::setMaxIterations(unsigned int n)
+{
+	mMaxIterations = n;
+}
+
+void CCDSolver::setTolerance(REAL tol)
+{
+	mTolerance = tol;
+}
+
+unsigned int CCDSolver::getNumIterations() const
+{
+	return mNumIterations;
+}
+
+REAL CCDSolver::getError() const
+{
+	return mError;
+}
+
+FABRIKSolver::FABRIKSolver()
+	: mNumJoints(0),
+	  mMaxIterations(16),
+	  mTolerance(REAL(0.001)),
+	  mNumIterations(0),
+	  mError(0)
+{
+}
+
+bool FABRIKSolver::init(const Skeleton& skel, unsigned int baseJoint, const std::vector<int>& effectorJoints)
+{
+	mNumJoints = 0;
+	mNodeJoints.clear();
+	mNodeParents.clear();
+	mNodeLengths.clear();
+	mNodeNumChildren.clear();
+	mNodeTargets.clear();
+	mEffectorNodes.clear();
+	mFreeJoints.clear();
+	mFreeAnchors.clear();
+
+	const unsigned int numJoints = skel.getNumJoints();
+	if(baseJoint >= numJoints || effectorJoints.empty())
+	{
+		PRINTERROR("FABRIKSolver::init error: invalid base joint or no effectors");
+		return false;
+	}
+
+	// undirected joint graph, the bones are the edges
+	std::vector< std::vector<int> > adjacent(numJoints);
+	std::vector< std::vector<REAL> > adjacentLength(numJoints);
+	Bone b;
+	for(unsigned int i = 0; i < skel.getNumBones(); ++i)
+	{
+		skel.getBone(i, b);
+		if(b.j0 < 0 || b.j1 < 0)
+			continue;
+		adjacent[b.j0].push_back(b.j1);
+		adjacentLength[b.j0].push_back(b.length);
+		adjacent[b.j1].push_back(b.j0);
+		adjacentLength[b.j1].push_back(b.length);
+	}
+
+	// breadth first from the base
+	std::vector<int> order(0);
+	std::vector<int> parent(numJoints, -1);
+	std::vector<REAL> length(numJoints, REAL(0));
+	std::vector<bool> visited(numJoints, false);
+	order.push_back(baseJoint);
+	visited[baseJoint] = true;
+	int sp = 0;
+	while((unsigned int)sp < order.size())
+	{
+		int cur = order[sp];
+		for(unsigned int j = 0; j < adjacent[cur].size(); ++j)
+		{
+			int next = adjacent[cur][j];
+			if(visited[next])
+				continue;
+			visited[next] = true;
+			parent[next] = cur;
+			length[next] = adjacentLength[cur][j];
+			order.push_back(next);
+		}
+		sp++;
+	}
+
+	// mark the paths from the effectors to the base
+	std::vector<bool> inTree(numJoints, false);
+	inTree[baseJoint] = true;
+	for(unsigned int e = 0; e < effectorJoints.size(); ++e)
+	{
+		int cur = effectorJoints[e];
+		if(cur < 0 || (unsigned int)cur >= numJoints || !visited[cur])
+		{
+			PRINTERROR("FABRIKSolver::init error: effector " << cur << " not connected to base " << baseJoint);
+			return false;
+		}
+		while(cur > -1 && !inTree[cur])
+		{
+			inTree[cur] = true;
+			cur = parent[cur];
+		}
+	}
+
+	// compact tree nodes in breadth first order
+	std::vector<int> nodeOfJoint(numJoints, -1);
+	for(unsigned int k = 0; k < order.size(); ++k)
+	{
+		int j = order[k];
+		if(!inTree[j])
+			continue;
+		nodeOfJoint[j] = mNodeJoints.size();
+		mNodeJoints.push_back(j);
+		mNodeParents.push_back(parent[j] > -1 ? nodeOfJoint[parent[j]] : -1);
+		mNodeLengths.push_back(length[j]);
+	}
+
+	mNodeNumChildren.assign(mNodeJoints.size(), 0);
+	for(unsigned int n = 1; n < mNodeJoints.size(); ++n)
+	{
+		mNodeNumChildren[mNodeParents[n]]++;
+	}
+
+	mNodeTargets.assign(mNodeJoints.size(), -1);
+	for(unsigned int e = 0; e < effectorJoints.size(); ++e)
+	{
+		int n = nodeOfJoint[effectorJoints[e]];
+		mEffectorNodes.push_back(n);
+		mNodeTargets[n] = e;
+	}
+
+	// everything else hangs rigidly on the closest tree node above it
+	for(unsigned int k = 0; k < order.size(); ++k)
+	{
+		int j = order[k];
+		if(inTree[j])
+			continue;
+		int anchor = parent[j];
+		while(!inTree[anchor])
+			anchor = parent[anchor];
+		mFreeJoints.push_back(j);
+		mFreeAnchors.push_back(nodeOfJoint[anchor]);
+	}
+
+	mNodePos.resize(mNodeJoints.size());
+	mNodeStart.resize(mNodeJoints.size());
+	mNodeAccum.resize(mNodeJoints.size());
+	mNumJoints = numJoints;
+
+	return true;
+}
+
+bool FABRIKSolver::solve(Skeleton& skel, const std::vector<vec3>& targets)
+{
+	mNumIterations = 0;
+	if(mNodeJoints.empty() || mNumJoints != skel.getNumJoints() || targets.size() != mEffectorNodes.size())
+	{
+		PRINTERROR("FABRIKSolver::solve error: solver not initialized for this skeleton/targets");
+		return false;
+	}
+
+	for(unsigned int n = 0; n < mNodeJoints.size(); ++n)
+	{
+		skel.getJoint(mNodeJoints[n], mNodeStart[n]);
+		mNodePos[n] = mNodeStart[n];
+	}
+
+	const unsigned int numNodes = mNodeJoints.size();
+	mError = computeError(targets);
+
+	while(mError > mTolerance && mNumIterations < mMaxIterations)
+	{
+		// backward: from the effectors towards the base, children come after parents
+		for(unsigned int n = 0; n < numNodes; ++n)
+			mNodeAccum[n].setZero();
+
+		for(int n = numNodes - 1; n > 0; --n)
+		{
+			if(mNodeTargets[n] > -1)
+				mNodePos[n] = targets[mNodeTargets[n]];
+			else if(mNodeNumChildren[n] > 0)
+				mNodePos[n] = mNodeAccum[n] / REAL(mNodeNumChildren[n]);
+
+			int p = mNodeParents[n];
+			vec3 d = mNodePos[p] - mNodePos[n];
+			REAL len = d.norm();
+			if(ZERO(len))
+				mNodeAccum[p] += mNodePos[p];
+			else
+				mNodeAccum[p] += mNodePos[n] + d * (mNodeLengths[n] / len);
+		}
+
+		// forward: base is fixed, walk down and restore the lengths
+		mNodePos[0] = mNodeStart[0];
+		for(unsigned int n = 1; n < numNodes; ++n)
+		{
+			const vec3& pp = mNodePos[mNodeParents[n]];
+			vec3 d = mNodePos[n] - pp;
+			REAL len = d.norm();
+			if(!ZERO(len))
+				mNodePos[n] = pp + d * (mNodeLengths[n] / len);
+		}
+
+		mNumIterations++;
+		mError = computeError(targets);
+	}
+
+	// write back tree and drag the free joints along
+	vec3 p;
+	for(unsigned int f = 0; f < mFreeJoints.size(); ++f)
+	{
+		int a = mFreeAnchors[f];
+		skel.getJoint(mFreeJoints[f], p);
+		skel.setJoint(mFreeJoints[f], p + mNodePos[a] - mNodeStart[a]);
+	}
+
+	for(unsigned int n = 0; n < numNodes; ++n)
+	{
+		skel.setJoint(mNodeJoints[n], mNodePos[n]);
+	}
+
+	skel.updateBonesByJoints();
+
+	return mError <= mTolerance;
+}
+
+REAL FABRIKSolver::computeError(const std::vector<vec3>& targets) const
+{
+	REAL err = 0;
+	for(unsigned int e = 0; e < mEffectorNodes.size(); ++e)
+	{
+		err = std::max(err, (mNodePos[mEffectorNodes[e]] - targets[e]).norm());
+	}
+	return err;
+}
+
+void FABRIKSolver::setMaxIterations(unsigned int n)
+{
+	mMaxIterations = n;
+}
+
+void FABRIKSolver::setTolerance(REAL tol)
+{
+	mTolerance = tol;
+}
+
+unsigned int FABRIKSolver::getNumIterations() const
+{
+	return mNumIterations;
+}
+
+REAL FABRIKSolver::getError() const
+{
+	return mError;
+}
+
+DLSSolver::DLSSolver()
+	: mLambda(REAL(0.1)),
+	  mOrientationWeight(REAL(0.1)),
+	  mMaxIterations(32),
+	  mTolerance(REAL(0.001)),
+	  mNumIterations(0),
+	  mError(0),
+	  mRotationError(0)
+{
+	mRestEndR.setIdentity();
+}
+
+bool DLSSolver::init(const Skeleton& skel, unsigned int rootBone, unsigned int endBone)
+{
+	if(!skel.getBoneChain(rootBone, endBone, mChainBones))
+	{
+		PRINTERROR("DLSSolver::init error: bone " << endBone << " is not below bone " << rootBone);
+		return false;
+	}
+
+	const unsigned int n = mChainBones.size();
+	mRestPivots.resize(n + 1);
+
+	Bone b;
+	for(unsigned int k = 0; k < n; ++k)
+	{
+		skel.getBone(mChainBones[k], b);
+		if(b.j0 < 0 || b.j1 < 0)
+		{
+			PRINTERROR("DLSSolver::init error: invalid bone " << mChainBones[k]);
+			mChainBones.clear();
+			return false;
+		}
+		skel.getJoint(b.j0, mRestPivots[k]);
+		if(k == n - 1)
+			skel.getJoint(b.j1, mRestPivots[n]);
+	}
+	vec3 t;
+	skel.getBoneBasis(endBone, mRestEndR, t);
+
+	// every bone below the chain root follows the deepest chain joint above it
+	mBones.clear();
+	collectSubtreeBones(skel, mChainBones[0], mBones);
+	std::vector<int> anchorOfBone(skel.getNumBones(), -1);
+	std::vector<int> subtree(0);
+	for(unsigned int k = 0; k < n; ++k)
+	{
+		subtree.clear();
+		collectSubtreeBones(skel, mChainBones[k], subtree);
+		for(unsigned int i = 0; i < subtree.size(); ++i)
+			anchorOfBone[subtree[i]] = k;
+	}
+
+	mRestBones.resize(mBones.size());
+	mBoneAnchors.resize(mBones.size());
+	mJoints.resize(mBones.size());
+	mRestJoints.resize(mBones.size());
+	mJointAnchors.resize(mBones.size());
+	for(unsigned int i = 0; i < mBones.size(); ++i)
+	{
+		skel.getBone(mBones[i], b);
+		skel.getBoneBasis(mBones[i], mRestBones[i], t);
+		mBoneAnchors[i] = anchorOfBone[mBones[i]];
+		mJoints[i] = b.j1;
+		skel.getJoint(b.j1, mRestJoints[i]);
+		mJointAnchors[i] = anchorOfBone[mBones[i]];
+	}
+
+	mRotations.resize(n);
+	mWorld.resize(n);
+	mPivots.resize(n + 1);
+	mWeights.assign(n, REAL(1));
+	mLimits.assign(n, REAL(M_PI));
+	mJ.resize(6, 3 * n);
+	mJ.setZero();
+	mDelta.resize(3 * n);
+	reset();
+
+	return true;
+}
+
+void DLSSolver::reset()
+{
+	for(unsigned int k = 0; k < mRotations.size(); ++k)
+		mRotations[k].setIdentity();
+}
+
+bool DLSSolver::solve(Skeleton& skel, const vec3& targetPos)
+{
+	return solve(skel, targetPos, NULL);
+}
+
+bool DLSSolver::solve(Skeleton& skel, const vec3& targetPos, const mat3& targetR)
+{
+	return solve(skel, targetPos, &targetR);
+}
+
+bool DLSSolver::solve(Skeleton& skel, const vec3& targetPos, const mat3* targetR)
+{
+	mNumIterations = 0;
+	if(mChainBones.empty())
+	{
+		PRINTERROR("DLSSolver::solve error: solver not initialized");
+		return false;
+	}
+
+	const unsigned int n = mChainBones.size();
+	Bone b;
+	skel.getBone(mChainBones[0], b);
+	skel.getJoint(b.j0, mPivots[0]);
+
+	vec6 e;
+	vec6 y;
+	mRotationError = 0;
+
+	// without a target orientation the rows of the end rotation stay zero, so
+	// rows left by an oriented solve do not hold the end orientation in place
+	if(!targetR)
+		mJ.bottomRows<3>().setZero();
+
+	while(true)
+	{
+		forwardKinematics();
+
+		// task space error
+		e.head<3>() = targetPos - mPivots[n];
+		mError = e.head<3>().norm();
+		e.tail<3>().setZero();
+		if(targetR)
+		{
+			anax aa(*targetR * (mWorld[n - 1] * mRestEndR).transpose());
+			mRotationError = std::abs(aa.angle());
+			e.tail<3>() = mOrientationWeight * aa.angle() * aa.axis();
+		}
+
+		if((mError <= mTolerance && mRotationError <= mTolerance) || mNumIterations >= mMaxIterations)
+			break;
+
+		// jacobian of the world axis dofs, A = lambda^2 I + sum_k w_k J_k J_k^T
+		mA = mLambda * mLambda * mat6::Identity();
+		for(unsigned int k = 0; k < n; ++k)
+		{
+			vec3 d = mPivots[n] - mPivots[k];
+			for(unsigned int a = 0; a < 3; ++a)
+			{
+				mJ.block<3, 1>(0, 3 * k + a) = vec3::Unit(a).cross(d);
+				if(targetR)
+					mJ.block<3, 1>(3, 3 * k + a) = mOrientationWeight * vec3::Unit(a);
+			}
+			mA.noalias() += mWeights[k] * mJ.block<6, 3>(0, 3 * k) * mJ.block<6, 3>(0, 3 * k).transpose();
+		}
+
+		mLDLT.compute(mA);
+		y = mLDLT.solve(e);
+
+		// apply the world space rotation of each joint and clamp to its limit
+		for(unsigned int k = 0; k < n; ++k)
+		{
+			mDelta.segment<3>(3 * k).noalias() = mWeights[k] * mJ.block<6, 3>(0, 3 * k).transpose() * y;
+			vec3 w = mDelta.segment<3>(3 * k);
+			REAL angle = w.norm();
+			if(ZERO(angle))
+				continue;
+
+			quat r(anax(angle, w / angle));
+			if(k > 0)
+			{
+				quat parentW(mWorld[k - 1]);
+				r = parentW.conjugate() * r * parentW;
+			}
+			mRotations[k] = (r * mRotations[k]).normalized();
+
+			REAL total = REAL(2) * std::acos(std::min(REAL(1), std::abs(mRotations[k].w())));
+			if(total > mLimits[k])
+				mRotations[k] = quat::Identity().slerp(mLimits[k] / total, mRotations[k]);
+		}
+
+		mNumIterations++;
+	}
+
+	// write back joints then bases of everything below the chain root
+	for(unsigned int i = 0; i < mJoints.size(); ++i)
+	{
+		int a = mJointAnchors[i];
+		skel.setJoint(mJoints[i], mPivots[a] + mWorld[a] * (mRestJoints[i] - mRestPivots[a]));
+	}
+
+	for(unsigned int i = 0; i < mBones.size(); ++i)
+	{
+		skel.setBoneBasis(mBones[i], mWorld[mBoneAnchors[i]] * mRestBones[i]);
+	}
+
+	return mError <= mTolerance && mRotationError <= mTolerance;
+}
+
+void DLSSolver::forwardKinematics()
+{
+	mat3 W = mat3::Identity();
+	for(unsigned int k = 0; k < mRotations.size(); ++k)
+	{
+		W = W * mRotations[k].toRotationMatrix();
+		mWorld[k] = W;
+		mPivots[k + 1] = mPivots[k] + W * (mRestPivots[k + 1] - mRestPivots[k]);
+	}
+}
+
+void DLSSolver::setJointWeight(unsigned int k, REAL w)
+{
+	if(k < mWeights.size())
+		mWeights[k] = std::max(REAL(0), w);
+}
+
+void DLSSolver::setJointLimit(unsigned int k, REAL maxAngle)
+{
+	if(k < mLimits.size())
+		mLimits[k] = std::max(REAL(0), maxAngle);
+}
+
+void DLSSolver::setDamping(REAL lambda)
+{
+	mLambda = lambda;
+}
+
+void DLSSolver::setOrientationWeight(REAL w)
+{
+	mOrientationWeight = w;
+}
+
+void DLSSolver::setMaxIterations(unsigned int n)
+{
+	mMaxIterations = n;
+}
+
+void DLSSolver::setTolerance(REAL tol)
+{
+	mTolerance = tol;
+}
+
+unsigned int DLSSolver::getNumIterations() const
+{
+	return mNumIterations;
+}
+
+REAL DLSSolver::getError() const
+{
+	return mError;
+}
+
+REAL DLSSolver::getRotationError() const
+{
+	return mRotationError;
+}
@@ -0,0 +1,290 @@
+#ifndef __IK_H__
+#define __IK_H__
+
+#include "platform.h"
+#include "skeleton.h"
+
+/*! CCDSolver
+ *
+ *  \brief  cyclic coordinate descent on a single bone chain, e.g. from the
+ *          right shoulder (bone 2) to the right hand (bone 15) of a
+ *          MakeHSkeleton. All scratch memory is allocated in init(), solve()
+ *          itself does not allocate and can run per character per frame.
+ */
+class CCDSolver
+{
+public:
+
+	//! constructor
+	CCDSolver();
+
+	//! prepares the chain rootBone -> endBone of skel, endBone has to be a descendant
+	bool init(const Skeleton& skel, unsigned int rootBone, unsigned int endBone);
+
+	//! pulls the end joint of the chain to target and updates the bones, true if the tolerance is reached
+	bool solve(Skeleton& skel, const vec3& target);
+
+	//! maximum number of sweeps over the chain
+	void setMaxIterations(unsigned int n);
+
+	//! distance of end joint to target where the solver terminates
+	void setTolerance(REAL tol);
+
+	//! number of sweeps used by the last solve
+	unsigned int getNumIterations() const;
+
+	//! remaining distance of end joint to target after the last solve
+	REAL getError() const;
+
+protected:
+
+	//! re-applies the bone lengths along the chain, drags the subtrees along
+	void restoreLengths();
+
+	//! chain bone ids from root to end
+	std::vector<int> mChainBones;
+
+	//! start joint of each chain bone
+	std::vector<int> mPivots;
+
+	//! end joint of each chain bone
+	std::vector<int> mEnds;
+
+	//! the bone lengths cached on init
+	std::vector<REAL> mLengths;
+
+	//! joints moved by a rotation of chain bone k: [mSubtreeOffsets[k], mSubtreeOffsets[k+1])
+	std::vector<unsigned int> mSubtreeOffsets;
+
+	//! flat list of the joint ids below each chain bone
+	std::vector<int> mSubtreeJoints;
+
+	//! scratch copy of the skeleton joints
+	std::vector<vec3> mPositions;
+
+	//! the chain end effector joint
+	int mEffector;
+
+	unsigned int mMaxIterations;
+
+	REAL mTolerance;
+
+	unsigned int mNumIterations;
+
+	REAL mError;
+};
+
+/*! FABRIKSolver
+ *
+ *  \brief  forward and backward reaching ik for several end effectors at once,
+ *          working on the joint positions with the cached bone lengths. The
+ *          joints on the paths from the fixed base joint to the effectors
+ *          form a tree, joints where paths split (e.g. the torso joint shared
+ *          by both abdomen bones) are sub-bases and get the centroid of the
+ *          positions proposed by their branches. After solving, the bone
+ *          bases are rebuilt by the skeleton's updateBonesByJoints().
+ */
+class FABRIKSolver
+{
+public:
+
+	//! constructor
+	FABRIKSolver();
+
+	//! prepares the tree from baseJoint to all effectorJoints, baseJoint stays fixed
+	bool init(const Skeleton& skel, unsigned int baseJoint, const std::vector<int>& effectorJoints);
+
+	//! one target per effector in the order given to init, true if all are within tolerance
+	bool solve(Skeleton& skel, const std::vector<vec3>& targets);
+
+	//! maximum number of backward/forward passes
+	void setMaxIterations(unsigned int n);
+
+	//! maximum effector distance to its target where the solver terminates
+	void setTolerance(REAL tol);
+
+	//! number of passes used by the last solve
+	unsigned int getNumIterations() const;
+
+	//! largest effector distance to its target after the last solve
+	REAL getError() const;
+
+protected:
+
+	//! largest effector to target distance of the current positions
+	REAL computeError(const std::vector<vec3>& targets) const;
+
+	//! skeleton joint of each tree node, nodes are in breadth first order, node 0 is the base
+	std::vector<int> mNodeJoints;
+
+	//! parent node of each tree node (-1 for the base)
+	std::vector<int> mNodeParents;
+
+	//! bone length between a node and its parent
+	std::vector<REAL> mNodeLengths;
+
+	//! number of children of a node inside the tree
+	std::vector<unsigned int> mNodeNumChildren;
+
+	//! effector index driving a node or -1
+	std::vector<int> mNodeTargets;
+
+	//! node of each effector
+	std::vector<int> mEffectorNodes;
+
+	//! joints outside the tree, moved rigidly with their anchor node
+	std::vector<int> mFreeJoints;
+
+	//! nearest tree node above each free joint
+	std::vector<int> mFreeAnchors;
+
+	//! scratch: current node positions
+	std::vector<vec3> mNodePos;
+
+	//! scratch: node positions at the start of solve
+	std::vector<vec3> mNodeStart;
+
+	//! scratch: sum of the positions proposed by the children
+	std::vector<vec3> mNodeAccum;
+
+	unsigned int mNumJoints;
+
+	unsigned int mMaxIterations;
+
+	REAL mTolerance;
+
+	unsigned int mNumIterations;
+
+	REAL mError;
+};
+
+/*! DLSSolver
+ *
+ *  \brief  damped least squares (Levenberg-Marquardt) ik for a bone chain
+ *          with position and orientation targets. Every chain joint is a ball
+ *          joint with three world axis dofs, a weight and a maximal deviation
+ *          angle from the rest pose captured on init. The solver keeps the
+ *          joint rotations between calls, so per frame solves warm start.
+ *          The 6x3n jacobian is preallocated and the 6x6 system
+ *          J*W*J^T + lambda^2*I is solved by a fixed size LDLT, so the
+ *          iteration loop does not touch the heap.
+ */
+class DLSSolver
+{
+public:
+
+	//! needed for eigen
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	typedef Eigen::Matrix<REAL, 6, 1> vec6;
+	typedef Eigen::Matrix<REAL, 6, 6> mat6;
+	typedef Eigen::Matrix<REAL, 6, Eigen::Dynamic> mat6X;
+
+	//! constructor
+	DLSSolver();
+
+	//! prepares the chain rootBone -> endBone, the current pose becomes the rest pose
+	bool init(const Skeleton& skel, unsigned int rootBone, unsigned int endBone);
+
+	//! resets all joint rotations to the rest pose
+	void reset();
+
+	//! moves the chain end joint to targetPos, true if the tolerance is reached
+	bool solve(Skeleton& skel, const vec3& targetPos);
+
+	//! additionally aligns the end bone basis to targetR
+	bool solve(Skeleton& skel, const vec3& targetPos, const mat3& targetR);
+
+	//! relative mobility of chain joint k (0 locks the joint)
+	void setJointWeight(unsigned int k, REAL w);
+
+	//! maximal rotation angle of chain joint k away from the rest pose
+	void setJointLimit(unsigned int k, REAL maxAngle);
+
+	//! damping factor lambda
+	void setDamping(REAL lambda);
+
+	//! weight of the orientation error relative to the position error
+	void setOrientationWeight(REAL w);
+
+	//! maximum number of iterations
+	void setMaxIterations(unsigned int n);
+
+	//! position (and orientation in radians) tolerance
+	void setTolerance(REAL tol);
+
+	//! number of iterations used by the last solve
+	unsigned int getNumIterations() const;
+
+	//! remaining position error after the last solve
+	REAL getError() const;
+
+	//! remaining rotation error in radians after the last solve, 0 without a target orientation
+	REAL getRotationError() const;
+
+protected:
+
+	//! the shared solver loop, targetR may be NULL
+	bool solve(Skeleton& skel, const vec3& targetPos, const mat3* targetR);
+
+	//! evaluates world rotations, pivots and the end effector from the joint rotations
+	void forwardKinematics();
+
+	//! chain bone ids from root to end
+	std::vector<int> mChainBones;
+
+	//! rest position of each chain bones start joint, plus the end joint
+	std::vector<vec3> mRestPivots;
+
+	//! rest basis of the end bone
+	mat3 mRestEndR;
+
+	//! local rotation of each chain joint relative to the rest pose
+	std::vector<quat, Eigen::aligned_allocator<quat> > mRotations;
+
+	//! scratch: accumulated world rotations of the chain joints
+	std::vector<mat3> mWorld;
+
+	//! scratch: current pivot positions, plus the end joint
+	std::vector<vec3> mPivots;
+
+	std::vector<REAL> mWeights;
+
+	std::vector<REAL> mLimits;
+
+	//! all joints below the chain root, their rest positions and anchoring chain joint
+	std::vector<int> mJoints;
+	std::vector<vec3> mRestJoints;
+	std::vector<int> mJointAnchors;
+
+	//! all bones below the chain root, their rest bases and anchoring chain joint
+	std::vector<int> mBones;
+	std::vector<mat3> mRestBones;
+	std::vector<int> mBoneAnchors;
+
+	//! preallocated jacobian
+	mat6X mJ;
+
+	//! preallocated joint update
+	vecX mDelta;
+
+	mat6 mA;
+
+	Eigen::LDLT<mat6> mLDLT;
+
+	REAL mLambda;
+
+	REAL mOrientationWeight;
+
+	unsigned int mMaxIterations;
+
+	REAL mTolerance;
+
+	unsigned int mNumIterations;
+
+	REAL mError;
+
+	REAL mRotationError;
+};
+
+#endif //__IK_H__
@@ -8,6 +8,13 @@
 #include "camera.h"
 #include "light.h"
 #include "skeleton.h"
+#include "ik.h"
+#include "rig.h"
+#include "animationclip.h"
+#include "bvhimporter.h"
+#include "clipcompression.h"
+#include "retarget.h"
+#include <chrono>
 
 #define WIDTH 1024
 #define HEIGHT 768
@@ -123,8 +130,15 @@ void loadMeshAndRig()
 	computeTriangleMeshNormals(mesh->verticesInLoadPose, mesh->triangles, mesh->normalsInLoadPose);
 	renderer->addRenderable("mesh", mesh->verticesInLoadPose, mesh->triangles, "meshMaterial", mat4::Identity());
 
-	// init skeleton
-	mesh->skeleton.fitToMakeHMesh(mesh->verticesInLoadPose);
+	// init skeleton from the binary rig file, then the text one, fall back to the built in make human rig
+	RigDefinition rig;
+	bool loaded = false;
+	if (std::ifstream("../Media/avatar.rigb").good())
+		loaded = rig.loadBinary("../Media/avatar.rigb");
+	if (!loaded)
+		loaded = rig.loadFromFile("../Media/avatar.rig");
+	if (!loaded || !rig.fitToMesh(mesh->verticesInLoadPose, mesh->skeleton))
+		mesh->skeleton.fitToMakeHMesh(mesh->verticesInLoadPose);
 
 	// load attachment file
 	std::ifstream attFile("../Media/avatarAtt.txt");
@@ -140,6 +154,224 @@ void loadMeshAndRig()
 	glutPostRedisplay();
 }
 
+// solves some ik tasks on a copy of the rig and reports the throughput
+void benchmarkIK()
+{
+	if (mesh == NULL)
+		return;
+
+	// the rig is reset outside the timed region, only the solves are timed
+	const unsigned int numSolves = 10000;
+	std::chrono::high_resolution_clock::time_point t0;
+	double ms;
+
+	// ccd: right hand reaches forward
+	MakeHSkeleton skel = mesh->skeleton;
+	CCDSolver ccd;
+	ccd.init(skel, 2, 15);
+	vec3 hand;
+	skel.getJoint(16, hand);
+	vec3 handTarget = hand + vec3(REAL(0.1), REAL(0.3), REAL(0.2));
+
+	ms = 0;
+	for (unsigned int i = 0; i < numSolves; ++i)
+	{
+		skel = mesh->skeleton;
+		t0 = std::chrono::high_resolution_clock::now();
+		ccd.solve(skel, handTarget);
+		ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+	}
+	LOG("CCD: " << numSolves / ms << " solves/ms (" << ccd.getNumIterations() << " iterations, error " << ccd.getError() << ")");
+
+	// damped least squares: same reach, hand kept in its rest orientation
+	DLSSolver dls;
+	dls.init(mesh->skeleton, 2, 15);
+	mat3 handR;
+	mesh->skeleton.getBoneBasis(15, handR, hand);
+
+	ms = 0;
+	for (unsigned int i = 0; i < numSolves; ++i)
+	{
+		skel = mesh->skeleton;
+		dls.reset();
+		t0 = std::chrono::high_resolution_clock::now();
+		dls.solve(skel, handTarget, handR);
+		ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+	}
+	LOG("DLS: " << numSolves / ms << " solves/ms (" << dls.getNumIterations() << " iterations, error " << dls.getError() << ")");
+
+	// fabrik: both feet planted from the neck, torso is a sub-base
+	FABRIKSolver fabrik;
+	std::vector<int> effectors(0);
+	effectors.push_back(13);
+	effectors.push_back(14);
+	fabrik.init(skel, 1, effectors);
+	std::vector<vec3> footTargets(2);
+	mesh->skeleton.getJoint(13, footTargets[0]);
+	mesh->skeleton.getJoint(14, footTargets[1]);
+	footTargets[0] += vec3(REAL(0.05), REAL(0.1), REAL(0.1));
+	footTargets[1] += vec3(REAL(-0.05), REAL(0.15), REAL(0));
+
+	ms = 0;
+	for (unsigned int i = 0; i < numSolves; ++i)
+	{
+		skel = mesh->skeleton;
+		t0 = std::chrono::high_resolution_clock::now();
+		fabrik.solve(skel, footTargets);
+		ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+	}
+	LOG("FABRIK: " << numSolves / ms << " solves/ms (" << fabrik.getNumIterations() << " iterations, error " << fabrik.getError() << ")");
+}
+
+// compresses a procedural clip on the avatar rig and reports ratio, error and sampling cost
+void benchmarkCompression()
+{
+	if (mesh == NULL)
+		return;
+
+	const unsigned int numFrames = 2000;
+	const unsigned int numBones = mesh->skeleton.getNumBones();
+	AnimationClip clip;
+	clip.resize(numFrames, numBones);
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		MakeHSkeleton skel = mesh->skeleton;
+		REAL t = REAL(f) / REAL(60);
+		skel.setBoneRotationsAngles(6, vec3(REAL(0.6) * std::sin(t), REAL(0.3) * std::cos(REAL(0.7) * t), REAL(0.2)));
+		skel.setBoneRotationsAngles(8, vec3(REAL(0.4) * std::sin(REAL(1.3) * t), REAL(0.1), REAL(0)));
+		clip.setFrameFromSkeleton(f, skel);
+	}
+
+	CompressedClip compressed;
+	compressed.compress(clip, mesh->skeleton, REAL(1));
+
+	// largest bone end deviation over all frames
+	std::vector<REAL> lengths;
+	mesh->skeleton.getBoneLengths(lengths);
+	REAL maxError = 0;
+	mat3 R;
+	vec3 t;
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		for (unsigned int b = 0; b < numBones; ++b)
+		{
+			compressed.sample(REAL(f), b, R, t);
+			vec3 ref = clip.offset(f, b) + clip.rotation(f, b).col(1) * lengths[b];
+			maxError = std::max(maxError, (t + R.col(1) * lengths[b] - ref).norm());
+		}
+	}
+
+	// random access sampling of whole poses
+	const unsigned int numSamples = 100000;
+	std::vector<mat3> poseR(numBones);
+	std::vector<vec3> poseT(numBones);
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < numSamples; ++i)
+	{
+		compressed.samplePose(REAL((i * 7919) % ((numFrames - 1) * 10)) / REAL(10), &poseR[0], &poseT[0]);
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+	LOG("compression: " << compressed.getNumKeys() << " keys, ratio " << compressed.getCompressionRatio()
+		<< ", max error " << maxError * REAL(1000) << " mm, " << ms * 1e6 / (numSamples * numBones) << " ns per bone sample");
+	if (compressed.getNumExceeded() > 0)
+		LOG("the quantization alone exceeds the tolerance at " << compressed.getNumExceeded() << " track samples");
+}
+
+// retargets a long procedural clip of the avatar rig onto the rig with longer bones, once
+// frame by frame with Skeleton::fitToTargetSkeleton and once with the batched retargeter
+void benchmarkRetarget()
+{
+	if (mesh == NULL)
+		return;
+
+	const unsigned int numFrames = 10000;
+	const unsigned int numBones = mesh->skeleton.getNumBones();
+	AnimationClip clip;
+	clip.resize(numFrames, numBones);
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		MakeHSkeleton skel = mesh->skeleton;
+		REAL t = REAL(f) / REAL(60);
+		for (unsigned int b = 2; b < numBones; b += 4)
+			skel.setBoneRotationsAngles(b, vec3(REAL(0.5) * std::sin(t + b), REAL(0.3) * std::cos(REAL(0.7) * t), REAL(0.1)));
+		clip.setFrameFromSkeleton(f, skel);
+	}
+
+	MakeHSkeleton target = mesh->skeleton;
+	std::vector<REAL> lengths;
+	target.getBoneLengths(lengths);
+	for (unsigned int b = 0; b < numBones; ++b)
+		lengths[b] *= REAL(1.2);
+	target.fitToBoneLengths(lengths);
+
+	// per frame: pose the source rig and fit the target to it
+	AnimationClip reference;
+	reference.resize(numFrames, numBones);
+	MakeHSkeleton source = mesh->skeleton;
+	MakeHSkeleton fitted = target;
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+	for (unsigned int f = 0; f < numFrames; ++f)
+	{
+		clip.applyFrame(f, source);
+		fitted.fitToTargetSkeleton(source);
+		reference.setFrameFromSkeleton(f, fitted);
+	}
+	std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+	Retargeter retargeter;
+	AnimationClip out;
+	if (!retargeter.init(target) || !retargeter.retarget(clip, out))
+		return;
+	std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
+
+	// a few frames spread over the clip must match within the tolerance
+	const REAL tolerance = REAL(1e-4);
+	unsigned int numChecked = 0, numDiffering = 0;
+	REAL maxError = 0;
+	for (unsigned int f = 0; f < numFrames; f += numFrames / 10)
+	{
+		REAL error = 0;
+		for (unsigned int b = 0; b < numBones; ++b)
+		{
+			error = std::max(error, (out.rotation(f, b) - reference.rotation(f, b)).cwiseAbs().maxCoeff());
+			error = std::max(error, (out.offset(f, b) - reference.offset(f, b)).cwiseAbs().maxCoeff());
+		}
+		maxError = std::max(maxError, error);
+		numDiffering += error > tolerance;
+		++numChecked;
+	}
+
+	double perFrame = std::chrono::duration<double, std::milli>(t1 - t0).count() / numFrames;
+	double batched = std::chrono::duration<double, std::milli>(t2 - t1).count() / numFrames;
+	LOG("retarget " << numFrames << " frames of " << numBones << " bones: per frame fit " << perFrame << " ms, batched " << batched << " ms per frame");
+	LOG("  " << numDiffering << " of " << numChecked << " checked frames differ by more than " << tolerance << ", max difference " << maxError);
+}
+
+// streams a motion capture take in chunks and reports the parse throughput
+void streamBVH(const std::string& filename)
+{
+	BVHImporter importer;
+	if (!importer.open(filename))
+		return;
+
+	Skeleton bvhSkeleton;
+	importer.createSkeleton(bvhSkeleton);
+
+	AnimationClip chunk;
+	unsigned int numFrames = 0;
+	unsigned int numRead = 0;
+	std::chrono::high_resolution_clock::time_point t0 = std::chrono::high_resolution_clock::now();
+	while ((numRead = importer.readFrames(1024, chunk)) > 0)
+	{
+		numFrames += numRead;
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - t0).count();
+
+	LOG("BVH: " << importer.getNumJoints() << " joints, " << numFrames << " frames in " << ms << " ms ("
+		<< REAL(numFrames) / (ms * 0.001) << " frames/s)");
+}
+
 void shutdown(void)
 {
 	SAFE_DELETE(camera);
@@ -247,6 +479,26 @@ void key(unsigned char key, int x, int y)
     
     // TODO: set some bone rotations by key press
 
+	case 'b': // benchmark the ik solvers
+		benchmarkIK();
+		break;
+
+	case 'c': // benchmark clip compression
+		benchmarkCompression();
+		break;
+
+	case 'm': // benchmark clip retargeting
+		benchmarkRetarget();
+		break;
+
+	case 'w': // write the text rig as binary rig
+		{
+			RigDefinition rig;
+			if (rig.loadFromFile("../Media/avatar.rig") && rig.saveBinary("../Media/avatar.rigb"))
+				LOG("wrote ../Media/avatar.rigb");
+		}
+		break;
+
 	default:
 		break;
 	}
@@ -274,6 +526,10 @@ int main(int argc, char** argv)
 
 	init();
 	loadMeshAndRig();
+
+	// optional motion capture take given on the command line
+	if (argc > 1)
+		streamBVH(argv[1]);
 	
 	glutMainLoop();
 	
@@ -0,0 +1,123 @@
+#include "retarget.h"
+#include "skeleton.h"
+#include "animationclip.h"
+
+Retargeter::Retargeter()
+	: mNumSourceBones(0)
+{
+}
+
+bool Retargeter::init(const Skeleton& target, const std::vector<int>& boneMap)
+{
+	const unsigned int numBones = target.getNumBones();
+	mOrder.clear();
+	mParents.resize(numBones);
+	mSourceBones.resize(numBones);
+	mLengths.resize(numBones);
+	mRestOffsets.resize(numBones);
+	mNumSourceBones = 0;
+
+	if(!boneMap.empty() && boneMap.size() != numBones)
+	{
+		PRINTERROR("Retargeter::init error: bone map does not match the target");
+		return false;
+	}
+
+	// cache everything per bone, roots start the traversal
+	Bone b;
+	mat3 R;
+	for(unsigned int i = 0; i < numBones; ++i)
+	{
+		target.getBone(i, b);
+		mParents[i] = b.parent;
+		mLengths[i] = b.length;
+		target.getBoneBasis(i, R, mRestOffsets[i]);
+		mSourceBones[i] = boneMap.empty() ? (int)i : boneMap[i];
+		if(mSourceBones[i] < 0)
+		{
+			PRINTERROR("Retargeter::init error: no source bone for target bone " << i);
+			return false;
+		}
+		mNumSourceBones = std::max(mNumSourceBones, (unsigned int)mSourceBones[i] + 1);
+
+		if(b.parent < 0)
+			mOrder.push_back(i);
+	}
+
+	if(mOrder.empty())
+	{
+		LOG("no root bone found");
+		return false;
+	}
+
+	// level order, parents before children
+	int sp = 0;
+	while((unsigned int)sp < mOrder.size())
+	{
+		target.getBone(mOrder[sp], b);
+		for(unsigned int j = 0; j < b.children.size(); ++j)
+		{
+			mOrder.push_back(b.children[j]);
+		}
+		sp++;
+	}
+
+	return true;
+}
+
+bool Retargeter::retarget(const AnimationClip& source, AnimationClip& out) const
+{
+	out.resize(source.getNumFrames(), mParents.size());
+	out.setFrameRate(source.getFrameRate());
+	return retarget(source, 0, source.getNumFrames(), out, 0);
+}
+
+bool Retargeter::retarget(const AnimationClip& source,
+							unsigned int first,
+							unsigned int count,
+							AnimationClip& out,
+							unsigned int outFirst) const
+{
+	if(mOrder.empty() || source.getNumBones() < mNumSourceBones)
+	{
+		PRINTERROR("Retargeter::retarget error: not initialized or source clip does not match");
+		return false;
+	}
+
+	if(first + count > source.getNumFrames() || outFirst + count > out.getNumFrames() || out.getNumBones() != mParents.size())
+	{
+		PRINTERROR("Retargeter::retarget error: frame range out of bounds");
+		return false;
+	}
+
+	const int numFrames = count;
+	const unsigned int numOrder = mOrder.size();
+
+	#pragma omp parallel for schedule(static)
+	for(int f = 0; f < numFrames; ++f)
+	{
+		const unsigned int sf = first + f;
+		const unsigned int of = outFirst + f;
+
+		for(unsigned int k = 0; k < numOrder; ++k)
+		{
+			const int l = mOrder[k];
+			const int p = mParents[l];
+			const mat3& R = source.rotation(sf, mSourceBones[l]);
+			out.rotation(of, l) = R;
+
+			// offset is the fathers end position
+			if(p > -1)
+				out.offset(of, l) = out.offset(of, p) + out.rotation(of, p).col(1) * mLengths[p];
+			else
+				out.offset(of, l) = mRestOffsets[l];
+		}
+	}
+
+	return true;
+}
+
+unsigned int Retargeter::getNumBones() const
+{
+	return mParents.size();
+}
@@ -0,0 +1,62 @@
+#ifndef __RETARGET_H__
+#define __RETARGET_H__
+
+#include "platform.h"
+
+class Skeleton;
+class AnimationClip;
+
+/*! Retargeter
+ *
+ *  \brief  batched version of Skeleton::fitToTargetSkeleton: every target
+ *          bone takes the basis of its mapped source bone, its offset is the
+ *          end of its parent bone, so the target keeps its bone lengths.
+ *          Traversal order, parents, lengths and the bone mapping are
+ *          computed once in init(), the frames of a clip are then
+ *          independent and retargeted in parallel.
+ */
+class Retargeter
+{
+public:
+
+	//! constructor
+	Retargeter();
+
+	//! target bone i takes the basis of source bone boneMap[i], an empty map is the identity
+	bool init(const Skeleton& target, const std::vector<int>& boneMap = std::vector<int>());
+
+	//! retargets the whole source clip into out (resized to the target rig)
+	bool retarget(const AnimationClip& source, AnimationClip& out) const;
+
+	//! retargets count source frames starting at first into out starting at outFirst
+	bool retarget(const AnimationClip& source,
+					unsigned int first,
+					unsigned int count,
+					AnimationClip& out,
+					unsigned int outFirst) const;
+
+	//! number of bones of the target rig
+	unsigned int getNumBones() const;
+
+protected:
+
+	//! target bones, parents first
+	std::vector<int> mOrder;
+
+	//! parent bone of each target bone
+	std::vector<int> mParents;
+
+	//! source bone feeding each target bone
+	std::vector<int> mSourceBones;
+
+	//! target bone lengths
+	std::vector<REAL> mLengths;
+
+	//! target rest offsets, used for the root bones
+	std::vector<vec3> mRestOffsets;
+
+	//! smallest source bone count the mapping needs
+	unsigned int mNumSourceBones;
+};
+
+#endif //__RETARGET_H__
@@ -0,0 +1,452 @@
+#include "rig.h"
+#include "skeleton.h"
+
+// bones are processed in blocks of this size, small enough for the stack
+#define RIG_BLOCK 8
+
+RigDefinition::RigDefinition()
+	: mNumVertices(0)
+{
+}
+
+void RigDefinition::clear()
+{
+	mNumVertices = 0;
+	mJointNames.clear();
+	mBoneNames.clear();
+	mJointVertices.clear();
+	mBoneJoints.clear();
+	mBoneParents.clear();
+	mBasisVertices.clear();
+}
+
+bool RigDefinition::loadFromFile(const std::string& filename)
+{
+	clear();
+
+	std::ifstream inF(filename.c_str());
+	if(!inF.good())
+	{
+		PRINTERROR("RigDefinition::loadFromFile error: file " << filename.c_str() << " not found");
+		return false;
+	}
+
+	std::string line;
+	unsigned int lineNr = 0;
+	while(std::getline(inF, line))
+	{
+		lineNr++;
+		std::istringstream iss(line);
+		std::string key, name;
+		if(!(iss >> key) || key[0] == '#')
+			continue;
+
+		if(key == "vertices")
+		{
+			if(!(iss >> mNumVertices))
+			{
+				PRINTERROR("RigDefinition::loadFromFile error: invalid vertex count in line " << lineNr);
+				return false;
+			}
+		}
+		else if(key == "joint")
+		{
+			INDEX a, b;
+			if(!(iss >> name >> a >> b))
+			{
+				PRINTERROR("RigDefinition::loadFromFile error: invalid joint in line " << lineNr);
+				return false;
+			}
+			mJointNames.push_back(name);
+			mJointVertices.push_back(a);
+			mJointVertices.push_back(b);
+		}
+		else if(key == "bone")
+		{
+			INDEX j0, j1, a, b;
+			int parent;
+			if(!(iss >> name >> j0 >> j1 >> parent >> a >> b))
+			{
+				PRINTERROR("RigDefinition::loadFromFile error: invalid bone in line " << lineNr);
+				return false;
+			}
+			if(parent < -1 || parent >= (int)mBoneNames.size())
+			{
+				PRINTERROR("RigDefinition::loadFromFile error: parent has to be -1 or defined before bone in line " << lineNr);
+				return false;
+			}
+			mBoneNames.push_back(name);
+			mBoneJoints.push_back(j0);
+			mBoneJoints.push_back(j1);
+			mBoneParents.push_back(parent);
+			mBasisVertices.push_back(a);
+			mBasisVertices.push_back(b);
+		}
+		else
+		{
+			PRINTERROR("RigDefinition::loadFromFile error: unknown key " << key << " in line " << lineNr);
+			return false;
+		}
+	}
+
+	return validate();
+}
+
+bool RigDefinition::loadBinary(const std::string& filename)
+{
+	clear();
+
+	std::ifstream inF(filename.c_str(), std::ios::binary | std::ios::ate);
+	if(!inF.good())
+	{
+		PRINTERROR("RigDefinition::loadBinary error: file " << filename.c_str() << " not found");
+		return false;
+	}
+	const unsigned long long size = inF.tellg();
+	inF.seekg(0);
+
+	RigFileHeader header;
+	if(!inF.read((char*)&header, sizeof(header)) || header.magic != RIG_MAGIC || header.version != RIG_VERSION)
+	{
+		PRINTERROR("RigDefinition::loadBinary error: " << filename.c_str() << " is no rig file of version " << RIG_VERSION);
+		return false;
+	}
+
+	// the counts come from the file, check them against its size before anything is allocated.
+	// In 64 bits the products of 32 bit counts and the record sizes cannot wrap around
+	const unsigned long long jointSize = RIG_NAME_LENGTH + 2 * sizeof(INDEX);
+	const unsigned long long boneSize = RIG_NAME_LENGTH + 4 * sizeof(INDEX) + sizeof(int);
+	const unsigned long long expected = sizeof(header) + header.numJoints * jointSize + header.numBones * boneSize;
+	if(size < expected)
+	{
+		PRINTERROR("RigDefinition::loadBinary error: " << filename.c_str() << " is truncated");
+		return false;
+	}
+
+	char name[RIG_NAME_LENGTH];
+	mNumVertices = header.numVertices;
+	mJointVertices.resize(2 * header.numJoints);
+	for(unsigned int j = 0; j < header.numJoints && inF.read(name, RIG_NAME_LENGTH); ++j)
+	{
+		name[RIG_NAME_LENGTH - 1] = 0;
+		mJointNames.push_back(name);
+	}
+	if(header.numJoints > 0)
+		inF.read((char*)&mJointVertices[0], mJointVertices.size() * sizeof(INDEX));
+
+	mBoneJoints.resize(2 * header.numBones);
+	mBoneParents.resize(header.numBones);
+	mBasisVertices.resize(2 * header.numBones);
+	for(unsigned int b = 0; b < header.numBones && inF.read(name, RIG_NAME_LENGTH); ++b)
+	{
+		name[RIG_NAME_LENGTH - 1] = 0;
+		mBoneNames.push_back(name);
+	}
+	if(header.numBones > 0)
+	{
+		inF.read((char*)&mBoneJoints[0], mBoneJoints.size() * sizeof(INDEX));
+		inF.read((char*)&mBoneParents[0], mBoneParents.size() * sizeof(int));
+		inF.read((char*)&mBasisVertices[0], mBasisVertices.size() * sizeof(INDEX));
+	}
+
+	if(!inF || mJointNames.size() != header.numJoints || mBoneNames.size() != header.numBones)
+	{
+		PRINTERROR("RigDefinition::loadBinary error: " << filename.c_str() << " is truncated");
+		clear();
+		return false;
+	}
+
+	if(!validate())
+	{
+		clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool RigDefinition::saveBinary(const std::string& filename) const
+{
+	std::ofstream outF(filename.c_str(), std::ios::binary);
+	if(!outF.good())
+	{
+		PRINTERROR("RigDefinition::saveBinary error: could not open " << filename.c_str());
+		return false;
+	}
+
+	RigFileHeader header;
+	header.magic = RIG_MAGIC;
+	header.version = RIG_VERSION;
+	header.numVertices = mNumVertices;
+	header.numJoints = mJointNames.size();
+	header.numBones = mBoneNames.size();
+	outF.write((const char*)&header, sizeof(header));
+
+	char name[RIG_NAME_LENGTH];
+	for(unsigned int j = 0; j < mJointNames.size(); ++j)
+	{
+		if(mJointNames[j].size() >= RIG_NAME_LENGTH)
+		{
+			PRINTERROR("RigDefinition::saveBinary error: joint name " << mJointNames[j] << " is too long");
+			return false;
+		}
+		std::fill(name, name + RIG_NAME_LENGTH, 0);
+		mJointNames[j].copy(name, RIG_NAME_LENGTH - 1);
+		outF.write(name, RIG_NAME_LENGTH);
+	}
+	if(!mJointVertices.empty())
+		outF.write((const char*)&mJointVertices[0], mJointVertices.size() * sizeof(INDEX));
+
+	for(unsigned int b = 0; b < mBoneNames.size(); ++b)
+	{
+		if(mBoneNames[b].size() >= RIG_NAME_LENGTH)
+		{
+			PRINTERROR("RigDefinition::saveBinary error: bone name " << mBoneNames[b] << " is too long");
+			return false;
+		}
+		std::fill(name, name + RIG_NAME_LENGTH, 0);
+		mBoneNames[b].copy(name, RIG_NAME_LENGTH - 1);
+		outF.write(name, RIG_NAME_LENGTH);
+	}
+	if(!mBoneNames.empty())
+	{
+		outF.write((const char*)&mBoneJoints[0], mBoneJoints.size() * sizeof(INDEX));
+		outF.write((const char*)&mBoneParents[0], mBoneParents.size() * sizeof(int));
+		outF.write((const char*)&mBasisVertices[0], mBasisVertices.size() * sizeof(INDEX));
+	}
+
+	if(!outF.good())
+	{
+		PRINTERROR("RigDefinition::saveBinary error: could not write " << filename.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool RigDefinition::validate() const
+{
+	for(unsigned int i = 0; i < mBoneParents.size(); ++i)
+	{
+		if(mBoneParents[i] < -1 || mBoneParents[i] >= (int)i)
+		{
+			PRINTERROR("RigDefinition::validate error: bone " << mBoneNames[i] << " has an invalid parent");
+			return false;
+		}
+	}
+
+	for(unsigned int i = 0; i < mBoneJoints.size(); ++i)
+	{
+		if(mBoneJoints[i] >= mJointNames.size())
+		{
+			PRINTERROR("RigDefinition::validate error: bone " << mBoneNames[i / 2] << " uses unknown joint");
+			return false;
+		}
+	}
+
+	for(unsigned int i = 0; i < mJointVertices.size(); ++i)
+	{
+		if(mJointVertices[i] >= mNumVertices)
+		{
+			PRINTERROR("RigDefinition::validate error: joint " << mJointNames[i / 2] << " vertex out of range");
+			return false;
+		}
+	}
+
+	for(unsigned int i = 0; i < mBasisVertices.size(); ++i)
+	{
+		if(mBasisVertices[i] >= mNumVertices)
+		{
+			PRINTERROR("RigDefinition::validate error: bone " << mBoneNames[i / 2] << " vertex out of range");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+unsigned int RigDefinition::getNumVertices() const
+{
+	return mNumVertices;
+}
+
+unsigned int RigDefinition::getNumJoints() const
+{
+	return mJointNames.size();
+}
+
+unsigned int RigDefinition::getNumBones() const
+{
+	return mBoneNames.size();
+}
+
+int RigDefinition::findJoint(const std::string& name) const
+{
+	for(unsigned int i = 0; i < mJointNames.size(); ++i)
+	{
+		if(mJointNames[i] == name)
+			return i;
+	}
+	return -1;
+}
+
+int RigDefinition::findBone(const std::string& name) const
+{
+	for(unsigned int i = 0; i < mBoneNames.size(); ++i)
+	{
+		if(mBoneNames[i] == name)
+			return i;
+	}
+	return -1;
+}
+
+void RigDefinition::createSkeleton(Skeleton& skel) const
+{
+	skel.clear();
+
+	vec3 zero(0, 0, 0);
+	for(unsigned int i = 0; i < mJointNames.size(); ++i)
+	{
+		skel.addJoint(zero);
+	}
+
+	for(unsigned int i = 0; i < mBoneNames.size(); ++i)
+	{
+		skel.addBone(mBoneJoints[2 * i], mBoneJoints[2 * i + 1], mBoneParents[i]);
+	}
+}
+
+bool RigDefinition::fitToMesh(const std::vector<vec3>& _V, Skeleton& skel) const
+{
+	if(_V.size() != mNumVertices)
+	{
+		PRINTERROR("RigDefinition::fitToMesh error: mesh has " << _V.size() << " vertices, rig expects " << mNumVertices);
+		return false;
+	}
+
+	if(skel.getNumJoints() != getNumJoints() || skel.getNumBones() != getNumBones())
+	{
+		createSkeleton(skel);
+	}
+
+	std::vector<vec3> joints(getNumJoints());
+	std::vector<mat3> bases(getNumBones());
+	computeJoints(&_V[0], &joints[0]);
+	computeBases(&_V[0], &joints[0], &bases[0]);
+
+	for(unsigned int i = 0; i < joints.size(); ++i)
+	{
+		skel.setJoint(i, joints[i]);
+	}
+
+	skel.updateOffsetsAndLengths();
+
+	for(unsigned int i = 0; i < bases.size(); ++i)
+	{
+		skel.setBoneBasis(i, bases[i]);
+	}
+
+	return true;
+}
+
+void RigDefinition::computeJoints(const vec3* _V, vec3* joints) const
+{
+	const unsigned int numJoints = mJointNames.size();
+	for(unsigned int i = 0; i < numJoints; ++i)
+	{
+		joints[i] = REAL(0.5) * (_V[mJointVertices[2 * i]] + _V[mJointVertices[2 * i + 1]]);
+	}
+}
+
+void RigDefinition::computeBases(const vec3* _V, const vec3* joints, mat3* R) const
+{
+	const unsigned int numBones = mBoneNames.size();
+
+	// structure of arrays per block, the math loop has no gathers and vectorizes
+	REAL ux[RIG_BLOCK], uy[RIG_BLOCK], uz[RIG_BLOCK];
+	REAL fx[RIG_BLOCK], fy[RIG_BLOCK], fz[RIG_BLOCK];
+	REAL sx[RIG_BLOCK], sy[RIG_BLOCK], sz[RIG_BLOCK];
+
+	for(unsigned int first = 0; first < numBones; first += RIG_BLOCK)
+	{
+		const unsigned int count = std::min((unsigned int)RIG_BLOCK, numBones - first);
+
+		// gather up (bone direction) and front reference
+		for(unsigned int k = 0; k < RIG_BLOCK; ++k)
+		{
+			if(k < count)
+			{
+				const unsigned int i = first + k;
+				vec3 u = joints[mBoneJoints[2 * i + 1]] - joints[mBoneJoints[2 * i]];
+				vec3 f = _V[mBasisVertices[2 * i]] - _V[mBasisVertices[2 * i + 1]];
+				ux[k] = u.x(); uy[k] = u.y(); uz[k] = u.z();
+				fx[k] = f.x(); fy[k] = f.y(); fz[k] = f.z();
+			}
+			else
+			{
+				ux[k] = 0; uy[k] = 1; uz[k] = 0;
+				fx[k] = 1; fy[k] = 0; fz[k] = 0;
+			}
+		}
+
+		// up = |u|, front = |f|, side = |up x front|, front = |up x side|
+		for(unsigned int k = 0; k < RIG_BLOCK; ++k)
+		{
+			REAL inv = REAL(1) / std::sqrt(ux[k] * ux[k] + uy[k] * uy[k] + uz[k] * uz[k]);
+			ux[k] *= inv; uy[k] *= inv; uz[k] *= inv;
+
+			inv = REAL(1) / std::sqrt(fx[k] * fx[k] + fy[k] * fy[k] + fz[k] * fz[k]);
+			fx[k] *= inv; fy[k] *= inv; fz[k] *= inv;
+
+			sx[k] = uy[k] * fz[k] - uz[k] * fy[k];
+			sy[k] = uz[k] * fx[k] - ux[k] * fz[k];
+			sz[k] = ux[k] * fy[k] - uy[k] * fx[k];
+			inv = REAL(1) / std::sqrt(sx[k] * sx[k] + sy[k] * sy[k] + sz[k] * sz[k]);
+			sx[k] *= inv; sy[k] *= inv; sz[k] *= inv;
+
+			fx[k] = uy[k] * sz[k] - uz[k] * sy[k];
+			fy[k] = uz[k] * sx[k] - ux[k] * sz[k];
+			fz[k] = ux[k] * sy[k] - uy[k] * sx[k];
+			inv = REAL(1) / std::sqrt(fx[k] * fx[k] + fy[k] * fy[k] + fz[k] * fz[k]);
+			fx[k] *= inv; fy[k] *= inv; fz[k] *= inv;
+		}
+
+		// scatter to front, up, side columns
+		for(unsigned int k = 0; k < count; ++k)
+		{
+			mat3& B = R[first + k];
+			B << fx[k], ux[k], sx[k],
+				 fy[k], uy[k], sy[k],
+				 fz[k], uz[k], sz[k];
+		}
+	}
+}
+
+bool RigDefinition::fitToMeshes(const std::vector< std::vector<vec3> >& meshes,
+									std::vector<vec3>& joints,
+									std::vector<mat3>& bases) const
+{
+	const unsigned int numJoints = getNumJoints();
+	const unsigned int numBones = getNumBones();
+	joints.resize(meshes.size() * numJoints);
+	bases.resize(meshes.size() * numBones);
+
+	for(unsigned int m = 0; m < meshes.size(); ++m)
+	{
+		if(meshes[m].size() != mNumVertices)
+		{
+			PRINTERROR("RigDefinition::fitToMeshes error: mesh " << m << " does not match the rig topology");
+			return false;
+		}
+	}
+
+	const int numMeshes = meshes.size();
+	#pragma omp parallel for schedule(static)
+	for(int m = 0; m < numMeshes; ++m)
+	{
+		computeJoints(&meshes[m][0], &joints[m * numJoints]);
+		computeBases(&meshes[m][0], &joints[m * numJoints], &bases[m * numBones]);
+	}
+
+	return true;
+}
@@ -0,0 +1,109 @@
+#ifndef __RIG_H__
+#define __RIG_H__
+
+#include "platform.h"
+
+#define RIG_MAGIC 0x20474952 // "RIG "
+#define RIG_VERSION 1
+#define RIG_NAME_LENGTH 32
+
+//! header of the binary rig files
+struct RigFileHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int numVertices;
+	unsigned int numJoints;
+	unsigned int numBones;
+};
+
+class Skeleton;
+
+/*! RigDefinition
+ *
+ *  \brief  data driven rig, loaded from a text file (see Media/avatar.rig)
+ *          and compiled into flat index tables: two landmark vertices per
+ *          joint, start/end joint and parent per bone and two vertices per
+ *          bone spanning its front axis. All bone bases are then built by one
+ *          generic loop, the hand written MakeHSkeleton code is one instance
+ *          of such a rig. The binary format is the header ("RIG ", version,
+ *          number of vertices, joints and bones), the joint names and
+ *          vertices, then the bone names, joints, parents and front vertices.
+ *          Names are stored in RIG_NAME_LENGTH bytes, zero terminated.
+ */
+class RigDefinition
+{
+public:
+
+	//! constructor
+	RigDefinition();
+
+	//! parses a rig file, false on syntax errors or invalid indices
+	bool loadFromFile(const std::string& filename);
+
+	//! reads a binary rig file, false if it is broken or has invalid indices
+	bool loadBinary(const std::string& filename);
+
+	//! writes the rig as binary file
+	bool saveBinary(const std::string& filename) const;
+
+	//! number of mesh vertices the rig expects
+	unsigned int getNumVertices() const;
+
+	//! get number of joints
+	unsigned int getNumJoints() const;
+
+	//! get number of bones
+	unsigned int getNumBones() const;
+
+	//! index of a named joint or -1
+	int findJoint(const std::string& name) const;
+
+	//! index of a named bone or -1
+	int findBone(const std::string& name) const;
+
+	//! replaces joints and bones of skel by the rig's topology
+	void createSkeleton(Skeleton& skel) const;
+
+	//! places the joints and builds all bases of skel from the mesh vertices
+	bool fitToMesh(const std::vector<vec3>& _V, Skeleton& skel) const;
+
+	//! joint positions from the mesh, joints has getNumJoints() entries
+	void computeJoints(const vec3* _V, vec3* joints) const;
+
+	//! bone bases from the mesh and joints, R has getNumBones() entries
+	void computeBases(const vec3* _V, const vec3* joints, mat3* R) const;
+
+	//! fits many meshes at once, joints and bases are stored mesh after mesh
+	bool fitToMeshes(const std::vector< std::vector<vec3> >& meshes,
+						std::vector<vec3>& joints,
+						std::vector<mat3>& bases) const;
+
+protected:
+
+	//! removes the rig
+	void clear();
+
+	//! checks the parents and indices of the tables, fitting does no checks
+	bool validate() const;
+
+	unsigned int mNumVertices;
+
+	std::vector<std::string> mJointNames;
+
+	std::vector<std::string> mBoneNames;
+
+	//! two landmark vertices per joint
+	std::vector<INDEX> mJointVertices;
+
+	//! start and end joint per bone
+	std::vector<INDEX> mBoneJoints;
+
+	//! parent per bone
+	std::vector<int> mBoneParents;
+
+	//! two vertices per bone, front = V[a] - V[b]
+	std::vector<INDEX> mBasisVertices;
+};
+
+#endif //__RIG_H__
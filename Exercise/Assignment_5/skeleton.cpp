@@ -52,6 +52,12 @@ Skeleton::~Skeleton()
     mBones.clear();
 }
 
+void Skeleton::clear()
+{
+    mJoints.clear();
+    mBones.clear();
+}
+
 unsigned int Skeleton::getNumJoints() const
 {
     return mJoints.size();
@@ -120,6 +126,79 @@ bool Skeleton::getBone(unsigned int idx, Bone& out) const
 	return false;
 }
 
+bool Skeleton::getBoneBasis(const unsigned int& idx, mat3& R, vec3& t) const
+{
+	if(idx >= mBones.size())
+	{
+		return false;
+	}
+
+	R = mBones[idx].R;
+	t = mBones[idx].t;
+
+	return true;
+}
+
+bool Skeleton::setBoneBasis(const unsigned int& idx, const mat3& R)
+{
+	if(idx >= mBones.size())
+	{
+		PRINTERROR("Skeleton::setBoneBasis error: out of bounds");
+		return false;
+	}
+
+	mBones[idx].R = R;
+	if(mBones[idx].j0 > -1)
+		mBones[idx].t = mJoints[mBones[idx].j0];
+
+	return true;
+}
+
+bool Skeleton::setBoneTransform(const unsigned int& idx, const mat3& R, const vec3& t)
+{
+	if(idx >= mBones.size())
+	{
+		PRINTERROR("Skeleton::setBoneTransform error: out of bounds");
+		return false;
+	}
+
+	Bone& b = mBones[idx];
+	b.R = R;
+	b.t = t;
+	if(b.j0 > -1)
+		mJoints[b.j0] = t;
+	if(b.j1 > -1)
+		mJoints[b.j1] = t + R.col(1) * b.length;
+
+	return true;
+}
+
+bool Skeleton::getBoneChain(unsigned int rootBone, unsigned int endBone, std::vector<int>& out) const
+{
+	out.clear();
+	if(rootBone >= mBones.size() || endBone >= mBones.size())
+	{
+		PRINTERROR("Skeleton::getBoneChain error: out of bounds");
+		return false;
+	}
+
+	// walk up the parent links until the root bone is hit
+	int cur = endBone;
+	while(cur > -1)
+	{
+		out.push_back(cur);
+		if((unsigned int)cur == rootBone)
+		{
+			std::reverse(out.begin(), out.end());
+			return true;
+		}
+		cur = mBones[cur].parent;
+	}
+
+	out.clear();
+	return false;
+}
+
 void Skeleton::getBoneLengths(std::vector<REAL> &out) const
 {
 	out.clear();
@@ -164,6 +243,18 @@ bool Skeleton::setBoneRotationsAngles(const unsigned int& idx, const vec3& angle
 	return true;
 }
 
+void Skeleton::updateOffsetsAndLengths()
+{
+	for(unsigned int i = 0; i < mBones.size(); ++i)
+	{
+		if(mBones[i].j0 == -1 || mBones[i].j1 == -1)
+			continue;
+
+		mBones[i].t = mJoints[mBones[i].j0];
+		mBones[i].length = (mJoints[mBones[i].j1] - mJoints[mBones[i].j0]).norm();
+	}
+}
+
 void Skeleton::updateBonesByJoints()
 {
     for(unsigned int i = 0; i < mBones.size(); ++i)
@@ -259,9 +350,8 @@ void Skeleton::fitToTargetSkeleton(const Skeleton &target)
         Bone& _tB = mBones[l];
 
         // transform rotation from other bone
-        Bone _oB;
-        target.getBone(l, _oB);
-        _tB.R = _oB.R;
+        vec3 _oT;
+        target.getBoneBasis(l, _tB.R, _oT);
 
         // offset is the fathers end position
         if(_tB.parent > -1 && (unsigned int)_tB.parent < mBones.size())
@@ -423,11 +513,7 @@ void MakeHSkeleton::fitToMakeHMesh(const std::vector<vec3>& _V)
 void MakeHSkeleton::updateBonesByJoints()
 {
 	// set offset and calc lengths
-	for(unsigned int i = 0; i < mBones.size(); ++i)
-	{
-		mBones[i].t = mJoints[mBones[i].j0];
-		mBones[i].length = (mJoints[mBones[i].j1] - mJoints[mBones[i].j0]).norm();
-	}
+	updateOffsetsAndLengths();
 	
 	// breast
 	vec3 up = -(mJoints[4] - mJoints[1]).normalized();
@@ -647,11 +733,7 @@ void MakeHSkeleton::updateBonesByJoints(const std::vector<vec3>& _V)
 	}
 
 	// set offset and calc lengths
-	for(unsigned int i = 0; i < mBones.size(); ++i)
-	{
-		mBones[i].t = mJoints[mBones[i].j0];
-		mBones[i].length = (mJoints[mBones[i].j1] - mJoints[mBones[i].j0]).norm();
-	}
+	updateOffsetsAndLengths();
 
 	// head
 	vec3 up = (mJoints[1] - mJoints[0]).normalized();
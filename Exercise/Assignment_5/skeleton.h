@@ -49,7 +49,10 @@ public:
     Skeleton(const Skeleton& other);
 
     //! destructor
-    ~Skeleton();
+    virtual ~Skeleton();
+
+    //! removes all joints and bones
+    void clear();
 
     //! get number of joints
     unsigned int getNumJoints() const;
@@ -72,6 +75,18 @@ public:
 	//! get the handle to a bone
 	bool getBone(unsigned int idx, Bone& out) const;
 
+	//! get a bones basis and offset without copying the whole bone
+	bool getBoneBasis(const unsigned int& idx, mat3& R, vec3& t) const;
+
+	//! set a bones basis, the offset follows the bones start joint
+	bool setBoneBasis(const unsigned int& idx, const mat3& R);
+
+	//! set a bones basis and offset, moves its start and end joint along
+	bool setBoneTransform(const unsigned int& idx, const mat3& R, const vec3& t);
+
+	//! get the bone ids from rootBone down to endBone (rootBone must be an ancestor)
+	bool getBoneChain(unsigned int rootBone, unsigned int endBone, std::vector<int>& out) const;
+
 	//! get all bone lengths
 	void getBoneLengths(std::vector<REAL>& out) const;
 
@@ -81,8 +96,11 @@ public:
 	//! set a bone by euler angles
 	bool setBoneRotationsAngles(const unsigned int& idx, const vec3& angles);
 	    
+    //! sets all bone offsets and lengths from the joints, bases are kept
+    void updateOffsetsAndLengths();
+
     //! updates all bone's bases after joints (inverse kinematics)
-    void updateBonesByJoints();
+    virtual void updateBonesByJoints();
 
     //! fits a skeleton to match best the target - keep lengths
     void fitToTargetSkeleton(const Skeleton& target);